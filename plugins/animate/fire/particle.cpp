@@ -1,74 +1,65 @@
 #include "particle.hpp"
 #include "shaders.hpp"
 #include <wayfire/core.hpp>
-#include <thread>
+#include <algorithm>
+#include <cmath>
 
-void Particle::update(float time)
-{
-    if (life <= 0) // ignore
-    {
-        return;
-    }
-
-    const float slowdown = 0.8;
-
-    pos   += speed * 0.2f * slowdown;
-    speed += g * 0.3f * slowdown;
-
-    if (life != 0)
-    {
-        color.a /= life;
-    }
-
-    life    -= fade * 0.3 * slowdown;
-    radius   = base_radius * std::pow(life, 0.5);
-    color.a *= life;
-
-    if (start_pos.x < pos.x)
-    {
-        g.x = -1;
-    } else
-    {
-        g.x = 1;
-    }
-
-    if (life <= 0)
-    {
-        /* move outside */
-        pos = {-10000, -10000};
-    }
-}
+/* The minimal number of particles handled by a single worker.
+ * Smaller batches are not worth the synchronization overhead. */
+static constexpr int min_particles_per_worker = 256;
 
 ParticleSystem::ParticleSystem(int particles, ParticleIniter init_func)
 {
     this->pinit_func = init_func;
 
+    particles_alive.store(0);
     resize(particles);
     last_update_msec = wf::get_current_time();
     create_program();
-
-    particles_alive.store(0);
 }
 
 ParticleSystem::~ParticleSystem()
 {
     OpenGL::render_begin();
+    GL_CALL(glDeleteBuffers(1, &instance_vbo));
+    GL_CALL(glDeleteBuffers(1, &quad_vbo));
     program.free_resources();
     OpenGL::render_end();
 }
 
 int ParticleSystem::spawn(int num)
 {
-    // TODO: multithread this
+    /* The initializer does not have to be thread-safe (fire uses std::rand),
+     * so new particles are always set up on the calling thread. */
     int spawned = 0;
-    for (size_t i = 0; i < ps.size() && spawned < num; i++)
+    for (size_t i = 0; i < life.size() && spawned < num; i++)
     {
-        if (ps[i].life <= 0)
+        if (life[i] > 0)
         {
-            pinit_func(ps[i]);
-            ++spawned;
-            ++particles_alive;
+            continue;
         }
+
+        Particle p;
+        pinit_func(p);
+
+        life[i] = p.life;
+        fade[i] = p.fade;
+        radius[i]  = p.radius;
+        base_radius[i] = p.base_radius;
+        pos_x[i]   = p.pos.x;
+        pos_y[i]   = p.pos.y;
+        speed_x[i] = p.speed.x;
+        speed_y[i] = p.speed.y;
+        g_x[i]     = p.g.x;
+        g_y[i]     = p.g.y;
+        start_x[i] = p.start_pos.x;
+        color_r[i] = p.color.r;
+        color_g[i] = p.color.g;
+        color_b[i] = p.color.b;
+        color_a[i] = p.color.a;
+
+        ++spawned;
+        ++particles_alive;
     }
 
     return spawned;
@@ -76,86 +67,94 @@ int ParticleSystem::spawn(int num)
 
 void ParticleSystem::resize(int num)
 {
-    if (num == (int)ps.size())
+    if (num == (int)life.size())
     {
         return;
     }
 
-    // TODO: multithread this
-    for (int i = num; i < (int)ps.size(); i++)
+    for (int i = num; i < (int)life.size(); i++)
     {
-        if (ps[i].life >= 0)
+        if (life[i] > 0)
         {
             --particles_alive;
         }
     }
 
-    ps.resize(num);
+    /* New particles start out dead, with zero radius so they are not drawn */
+    life.resize(num, -1);
+    radius.resize(num, 0);
+    for (auto *array : {&fade, &base_radius, &pos_x, &pos_y, &speed_x, &speed_y,
+        &g_x, &g_y, &start_x, &color_r, &color_g, &color_b})
+    {
+        array->resize(num, 0);
+    }
 
-    color.resize(color_per_particle * num);
-    dark_color.resize(color_per_particle * num);
-    radius.resize(radius_per_particle * num);
-    center.resize(center_per_particle * num);
+    color_a.resize(num, 1);
+    instance_data.resize(instance_stride * num, 0);
+    instance_data_dirty = true;
 }
 
 int ParticleSystem::size()
 {
-    return ps.size();
+    return life.size();
 }
 
 void ParticleSystem::update_worker(float time, int start, int end)
 {
-    end = std::min(end, (int)ps.size());
+    const float slowdown = 0.8;
+    int died = 0;
+
+    /* Plain pointers and selects instead of branches, so that the compiler
+     * can vectorize the simulation loop. */
+    float *__restrict__ l   = life.data();
+    float *__restrict__ r   = radius.data();
+    float *__restrict__ px  = pos_x.data();
+    float *__restrict__ py  = pos_y.data();
+    float *__restrict__ sx  = speed_x.data();
+    float *__restrict__ sy  = speed_y.data();
+    float *__restrict__ gx  = g_x.data();
+    float *__restrict__ a   = color_a.data();
+    const float *__restrict__ f  = fade.data();
+    const float *__restrict__ br = base_radius.data();
+    const float *__restrict__ gy = g_y.data();
+    const float *__restrict__ st = start_x.data();
+
     for (int i = start; i < end; ++i)
     {
-        if (ps[i].life <= 0)
-        {
-            continue;
-        }
+        const bool alive = l[i] > 0;
 
-        // printf("%d\n", i);
-        ps[i].update(time);
+        float new_x    = px[i] + sx[i] * 0.2f * slowdown;
+        float new_y    = py[i] + sy[i] * 0.2f * slowdown;
+        float new_life = l[i] - f[i] * 0.3f * slowdown;
+        const bool dies = alive && (new_life <= 0);
 
-        if (ps[i].life <= 0)
-        {
-            --particles_alive;
-        }
-
-        for (int j = 0; j < 4; j++) // maybe use memcpy?
-        {
-            color[4 * i + j] = ps[i].color[j];
-            dark_color[4 * i + j] = ps[i].color[j] * 0.5;
-        }
+        sx[i] = alive ? sx[i] + gx[i] * 0.3f * slowdown : sx[i];
+        sy[i] = alive ? sy[i] + gy[i] * 0.3f * slowdown : sy[i];
+        a[i]  = alive ? a[i] / l[i] * new_life : a[i];
+        r[i]  = alive ? br[i] * std::sqrt(std::max(new_life, 0.0f)) : r[i];
+        gx[i] = alive ? (st[i] < new_x ? -1.0f : 1.0f) : gx[i];
 
-        // printf("center %d gets %f", 2 * i, ps[i].pos[0]);
-        center[2 * i]     = ps[i].pos[0];
-        center[2 * i + 1] = ps[i].pos[1];
+        /* Dead particles are moved outside */
+        px[i] = dies ? -10000.0f : (alive ? new_x : px[i]);
+        py[i] = dies ? -10000.0f : (alive ? new_y : py[i]);
+        l[i]  = alive ? new_life : l[i];
 
-        radius[i] = ps[i].radius;
+        died += dies;
     }
-}
-
-void ParticleSystem::exec_worker_threads(std::function<void(int, int)> spawn_worker)
-{
-// return spawn_worker(0, ps.size());
-
-    const int num_threads = std::thread::hardware_concurrency();
-    const int worker_load = (ps.size() + num_threads - 1) / num_threads;
 
-    std::thread workers[num_threads];
-    for (int i = 0; i < num_threads; i++)
+    float *out = instance_data.data() + instance_stride * start;
+    for (int i = start; i < end; ++i, out += instance_stride)
     {
-        int thread_start = i * worker_load;
-        int thread_end   = (i + 1) * worker_load;
-        thread_end = std::min(thread_end, (int)ps.size());
-
-        workers[i] = std::thread([=] () { spawn_worker(thread_start, thread_end); });
+        out[0] = pos_x[i];
+        out[1] = pos_y[i];
+        out[2] = radius[i];
+        out[3] = color_r[i];
+        out[4] = color_g[i];
+        out[5] = color_b[i];
+        out[6] = color_a[i];
     }
 
-    for (auto& w : workers)
-    {
-        w.join();
-    }
+    particles_alive -= died;
 }
 
 void ParticleSystem::update()
@@ -164,10 +163,13 @@ void ParticleSystem::update()
     float time = (wf::get_current_time() - last_update_msec) / 16.0;
     last_update_msec = wf::get_current_time();
 
-    exec_worker_threads([=] (int start, int end)
+    pool->parallel_for(life.size(), min_particles_per_worker,
+        [=] (size_t start, size_t end)
     {
         update_worker(time, start, end);
     });
+
+    instance_data_dirty = true;
 }
 
 int ParticleSystem::statistic()
@@ -177,51 +179,86 @@ int ParticleSystem::statistic()
 
 void ParticleSystem::create_program()
 {
+    static const float vertex_data[] = {
+        -1, -1,
+        1, -1,
+        1, 1,
+        -1, 1
+    };
+
     /* Just load the proper context, viewport doesn't matter */
     OpenGL::render_begin();
-    program.set_simple(OpenGL::compile_program(particle_vert_source,
-        particle_frag_source));
+    program.set_simple_lazy(particle_vert_source, particle_frag_source);
+    handles.position = program.get_attrib("position");
+    handles.center   = program.get_attrib("center");
+    handles.radius   = program.get_attrib("radius");
+    handles.color    = program.get_attrib("color");
+    handles.matrix   = program.get_uniform("matrix");
+    handles.color_scale = program.get_uniform("color_scale");
+    handles.smoothing   = program.get_uniform("smoothing");
+
+    GL_CALL(glGenBuffers(1, &quad_vbo));
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, quad_vbo));
+    GL_CALL(glBufferData(GL_ARRAY_BUFFER, sizeof(vertex_data), vertex_data,
+        GL_STATIC_DRAW));
+
+    GL_CALL(glGenBuffers(1, &instance_vbo));
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
     OpenGL::render_end();
 }
 
 void ParticleSystem::render(glm::mat4 matrix)
 {
+    if (life.empty())
+    {
+        return;
+    }
+
     program.use(wf::TEXTURE_TYPE_RGBA);
-    static float vertex_data[] = {
-        -1, -1,
-        1, -1,
-        1, 1,
-        -1, 1
-    };
 
-    program.attrib_pointer("position", 2, 0, vertex_data);
-    program.attrib_divisor("position", 0);
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, quad_vbo));
+    program.attrib_pointer(handles.position, 2, 0, nullptr);
+    program.attrib_divisor(handles.position, 0);
+
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, instance_vbo));
+    if (instance_data_dirty)
+    {
+        /* Re-specifying the whole buffer lets the driver orphan the old
+         * storage instead of waiting for draws which still use it. */
+        GL_CALL(glBufferData(GL_ARRAY_BUFFER,
+            instance_data.size() * sizeof(float), instance_data.data(),
+            GL_STREAM_DRAW));
+        instance_data_dirty = false;
+    }
 
-    program.attrib_pointer("radius", 1, 0, radius.data());
-    program.attrib_divisor("radius", 1);
+    const int stride = instance_stride * sizeof(float);
+    program.attrib_pointer(handles.center, 2, stride, (void*)0);
+    program.attrib_divisor(handles.center, 1);
 
-    program.attrib_pointer("center", 2, 0, center.data());
-    program.attrib_divisor("center", 1);
+    program.attrib_pointer(handles.radius, 1, stride, (void*)(2 * sizeof(float)));
+    program.attrib_divisor(handles.radius, 1);
+
+    program.attrib_pointer(handles.color, 4, stride, (void*)(3 * sizeof(float)));
+    program.attrib_divisor(handles.color, 1);
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
 
     // matrix
-    program.uniformMatrix4f("matrix", matrix);
+    program.uniformMatrix4f(handles.matrix, matrix);
 
     /* Darken the background */
-    program.attrib_pointer("color", 4, 0, dark_color.data());
-    program.attrib_divisor("color", 1);
-
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA));
-    program.uniform1f("smoothing", 0.7);
+    program.uniform1f(handles.color_scale, 0.5);
+    program.uniform1f(handles.smoothing, 0.7);
 
     // TODO: optimize shaders for this case
-    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, ps.size()));
+    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, life.size()));
 
     // particle color
-    program.attrib_pointer("color", 4, 0, color.data());
     GL_CALL(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
-    program.uniform1f("smoothing", 0.5);
-    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, ps.size()));
+    program.uniform1f(handles.color_scale, 1.0);
+    program.uniform1f(handles.smoothing, 0.5);
+    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, life.size()));
 
     GL_CALL(glDisable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
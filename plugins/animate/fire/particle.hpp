@@ -2,10 +2,14 @@
 #define ANIMATION_FIRE_PARTICLE_HPP
 
 #include <wayfire/opengl.hpp>
+#include <wayfire/plugins/common/shared-core-data.hpp>
+#include <wayfire/plugins/common/worker-pool.hpp>
 #include <functional>
 #include <atomic>
 #include <vector>
 
+/* The initial state of a particle, as filled in by a ParticleIniter.
+ * The particle system itself stores particles in structure-of-arrays form. */
 struct Particle
 {
     float life = -1;
@@ -17,11 +21,6 @@ struct Particle
     glm::vec2 start_pos;
 
     glm::vec4 color{1.0, 1.0, 1.0, 1.0};
-
-    /* update the given particle
-     * time is the percentage of the frame which has elapsed
-     * must be thread-safe */
-    void update(float time);
 };
 
 /* a function to initialize a particle */
@@ -65,19 +64,30 @@ class ParticleSystem
     uint32_t last_update_msec;
 
     std::atomic<int> particles_alive;
-    std::vector<Particle> ps;
-
-    static constexpr int color_per_particle = 4;
-    std::vector<float> color, dark_color;
 
-    static constexpr int radius_per_particle = 1;
-    std::vector<float> radius;
+    /* Particle state, one entry per particle in each array */
+    std::vector<float> life, fade, radius, base_radius;
+    std::vector<float> pos_x, pos_y, speed_x, speed_y, g_x, g_y, start_x;
+    std::vector<float> color_r, color_g, color_b, color_a;
 
-    static constexpr int center_per_particle = 2;
-    std::vector<float> center;
+    /* Per-instance vertex data, interleaved as center.xy, radius, color.rgba.
+     * Written by the update workers and streamed to instance_vbo. */
+    static constexpr int instance_stride = 7;
+    std::vector<float> instance_data;
+    bool instance_data_dirty = true;
 
     OpenGL::program_t program;
-    void exec_worker_threads(std::function<void(int, int)> spawn_worker);
+    struct
+    {
+        OpenGL::attrib_t position, center, radius, color;
+        OpenGL::uniform_t matrix, color_scale, smoothing;
+    } handles;
+
+    GLuint instance_vbo = 0;
+    GLuint quad_vbo     = 0;
+
+    wf::shared_data::ref_ptr_t<wf::worker_pool_t> pool;
+
     void update_worker(float time, int start, int end);
     void create_program();
 };
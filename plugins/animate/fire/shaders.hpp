@@ -11,6 +11,7 @@ attribute mediump vec2 center;
 attribute mediump vec4 color;
 
 uniform mat4 matrix;
+uniform mediump float color_scale;
 
 varying mediump vec2 uv;
 varying mediump vec4 out_color;
@@ -21,7 +22,7 @@ void main() {
     gl_Position = matrix * vec4(center.x + uv.x * 0.75, center.y + uv.y, 0.0, 1.0);
 
     R = radius;
-    out_color = color;
+    out_color = color * color_scale;
 }
 )";
 
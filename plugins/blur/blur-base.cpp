@@ -58,15 +58,31 @@ wf_blur_base::wf_blur_base(wf::output_t *output, std::string name)
     this->degrade_opt.load_option("blur/" + algorithm_name + "_degrade");
     this->iterations_opt.load_option("blur/" + algorithm_name + "_iterations");
 
-    this->options_changed = [=] () { output->render->damage_whole(); };
+    this->options_changed = [=] ()
+    {
+        ++generation;
+        output->render->damage_whole();
+    };
     this->saturation_opt.set_callback(options_changed);
     this->offset_opt.set_callback(options_changed);
     this->degrade_opt.set_callback(options_changed);
     this->iterations_opt.set_callback(options_changed);
 
-    OpenGL::render_begin();
-    blend_program.compile(blur_blend_vertex_shader, blur_blend_fragment_shader);
-    OpenGL::render_end();
+    for (int i = 0; i < 2; i++)
+    {
+        handles[i].position   = program[i].get_attrib("position");
+        handles[i].offset     = program[i].get_uniform("offset");
+        handles[i].halfpixel  = program[i].get_uniform("halfpixel");
+        handles[i].size       = program[i].get_uniform("size");
+        handles[i].iterations = program[i].get_uniform("iterations");
+    }
+
+    blend_program.compile_lazy(blur_blend_vertex_shader,
+        blur_blend_fragment_shader);
+    blend_handles.position   = blend_program.get_attrib("position");
+    blend_handles.mvp        = blend_program.get_uniform("mvp");
+    blend_handles.bg_texture = blend_program.get_uniform("bg_texture");
+    blend_handles.sat = blend_program.get_uniform("sat");
 }
 
 wf_blur_base::~wf_blur_base()
@@ -80,6 +96,11 @@ wf_blur_base::~wf_blur_base()
     OpenGL::render_end();
 }
 
+uint64_t wf_blur_base::get_generation() const
+{
+    return generation;
+}
+
 int wf_blur_base::calculate_blur_radius()
 {
     return offset_opt * degrade_opt * std::max(1, (int)iterations_opt);
@@ -167,11 +188,11 @@ wlr_box wf_blur_base::copy_region(wf::framebuffer_base_t& result,
     return subbox;
 }
 
-void wf_blur_base::pre_render(wf::texture_t src_tex, wlr_box src_box,
-    const wf::region_t& damage, const wf::framebuffer_t& target_fb)
+void wf_blur_base::pre_render(wlr_box src_box, const wf::region_t& damage,
+    const wf::framebuffer_t& source_fb, wf::framebuffer_base_t& result)
 {
     int degrade     = degrade_opt;
-    auto damage_box = copy_region(fb[0], target_fb, damage);
+    auto damage_box = copy_region(fb[0], source_fb, damage);
 
     /* As an optimization, we create a region that blur can use
      * to perform minimal rendering required to blur. We start
@@ -179,7 +200,7 @@ void wf_blur_base::pre_render(wf::texture_t src_tex, wlr_box src_box,
     wf::region_t blur_damage;
     for (auto b : damage)
     {
-        blur_damage |= target_fb.framebuffer_box_from_geometry_box(
+        blur_damage |= source_fb.framebuffer_box_from_geometry_box(
             wlr_box_from_pixman_box(b));
     }
 
@@ -189,40 +210,50 @@ void wf_blur_base::pre_render(wf::texture_t src_tex, wlr_box src_box,
 
     int r = blur_fb0(blur_damage, fb[0].viewport_width, fb[0].viewport_height);
 
-    /* Make sure the result is always fb[1], because that's what is used in render()
-     * */
+    /* Make sure the blurred pixels are always in fb[0] */
     if (r != 0)
     {
         std::swap(fb[0], fb[1]);
     }
 
-    /* we subtract target_fb's position to so that
+    /* we subtract source_fb's position to so that
      * view box is relative to framebuffer */
-    auto view_box = target_fb.framebuffer_box_from_geometry_box(src_box);
+    auto view_box = source_fb.framebuffer_box_from_geometry_box(src_box);
 
     OpenGL::render_begin();
-    fb[1].allocate(view_box.width, view_box.height);
-    fb[1].bind();
+    result.allocate(view_box.width, view_box.height);
+    result.bind();
     GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, fb[0].fb));
 
     /* Blit the blurred texture into an fb which has the size of the view,
      * so that the view texture and the blurred background can be combined
      * together in render()
      *
-     * local_geometry is damage_box relative to view box */
+     * local_geometry is damage_box relative to view box. The blit is limited
+     * to the damaged rects, so that the rest of result stays intact. */
     wlr_box local_box = damage_box + wf::point_t{-view_box.x, -view_box.y};
-    GL_CALL(glBlitFramebuffer(0, 0, fb[0].viewport_width, fb[0].viewport_height,
-        local_box.x,
-        view_box.height - local_box.y - local_box.height,
-        local_box.x + local_box.width,
-        view_box.height - local_box.y,
-        GL_COLOR_BUFFER_BIT, GL_LINEAR));
+    for (auto& b : damage)
+    {
+        auto rect = source_fb.framebuffer_box_from_geometry_box(
+            wlr_box_from_pixman_box(b));
+        result.scissor(rect + wf::point_t{-view_box.x, -view_box.y});
+        GL_CALL(glBlitFramebuffer(0, 0, fb[0].viewport_width,
+            fb[0].viewport_height,
+            local_box.x,
+            view_box.height - local_box.y - local_box.height,
+            local_box.x + local_box.width,
+            view_box.height - local_box.y,
+            GL_COLOR_BUFFER_BIT, GL_LINEAR));
+    }
+
+    GL_CALL(glDisable(GL_SCISSOR_TEST));
     GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
     OpenGL::render_end();
 }
 
 void wf_blur_base::render(wf::texture_t src_tex, wlr_box src_box,
-    wlr_box scissor_box, const wf::framebuffer_t& target_fb)
+    wlr_box scissor_box, const wf::framebuffer_t& target_fb,
+    const wf::framebuffer_base_t& background)
 {
     wlr_box fb_geom =
         target_fb.framebuffer_box_from_geometry_box(target_fb.geometry);
@@ -239,17 +270,18 @@ void wf_blur_base::render(wf::texture_t src_tex, wlr_box src_box,
         -1.0f, 1.0f
     };
 
-    blend_program.attrib_pointer("position", 2, 0, vertexData);
+    blend_program.attrib_pointer(blend_handles.position, 2, 0, vertexData);
 
     /* Blend blurred background with window texture src_tex */
-    blend_program.uniformMatrix4f("mvp", glm::inverse(target_fb.transform));
+    blend_program.uniformMatrix4f(blend_handles.mvp,
+        glm::inverse(target_fb.transform));
     /* XXX: core should give us the number of texture units used */
-    blend_program.uniform1i("bg_texture", 1);
-    blend_program.uniform1f("sat", saturation_opt);
+    blend_program.uniform1i(blend_handles.bg_texture, 1);
+    blend_program.uniform1f(blend_handles.sat, saturation_opt);
 
     blend_program.set_active_texture(src_tex);
     GL_CALL(glActiveTexture(GL_TEXTURE0 + 1));
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, fb[1].tex));
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, background.tex));
     /* Render it to target_fb */
     target_fb.bind();
     GL_CALL(glViewport(view_box.x, fb_geom.height - view_box.y - view_box.height,
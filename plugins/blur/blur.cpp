@@ -6,23 +6,237 @@
 #include <wayfire/workspace-stream.hpp>
 #include <wayfire/workspace-manager.hpp>
 #include <wayfire/signal-definitions.hpp>
+#include <wayfire/nonstd/reverse.hpp>
+#include <map>
+#include <unordered_map>
 
 #include "blur.hpp"
 
-using blur_algorithm_provider = std::function<nonstd::observer_ptr<wf_blur_base>()>;
+/** Expand each rect of the region by @padding in all directions. */
+static wf::region_t expand_by(const wf::region_t& region, int padding)
+{
+    wf::region_t padded;
+    for (const auto& rect : region)
+    {
+        padded |= wlr_box{
+            (rect.x1 - padding),
+            (rect.y1 - padding),
+            (rect.x2 - rect.x1) + 2 * padding,
+            (rect.y2 - rect.y1) + 2 * padding
+        };
+    }
+
+    return padded;
+}
+
+/** @return The part of the region which is at least @padding away from its edges. */
+static wf::region_t shrink_by(const wf::region_t& region, int padding)
+{
+    wf::region_t outside = expand_by(
+        wf::region_t{wlr_box_from_pixman_box(region.get_extents())}, padding + 1);
+    outside ^= region;
+
+    return region ^ expand_by(outside, padding);
+}
+
+/** What the blur transformers need from the blur plugin on their output. */
+class blur_context_t
+{
+  public:
+    virtual ~blur_context_t() = default;
+
+    /** @return The current blur algorithm. */
+    virtual nonstd::observer_ptr<wf_blur_base> get_algorithm() = 0;
+
+    /**
+     * @return The damage of the current frame which was taken into account
+     *   when invalidating cached backgrounds.
+     */
+    virtual const wf::region_t& get_known_damage() = 0;
+
+    /**
+     * @return Whether only the background layers are blurred. Otherwise, the
+     *   whole scene below a view is blurred, and it has to be read from the
+     *   target framebuffer.
+     */
+    virtual bool uses_static_background() = 0;
+
+    /**
+     * Get a framebuffer with only the background layers for the workspace of
+     * target_fb, up to date in the given region.
+     */
+    virtual const wf::framebuffer_t& get_static_background(
+        const wf::framebuffer_t& target_fb, const wf::region_t& region) = 0;
+};
+
 class wf_blur_transformer : public wf::view_transformer_t
 {
-    blur_algorithm_provider provider;
+    blur_context_t *context;
     wf::output_t *output;
     wayfire_view view;
 
+    /** The blurred background of the view on a single workspace. */
+    struct cached_background_t
+    {
+        wf::framebuffer_base_t fb;
+        /* The view box and output scale for which fb was rendered */
+        wlr_box src_box = {0, 0, 0, 0};
+        float scale     = 0;
+        /* The up-to-date parts of fb, in output-local coordinates */
+        wf::region_t valid;
+        /* The number of frames since the background was last used */
+        int age = 0;
+    };
+
+    /* Caches which have not been used for that many frames are released */
+    static constexpr int max_cache_age = 300;
+
+    /* Indexed by the position of the workspace stream framebuffer */
+    std::map<std::pair<int, int>, cached_background_t> cache;
+    cached_background_t *current = nullptr;
+
+    /* The generation of the algorithm settings the caches were rendered with */
+    uint64_t cached_generation = 0;
+
+    cached_background_t& get_cache(wlr_box src_box,
+        const wf::framebuffer_t& target_fb)
+    {
+        auto generation = context->get_algorithm()->get_generation();
+        if (generation != cached_generation)
+        {
+            cached_generation = generation;
+            invalidate_all();
+        }
+
+        auto& entry = cache[{target_fb.geometry.x, target_fb.geometry.y}];
+        entry.age = 0;
+
+        /* Sticky views are rendered at different positions on each workspace,
+         * so their cached background is never reused. */
+        if ((entry.src_box != src_box) || (entry.scale != target_fb.scale) ||
+            view->sticky)
+        {
+            entry.src_box = src_box;
+            entry.scale   = target_fb.scale;
+            entry.valid.clear();
+        }
+
+        return entry;
+    }
+
+    /** Make sure the cached background is up to date in @region. */
+    void update_background(wlr_box src_box, const wf::region_t& damage,
+        const wf::region_t& region, const wf::framebuffer_t& target_fb)
+    {
+        auto algorithm = context->get_algorithm();
+        auto& entry    = get_cache(src_box, target_fb);
+        current = &entry;
+
+        int padding = std::ceil(algorithm->calculate_blur_radius() /
+            target_fb.scale);
+
+        const bool static_background = context->uses_static_background();
+        if (!static_background)
+        {
+            /* Damage the plugin did not know about could have come from below
+             * the view, so it cannot be served from the cache. */
+            entry.valid ^= expand_by(damage ^ context->get_known_damage(), padding);
+        }
+
+        if ((region ^ entry.valid).empty())
+        {
+            return;
+        }
+
+        if (static_background)
+        {
+            /* The background is complete, so blur it for the whole view at
+             * once, with enough margin to avoid artifacts at the edges. */
+            wf::region_t full = expand_by(src_box, padding) & target_fb.geometry;
+            auto& background  = context->get_static_background(target_fb, full);
+            algorithm->pre_render(src_box, full, background, entry.fb);
+            entry.valid = wf::region_t{src_box} & target_fb.geometry;
+        } else
+        {
+            /* Only the damaged region of target_fb contains the scene below the
+             * view, so the pixels close to its edges are blurred with stale
+             * pixels and cannot be reused. */
+            algorithm->pre_render(src_box, region, target_fb, entry.fb);
+            entry.valid ^= region;
+            entry.valid |= shrink_by(region, padding);
+        }
+    }
+
   public:
-    wf_blur_transformer(blur_algorithm_provider blur_algorithm_provider,
+    wf_blur_transformer(blur_context_t *context,
         wf::output_t *output, wayfire_view view)
     {
-        provider     = blur_algorithm_provider;
-        this->output = output;
-        this->view   = view;
+        this->context = context;
+        this->output  = output;
+        this->view    = view;
+    }
+
+    ~wf_blur_transformer()
+    {
+        OpenGL::render_begin();
+        for (auto& [_, entry] : cache)
+        {
+            entry.fb.release();
+        }
+
+        OpenGL::render_end();
+    }
+
+    /** Mark the cached background in the given region as outdated. */
+    void invalidate(const wf::region_t& region)
+    {
+        for (auto& [_, entry] : cache)
+        {
+            entry.valid ^= region;
+        }
+    }
+
+    void invalidate_all()
+    {
+        for (auto& [_, entry] : cache)
+        {
+            entry.valid.clear();
+        }
+    }
+
+    /** @return Whether the cached background is up to date in @region. */
+    bool is_cached(const wf::region_t& region)
+    {
+        if (view->sticky)
+        {
+            return region.empty();
+        }
+
+        wf::region_t valid;
+        for (auto& [_, entry] : cache)
+        {
+            valid |= entry.valid;
+        }
+
+        return (region ^ valid).empty();
+    }
+
+    /** Release the caches which have not been used for a long time. */
+    void age_cache()
+    {
+        for (auto it = cache.begin(); it != cache.end();)
+        {
+            if (++it->second.age > max_cache_age)
+            {
+                OpenGL::render_begin();
+                it->second.fb.release();
+                OpenGL::render_end();
+                it = cache.erase(it);
+            } else
+            {
+                ++it;
+            }
+        }
     }
 
     wf::pointf_t transform_point(wf::geometry_t view,
@@ -82,7 +296,7 @@ class wf_blur_transformer : public wf::view_transformer_t
         /* Shrink the opaque region by the padding amount since the render
          * chain expects this, as we have applied padding to damage in
          * frame_pre_paint for this frame already */
-        int padding = std::ceil(provider()->calculate_blur_radius() /
+        int padding = std::ceil(context->get_algorithm()->calculate_blur_radius() /
             output->render->get_target_framebuffer().scale);
         wf::surface_interface_t::set_opaque_shrink_constraint("blur", padding);
 
@@ -100,9 +314,10 @@ class wf_blur_transformer : public wf::view_transformer_t
 
         if (!blurred_region.empty())
         {
-            provider()->pre_render(src_tex, src_box, blurred_region, target_fb);
+            update_background(src_box, damage, blurred_region, target_fb);
             wf::view_transformer_t::render_with_damage(src_tex, src_box,
                 blurred_region, target_fb);
+            current = nullptr;
         }
 
         /* Opaque non-blurred regions can be rendered directly without blending */
@@ -116,22 +331,27 @@ class wf_blur_transformer : public wf::view_transformer_t
     void render_box(wf::texture_t src_tex, wlr_box src_box, wlr_box scissor_box,
         const wf::framebuffer_t& target_fb) override
     {
-        provider()->render(src_tex, src_box, scissor_box, target_fb);
+        context->get_algorithm()->render(src_tex, src_box, scissor_box,
+            target_fb, current->fb);
     }
 };
 
-class wayfire_blur : public wf::plugin_interface_t
+class wayfire_blur : public wf::plugin_interface_t, public blur_context_t
 {
     wf::button_callback button_toggle;
 
     wf::effect_hook_t frame_pre_paint;
     wf::signal_callback_t workspace_stream_pre, workspace_stream_post,
-        view_attached, view_detached;
+        view_attached, view_detached, view_damaged, stack_order_changed,
+        workspace_changed;
 
     wf::view_matcher_t blur_by_default{"blur/blur_by_default"};
     wf::option_wrapper_t<std::string> method_opt{"blur/method"};
+    wf::option_wrapper_t<bool> background_only{"blur/background_only"};
     wf::option_wrapper_t<wf::buttonbinding_t> toggle_button{"blur/toggle"};
-    wf::config::option_base_t::updated_callback_t blur_method_changed;
+    wf::option_wrapper_t<wf::color_t> background_color{"core/background_color"};
+    wf::config::option_base_t::updated_callback_t blur_method_changed,
+        background_only_changed;
     std::unique_ptr<wf_blur_base> blur_algorithm;
 
     const std::string transformer_name = "blur";
@@ -140,6 +360,29 @@ class wayfire_blur : public wf::plugin_interface_t
     wf::framebuffer_base_t saved_pixels;
     wf::region_t padded_region;
 
+    /* Damage reported by each view since the last frame */
+    std::unordered_map<wf::view_interface_t*, wf::region_t> view_damage;
+    /* Damage reported by views in the background layers since the last frame */
+    wf::region_t below_layers_damage;
+    bool stack_changed = false;
+
+    /* Damage of the current frame, including the padding added by blur */
+    wf::region_t known_damage;
+    /* Regions of blurred views which will be blurred from the framebuffer in
+     * the current frame and therefore need padded damage */
+    wf::region_t blur_invalid;
+
+    /** The background layers of a workspace, when blurring only those. */
+    struct static_background_t
+    {
+        wf::framebuffer_t fb;
+        /* The parts of fb which are up to date, in output-local coordinates */
+        wf::region_t valid;
+    };
+
+    /* Indexed by the position of the workspace stream framebuffer */
+    std::map<std::pair<int, int>, static_background_t> static_backgrounds;
+
     void add_transformer(wayfire_view view)
     {
         if (view->get_transformer(transformer_name))
@@ -148,9 +391,7 @@ class wayfire_blur : public wf::plugin_interface_t
         }
 
         view->add_transformer(std::make_unique<wf_blur_transformer>(
-            [=] () {return nonstd::make_observer(blur_algorithm.get()); },
-            output, view),
-            transformer_name);
+            this, output, view), transformer_name);
     }
 
     void pop_transformer(wayfire_view view)
@@ -169,6 +410,12 @@ class wayfire_blur : public wf::plugin_interface_t
         }
     }
 
+    wf_blur_transformer *get_transformer(wayfire_view view)
+    {
+        return dynamic_cast<wf_blur_transformer*>(
+            view->get_transformer(transformer_name).get());
+    }
+
     /** Transform region into framebuffer coordinates */
     wf::region_t get_fb_region(const wf::region_t& region,
         const wf::framebuffer_t& fb) const
@@ -191,18 +438,28 @@ class wayfire_blur : public wf::plugin_interface_t
         int padding = std::ceil(
             blur_algorithm->calculate_blur_radius() / scale);
 
-        wf::region_t padded;
-        for (const auto& rect : region)
+        return expand_by(region, padding);
+    }
+
+    /** @return The region of the given view on all workspaces it is visible on */
+    wf::region_t get_view_region(wayfire_view view, wlr_box box) const
+    {
+        if (!view->sticky)
+        {
+            return box;
+        }
+
+        wf::region_t region;
+        auto wsize = output->workspace->get_workspace_grid_size();
+        for (int i = 0; i < wsize.width; i++)
         {
-            padded |= wlr_box{
-                (rect.x1 - padding),
-                (rect.y1 - padding),
-                (rect.x2 - rect.x1) + 2 * padding,
-                (rect.y2 - rect.y1) + 2 * padding
-            };
+            for (int j = 0; j < wsize.height; j++)
+            {
+                region |= box + wf::origin(output->render->get_ws_box({i, j}));
+            }
         }
 
-        return padded;
+        return region;
     }
 
     // Blur region for current frame
@@ -220,32 +477,203 @@ class wayfire_blur : public wf::plugin_interface_t
                 continue;
             }
 
-            auto bbox = view->get_bounding_box();
-            if (!view->sticky)
+            blur_region |= get_view_region(view, view->get_bounding_box());
+        }
+    }
+
+    /** Find the region of blurred views on the given workspace */
+    wf::region_t get_blur_region(wf::point_t ws) const
+    {
+        return blur_region & output->render->get_ws_box(ws);
+    }
+
+    /**
+     * Invalidate the cached backgrounds of blurred views where something
+     * below them changed, and damage the parts of the views whose blurred
+     * background changes as a result.
+     *
+     * Damage from a blurred view itself or from views above it does not change
+     * its background, so the cached background is reused there, and the
+     * damage does not need padding.
+     */
+    void update_caches(const wf::region_t& damage, int padding)
+    {
+        std::vector<wayfire_view> stack;
+        for (auto& v : output->workspace->get_views_in_layer(wf::ALL_LAYERS))
+        {
+            for (auto& view : v->enumerate_views(false))
             {
-                blur_region |= bbox;
+                stack.push_back(view);
+            }
+        }
+
+        std::unordered_map<wf::view_interface_t*, size_t> stack_index;
+        for (size_t i = 0; i < stack.size(); i++)
+        {
+            stack_index[stack[i].get()] = i;
+        }
+
+        for (size_t i = 0; i < stack.size(); i++)
+        {
+            auto transformer = get_transformer(stack[i]);
+            if (!transformer)
+            {
+                continue;
+            }
+
+            wf::region_t changed;
+            if (background_only)
+            {
+                changed = below_layers_damage;
             } else
             {
-                auto wsize = output->workspace->get_workspace_grid_size();
-                for (int i = 0; i < wsize.width; i++)
+                wf::region_t damage_above;
+                for (auto& [view, region] : view_damage)
                 {
-                    for (int j = 0; j < wsize.height; j++)
+                    auto it = stack_index.find(view);
+                    if ((it != stack_index.end()) && (it->second <= i))
                     {
-                        blur_region |=
-                            bbox + wf::origin(output->render->get_ws_box({i, j}));
+                        damage_above |= region;
+                    } else
+                    {
+                        changed |= region;
                     }
                 }
+
+                /* Damage which did not come from a view could be anywhere */
+                changed |= damage ^ damage_above;
+                if (stack_changed)
+                {
+                    transformer->invalidate_all();
+                }
+            }
+
+            auto invalid = expand_by(changed, padding);
+            transformer->invalidate(invalid);
+            transformer->age_cache();
+
+            auto view_region = get_view_region(stack[i],
+                stack[i]->get_bounding_box());
+            wf::region_t repaint = invalid & view_region;
+            output->render->damage(repaint);
+            known_damage |= repaint;
+
+            if (!background_only &&
+                !transformer->is_cached((damage | repaint) & view_region))
+            {
+                blur_invalid |= view_region;
             }
         }
+
+        view_damage.clear();
+        below_layers_damage.clear();
+        stack_changed = false;
     }
 
-    /** Find the region of blurred views on the given workspace */
-    wf::region_t get_blur_region(wf::point_t ws) const
+    void invalidate_caches()
     {
-        return blur_region & output->render->get_ws_box(ws);
+        for (auto& view : output->workspace->get_views_in_layer(wf::ALL_LAYERS))
+        {
+            if (auto transformer = get_transformer(view))
+            {
+                transformer->invalidate_all();
+            }
+        }
+    }
+
+    void release_static_backgrounds()
+    {
+        OpenGL::render_begin();
+        for (auto& [_, background] : static_backgrounds)
+        {
+            background.fb.release();
+        }
+
+        OpenGL::render_end();
+        static_backgrounds.clear();
     }
 
   public:
+    nonstd::observer_ptr<wf_blur_base> get_algorithm() override
+    {
+        return nonstd::make_observer(blur_algorithm.get());
+    }
+
+    const wf::region_t& get_known_damage() override
+    {
+        return known_damage;
+    }
+
+    bool uses_static_background() override
+    {
+        return background_only;
+    }
+
+    const wf::framebuffer_t& get_static_background(
+        const wf::framebuffer_t& target_fb, const wf::region_t& region) override
+    {
+        auto& bg = static_backgrounds[{target_fb.geometry.x, target_fb.geometry.y}];
+
+        OpenGL::render_begin();
+        if (bg.fb.allocate(target_fb.viewport_width, target_fb.viewport_height) ||
+            (bg.fb.geometry != target_fb.geometry) ||
+            (bg.fb.scale != target_fb.scale) ||
+            (bg.fb.wl_transform != target_fb.wl_transform))
+        {
+            bg.valid.clear();
+        }
+
+        bg.fb.geometry     = target_fb.geometry;
+        bg.fb.scale        = target_fb.scale;
+        bg.fb.wl_transform = target_fb.wl_transform;
+        bg.fb.transform    = target_fb.transform;
+        OpenGL::render_end();
+
+        wf::region_t missing = (region & target_fb.geometry) ^ bg.valid;
+        if (missing.empty())
+        {
+            return bg.fb;
+        }
+
+        OpenGL::render_begin(bg.fb);
+        for (const auto& rect : missing)
+        {
+            bg.fb.logic_scissor(wlr_box_from_pixman_box(rect));
+            OpenGL::clear(background_color);
+        }
+
+        OpenGL::render_end();
+
+        /* Sticky views are rendered relative to each workspace */
+        auto ws_delta = wf::origin(target_fb.geometry);
+        auto views    = output->workspace->get_views_in_layer(wf::BELOW_LAYERS);
+        for (auto& v : wf::reverse(views))
+        {
+            auto tree = v->enumerate_views();
+            for (auto& view : wf::reverse(tree))
+            {
+                /* Views blurred themselves would need their own background */
+                if (!view->is_visible() || get_transformer(view))
+                {
+                    continue;
+                }
+
+                if (view->sticky)
+                {
+                    bg.fb.geometry = target_fb.geometry + -ws_delta;
+                    view->render_transformed(bg.fb, missing + -ws_delta);
+                    bg.fb.geometry = target_fb.geometry;
+                } else
+                {
+                    view->render_transformed(bg.fb, missing);
+                }
+            }
+        }
+
+        bg.valid |= missing;
+        return bg.fb;
+    }
+
     void init() override
     {
         grab_interface->name = "blur";
@@ -254,12 +682,21 @@ class wayfire_blur : public wf::plugin_interface_t
         blur_method_changed = [=] ()
         {
             blur_algorithm = create_blur_from_name(output, method_opt);
+            invalidate_caches();
             output->render->damage_whole();
         };
         /* Create initial blur algorithm */
         blur_method_changed();
         method_opt.set_callback(blur_method_changed);
 
+        background_only_changed = [=] ()
+        {
+            release_static_backgrounds();
+            invalidate_caches();
+            output->render->damage_whole();
+        };
+        background_only.set_callback(background_only_changed);
+
         /* Toggles the blur state of the view the user clicked on */
         button_toggle = [=] (auto)
         {
@@ -314,6 +751,41 @@ class wayfire_blur : public wf::plugin_interface_t
         output->connect_signal("view-mapped", &view_attached);
         output->connect_signal("view-detached", &view_detached);
 
+        /* Record which view damaged which region, so that cached backgrounds
+         * are invalidated only by damage below the blurred view. */
+        view_damaged = [=] (wf::signal_data_t *data)
+        {
+            auto ev     = static_cast<wf::view_region_damaged_signal*>(data);
+            auto region = get_view_region(ev->view, ev->box);
+            view_damage[ev->view.get()] |= region;
+
+            if (output->workspace->get_view_layer(ev->view) & wf::BELOW_LAYERS)
+            {
+                below_layers_damage |= region;
+                for (auto& [_, background] : static_backgrounds)
+                {
+                    background.valid ^= region;
+                }
+            }
+        };
+        output->connect_signal("view-region-damaged", &view_damaged);
+
+        stack_order_changed = [=] (wf::signal_data_t*)
+        {
+            stack_changed = true;
+        };
+        output->connect_signal("stack-order-changed", &stack_order_changed);
+
+        /* Workspace framebuffers are relative to the current workspace */
+        workspace_changed = [=] (wf::signal_data_t*)
+        {
+            for (auto& [_, background] : static_backgrounds)
+            {
+                background.valid.clear();
+            }
+        };
+        output->connect_signal("workspace-changed", &workspace_changed);
+
         /* frame_pre_paint is called before each frame has started.
          * It expands the damage by the blur radius.
          * This is needed, because when blurring, the pixels that changed
@@ -330,8 +802,9 @@ class wayfire_blur : public wf::plugin_interface_t
             wf::surface_interface_t::set_opaque_shrink_constraint("blur",
                 padding);
 
-            output->render->damage(expand_region(
-                damage & this->blur_region, fb.scale));
+            known_damage = damage;
+            blur_invalid.clear();
+            update_caches(damage, padding);
         };
         output->render->add_effect(&frame_pre_paint, wf::OUTPUT_EFFECT_DAMAGE);
 
@@ -340,15 +813,23 @@ class wayfire_blur : public wf::plugin_interface_t
          * damage and take a snapshot of the padded area. The padded
          * damage will be used to render the scene as normal. Then
          * workspace_stream_post is called so we can copy the padded
-         * pixels back. */
+         * pixels back. Views whose background is served from the cache
+         * or from the static background do not need padding. */
         workspace_stream_pre = [=] (wf::signal_data_t *data)
         {
             auto& damage   = static_cast<wf::stream_signal_t*>(data)->raw_damage;
             const auto& ws = static_cast<wf::stream_signal_t*>(data)->ws;
             const auto& target_fb = static_cast<wf::stream_signal_t*>(data)->fb;
 
+            if (background_only)
+            {
+                return;
+            }
+
+            wf::region_t needs_padding = (damage & blur_invalid) |
+                (damage ^ known_damage);
             wf::region_t expanded_damage =
-                expand_region(damage & get_blur_region(ws), target_fb.scale);
+                expand_region(needs_padding & get_blur_region(ws), target_fb.scale);
 
             /* Keep rects on screen */
             expanded_damage &= output->render->get_ws_box(ws);
@@ -359,10 +840,19 @@ class wayfire_blur : public wf::plugin_interface_t
             padded_region = get_fb_region(expanded_damage, target_fb) ^
                 get_fb_region(damage, target_fb);
 
+            /* This effectively makes damage the same as expanded_damage. */
+            damage |= expanded_damage;
+            known_damage |= expanded_damage;
+            if (padded_region.empty())
+            {
+                return;
+            }
+
+            /* Initialize a place to store padded region pixels. It only needs
+             * to hold the extents of padded_region. */
+            auto extents = wlr_box_from_pixman_box(padded_region.get_extents());
             OpenGL::render_begin(target_fb);
-            /* Initialize a place to store padded region pixels. */
-            saved_pixels.allocate(target_fb.viewport_width,
-                target_fb.viewport_height);
+            saved_pixels.allocate(extents.width, extents.height);
 
             /* Setup framebuffer I/O. target_fb contains the pixels
              * from last frame at this point. We are writing them
@@ -376,12 +866,11 @@ class wayfire_blur : public wf::plugin_interface_t
                 GL_CALL(glBlitFramebuffer(
                     box.x1, target_fb.viewport_height - box.y2,
                     box.x2, target_fb.viewport_height - box.y1,
-                    box.x1, box.y1, box.x2, box.y2,
+                    box.x1 - extents.x, box.y1 - extents.y,
+                    box.x2 - extents.x, box.y2 - extents.y,
                     GL_COLOR_BUFFER_BIT, GL_LINEAR));
             }
 
-            /* This effectively makes damage the same as expanded_damage. */
-            damage |= expanded_damage;
             GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
             OpenGL::render_end();
         };
@@ -396,6 +885,12 @@ class wayfire_blur : public wf::plugin_interface_t
         workspace_stream_post = [=] (wf::signal_data_t *data)
         {
             const auto& target_fb = static_cast<wf::stream_signal_t*>(data)->fb;
+            if (padded_region.empty())
+            {
+                return;
+            }
+
+            auto extents = wlr_box_from_pixman_box(padded_region.get_extents());
             OpenGL::render_begin(target_fb);
             /* Setup framebuffer I/O. target_fb contains the frame
              * rendered with expanded damage and artifacts on the edges.
@@ -406,7 +901,9 @@ class wayfire_blur : public wf::plugin_interface_t
             /* Copy pixels back from saved_pixels to target_fb. */
             for (const auto& box : padded_region)
             {
-                GL_CALL(glBlitFramebuffer(box.x1, box.y1, box.x2, box.y2,
+                GL_CALL(glBlitFramebuffer(
+                    box.x1 - extents.x, box.y1 - extents.y,
+                    box.x2 - extents.x, box.y2 - extents.y,
                     box.x1, target_fb.viewport_height - box.y2,
                     box.x2, target_fb.viewport_height - box.y1,
                     GL_COLOR_BUFFER_BIT, GL_LINEAR));
@@ -439,6 +936,9 @@ class wayfire_blur : public wf::plugin_interface_t
         output->disconnect_signal("view-attached", &view_attached);
         output->disconnect_signal("view-mapped", &view_attached);
         output->disconnect_signal("view-detached", &view_detached);
+        output->disconnect_signal("view-region-damaged", &view_damaged);
+        output->disconnect_signal("stack-order-changed", &stack_order_changed);
+        output->disconnect_signal("workspace-changed", &workspace_changed);
         output->render->rem_effect(&frame_pre_paint);
         output->render->disconnect_signal("workspace-stream-pre",
             &workspace_stream_pre);
@@ -448,6 +948,7 @@ class wayfire_blur : public wf::plugin_interface_t
         /* Call blur algorithm destructor */
         blur_algorithm = nullptr;
 
+        release_static_backgrounds();
         OpenGL::render_begin();
         saved_pixels.release();
         OpenGL::render_end();
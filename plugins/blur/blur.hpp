@@ -97,6 +97,20 @@ class wf_blur_base
      * view texture */
     OpenGL::program_t blend_program;
 
+    /* Handles to the uniforms and attributes of program[], registered by the
+     * base constructor. Algorithms only use the ones their shaders declare. */
+    struct program_handles_t
+    {
+        OpenGL::attrib_t position;
+        OpenGL::uniform_t offset, halfpixel, size, iterations;
+    } handles[2];
+
+    struct
+    {
+        OpenGL::attrib_t position;
+        OpenGL::uniform_t mvp, bg_texture, sat;
+    } blend_handles;
+
     /* used to get individual algorithm options from config
      * should be set by the constructor */
     std::string algorithm_name;
@@ -105,6 +119,7 @@ class wf_blur_base
     wf::option_wrapper_t<double> offset_opt;
     wf::option_wrapper_t<int> degrade_opt, iterations_opt;
     wf::config::option_base_t::updated_callback_t options_changed;
+    uint64_t generation = 0;
 
     wf::output_t *output;
 
@@ -130,11 +145,20 @@ class wf_blur_base
 
     virtual int calculate_blur_radius();
 
-    virtual void pre_render(wf::texture_t src_tex, wlr_box src_box,
-        const wf::region_t& damage, const wf::framebuffer_t& target_fb);
+    /* incremented whenever an option which changes the blurred result changes,
+     * so that cached results can be discarded */
+    uint64_t get_generation() const;
+
+    /* blur the pixels of source_fb in damage and store them in result, which has
+     * the size of src_box in framebuffer coords. The parts of result outside of
+     * damage are left untouched. */
+    virtual void pre_render(wlr_box src_box, const wf::region_t& damage,
+        const wf::framebuffer_t& source_fb, wf::framebuffer_base_t& result);
 
+    /* blend src_tex with the blurred background from pre_render() */
     virtual void render(wf::texture_t src_tex, wlr_box src_box,
-        wlr_box scissor_box, const wf::framebuffer_t& target_fb);
+        wlr_box scissor_box, const wf::framebuffer_t& target_fb,
+        const wf::framebuffer_base_t& background);
 };
 
 std::unique_ptr<wf_blur_base> create_box_blur(wf::output_t *output);
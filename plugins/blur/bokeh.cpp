@@ -59,10 +59,7 @@ class wf_bokeh_blur : public wf_blur_base
   public:
     wf_bokeh_blur(wf::output_t *output) : wf_blur_base(output, "bokeh")
     {
-        OpenGL::render_begin();
-        program[0].set_simple(OpenGL::compile_program(bokeh_vertex_shader,
-            bokeh_fragment_shader));
-        OpenGL::render_end();
+        program[0].set_simple_lazy(bokeh_vertex_shader, bokeh_fragment_shader);
     }
 
     int blur_fb0(const wf::region_t& blur_region, int width, int height) override
@@ -80,11 +77,11 @@ class wf_bokeh_blur : public wf_blur_base
         OpenGL::render_begin();
         /* Upload data to shader */
         program[0].use(wf::TEXTURE_TYPE_RGBA);
-        program[0].uniform2f("halfpixel", 0.5f / width, 0.5f / height);
-        program[0].uniform1f("offset", offset);
-        program[0].uniform1i("iterations", iterations);
+        program[0].uniform2f(handles[0].halfpixel, 0.5f / width, 0.5f / height);
+        program[0].uniform1f(handles[0].offset, offset);
+        program[0].uniform1i(handles[0].iterations, iterations);
 
-        program[0].attrib_pointer("position", 2, 0, vertexData);
+        program[0].attrib_pointer(handles[0].position, 2, 0, vertexData);
         GL_CALL(glDisable(GL_BLEND));
         render_iteration(blur_region, fb[0], fb[1], width, height);
 
@@ -76,12 +76,8 @@ class wf_box_blur : public wf_blur_base
 
     wf_box_blur(wf::output_t *output) : wf_blur_base(output, "box")
     {
-        OpenGL::render_begin();
-        program[0].set_simple(OpenGL::compile_program(
-            box_vertex_shader, box_fragment_shader_horz));
-        program[1].set_simple(OpenGL::compile_program(
-            box_vertex_shader, box_fragment_shader_vert));
-        OpenGL::render_end();
+        program[0].set_simple_lazy(box_vertex_shader, box_fragment_shader_horz);
+        program[1].set_simple_lazy(box_vertex_shader, box_fragment_shader_vert);
     }
 
     void upload_data(int i, int width, int height)
@@ -95,9 +91,9 @@ class wf_box_blur : public wf_blur_base
         };
 
         program[i].use(wf::TEXTURE_TYPE_RGBA);
-        program[i].uniform2f("size", width, height);
-        program[i].uniform1f("offset", offset);
-        program[i].attrib_pointer("position", 2, 0, vertexData);
+        program[i].uniform2f(handles[i].size, width, height);
+        program[i].uniform1f(handles[i].offset, offset);
+        program[i].attrib_pointer(handles[i].position, 2, 0, vertexData);
     }
 
     void blur(const wf::region_t& blur_region, int i, int width, int height)
@@ -63,12 +63,10 @@ class wf_kawase_blur : public wf_blur_base
     wf_kawase_blur(wf::output_t *output) :
         wf_blur_base(output, "kawase")
     {
-        OpenGL::render_begin();
-        program[0].set_simple(OpenGL::compile_program(kawase_vertex_shader,
-            kawase_fragment_shader_down));
-        program[1].set_simple(OpenGL::compile_program(kawase_vertex_shader,
-            kawase_fragment_shader_up));
-        OpenGL::render_end();
+        program[0].set_simple_lazy(kawase_vertex_shader,
+            kawase_fragment_shader_down);
+        program[1].set_simple_lazy(kawase_vertex_shader,
+            kawase_fragment_shader_up);
     }
 
     int blur_fb0(const wf::region_t& blur_region, int width, int height) override
@@ -89,11 +87,11 @@ class wf_kawase_blur : public wf_blur_base
         program[0].use(wf::TEXTURE_TYPE_RGBA);
 
         /* Downsample */
-        program[0].attrib_pointer("position", 2, 0, vertexData);
+        program[0].attrib_pointer(handles[0].position, 2, 0, vertexData);
         /* Disable blending, because we may have transparent background, which
          * we want to render on uncleared framebuffer */
         GL_CALL(glDisable(GL_BLEND));
-        program[0].uniform1f("offset", offset);
+        program[0].uniform1f(handles[0].offset, offset);
 
         for (int i = 0; i < iterations; i++)
         {
@@ -102,7 +100,7 @@ class wf_kawase_blur : public wf_blur_base
 
             auto region = blur_region * (1.0 / (1 << i));
 
-            program[0].uniform2f("halfpixel",
+            program[0].uniform2f(handles[0].halfpixel,
                 0.5f / sampleWidth, 0.5f / sampleHeight);
             render_iteration(region, fb[i % 2], fb[1 - i % 2], sampleWidth,
                 sampleHeight);
@@ -112,8 +110,8 @@ class wf_kawase_blur : public wf_blur_base
 
         /* Upsample */
         program[1].use(wf::TEXTURE_TYPE_RGBA);
-        program[1].attrib_pointer("position", 2, 0, vertexData);
-        program[1].uniform1f("offset", offset);
+        program[1].attrib_pointer(handles[1].position, 2, 0, vertexData);
+        program[1].uniform1f(handles[1].offset, offset);
         for (int i = iterations - 1; i >= 0; i--)
         {
             sampleWidth  = width / (1 << i);
@@ -121,7 +119,7 @@ class wf_kawase_blur : public wf_blur_base
 
             auto region = blur_region * (1.0 / (1 << i));
 
-            program[1].uniform2f("halfpixel",
+            program[1].uniform2f(handles[1].halfpixel,
                 0.5f / sampleWidth, 0.5f / sampleHeight);
             render_iteration(region, fb[1 - i % 2], fb[i % 2], sampleWidth,
                 sampleHeight);
@@ -24,6 +24,7 @@ static void cairo_surface_upload_to_texture(
     if (buffer.tex == (GLuint) - 1)
     {
         GL_CALL(glGenTextures(1, &buffer.tex));
+        OpenGL::invalidate_texture_cache();
     }
 
     auto src = cairo_image_surface_get_data(surface);
@@ -63,7 +63,7 @@ class ref_ptr_t
         update_use_count(-1);
     }
 
-    T*operator ->()
+    T*operator ->() const
     {
         return data;
     }
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <wayfire/plugins/common/cairo-util.hpp>
+#include <wayfire/plugins/common/shared-core-data.hpp>
+#include <wayfire/plugins/common/simple-texture.hpp>
+
+namespace wf
+{
+/**
+ * The parameters which determine how a text is rendered. Rendering the same
+ * key twice must result in the same texture.
+ */
+struct text_texture_key_t
+{
+    /** The name of the renderer, so that different users do not share textures */
+    std::string renderer;
+    std::string text;
+    /** The font description, in the format expected by the renderer */
+    std::string font;
+    int font_size = 0;
+    /** The size of the texture, or a limit on it, in pixels */
+    wf::dimensions_t size = {0, 0};
+    float scale = 1.0;
+    wf::color_t color    = {1.0, 1.0, 1.0, 1.0};
+    wf::color_t bg_color = {0.0, 0.0, 0.0, 0.0};
+    /** Any other parameters of the renderer */
+    uint64_t flags = 0;
+
+    bool operator ==(const text_texture_key_t& other) const
+    {
+        auto same_color = [] (const wf::color_t& a, const wf::color_t& b)
+        {
+            return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+        };
+
+        return renderer == other.renderer && text == other.text &&
+               font == other.font && font_size == other.font_size &&
+               size == other.size && scale == other.scale &&
+               same_color(color, other.color) &&
+               same_color(bg_color, other.bg_color) && flags == other.flags;
+    }
+
+    bool operator !=(const text_texture_key_t& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+/** A rendered text */
+struct text_texture_t : public noncopyable_t
+{
+    wf::simple_texture_t tex;
+    /** The size needed for the text, as returned by cairo_text_t::render_text() */
+    wf::dimensions_t text_size = {0, 0};
+};
+
+/**
+ * A cache of rendered texts, shared by all plugins with
+ * wf::shared_data::ref_ptr_t<wf::text_texture_cache_t>.
+ *
+ * Texts like titles are drawn every frame but rarely change, so they are
+ * rendered once and kept in the cache until the textures exceed the memory
+ * budget, in which case the least recently used ones are dropped. Textures
+ * stay valid for as long as the caller holds the returned pointer.
+ */
+class text_texture_cache_t
+{
+  public:
+    /** Render the text into the given texture */
+    using render_func_t = std::function<void (text_texture_t&)>;
+
+    /**
+     * Get the texture for the given key, rendering it with @render if it is
+     * not in the cache.
+     */
+    std::shared_ptr<const text_texture_t> get(const text_texture_key_t& key,
+        const render_func_t& render)
+    {
+        auto it = positions.find(key);
+        if (it != positions.end())
+        {
+            lru.splice(lru.begin(), lru, it->second);
+            return it->second->texture;
+        }
+
+        auto texture = std::make_shared<text_texture_t>();
+        render(*texture);
+
+        lru.push_front({key, texture});
+        positions[key] = lru.begin();
+        used_bytes    += get_size_bytes(*texture);
+        evict();
+
+        return texture;
+    }
+
+    /** Get the texture of a text rendered with cairo_text_t. */
+    std::shared_ptr<const text_texture_t> get_cairo_text(const std::string& text,
+        const wf::cairo_text_t::params& par)
+    {
+        text_texture_key_t key;
+        key.renderer  = "cairo-text";
+        key.text      = text;
+        key.font_size = par.font_size;
+        key.size     = par.max_size;
+        key.scale    = par.output_scale;
+        key.color    = par.text_color;
+        key.bg_color = par.bg_color;
+        key.flags    = par.bg_rect | (par.rounded_rect << 1) |
+            (par.exact_size << 2);
+
+        return get(key, [&] (text_texture_t& texture)
+        {
+            texture.text_size = wf::cairo_text_t::cairo_render_text_to_texture(
+                text, par, texture.tex);
+        });
+    }
+
+    /** Set the maximum size of the cached textures, in bytes */
+    void set_budget(size_t bytes)
+    {
+        budget_bytes = bytes;
+        evict();
+    }
+
+  private:
+    struct hash_t
+    {
+        size_t operator ()(const text_texture_key_t& key) const
+        {
+            size_t hash = std::hash<std::string>{}(key.text);
+            for (size_t value : {std::hash<std::string>{}(key.renderer),
+                std::hash<std::string>{}(key.font), size_t(key.font_size),
+                size_t(key.size.width), size_t(key.size.height),
+                size_t(key.flags)})
+            {
+                hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            }
+
+            return hash;
+        }
+    };
+
+    struct entry_t
+    {
+        text_texture_key_t key;
+        std::shared_ptr<text_texture_t> texture;
+    };
+
+    /* Most recently used first */
+    std::list<entry_t> lru;
+    std::unordered_map<text_texture_key_t, std::list<entry_t>::iterator,
+        hash_t> positions;
+
+    size_t used_bytes   = 0;
+    size_t budget_bytes = 16 << 20;
+
+    static size_t get_size_bytes(const text_texture_t& texture)
+    {
+        return 4ul * texture.tex.width * texture.tex.height;
+    }
+
+    /** Drop the least recently used textures until the budget is met */
+    void evict()
+    {
+        while ((used_bytes > budget_bytes) && (lru.size() > 1))
+        {
+            used_bytes -= get_size_bytes(*lru.back().texture);
+            positions.erase(lru.back().key);
+            lru.pop_back();
+        }
+    }
+};
+}
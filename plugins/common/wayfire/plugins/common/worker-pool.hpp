@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wf
+{
+/**
+ * A pool of persistent worker threads which plugins can use to split
+ * per-frame CPU work (for example particle simulation) into chunks.
+ *
+ * The pool is meant to be shared between all users in the compositor via
+ * wf::shared_data::ref_ptr_t<wf::worker_pool_t>, so that the threads are
+ * created once instead of every time work is submitted.
+ *
+ * The pool is not a general-purpose task queue: parallel_for() blocks until
+ * all chunks have been processed, and the calling thread takes part in the
+ * work as well.
+ */
+class worker_pool_t
+{
+  public:
+    /** A job processes the elements in the range [begin, end). */
+    using job_t = std::function<void (size_t begin, size_t end)>;
+
+    worker_pool_t()
+    {
+        int hw_threads = std::thread::hardware_concurrency();
+        for (int i = 1; i < hw_threads; i++)
+        {
+            workers.emplace_back([this] () { worker_main(); });
+        }
+    }
+
+    ~worker_pool_t()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            shutdown = true;
+        }
+
+        work_available.notify_all();
+        for (auto& w : workers)
+        {
+            w.join();
+        }
+    }
+
+    /** @return The number of threads which process jobs, including the caller. */
+    size_t get_concurrency() const
+    {
+        return workers.size() + 1;
+    }
+
+    /**
+     * Split the range [0, count) into at most get_concurrency() chunks of at
+     * least @min_chunk elements, and run @job on each of them in parallel.
+     *
+     * Returns once all chunks have been processed. @job must be thread-safe.
+     */
+    void parallel_for(size_t count, size_t min_chunk, const job_t& job)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        min_chunk = std::max<size_t>(min_chunk, 1);
+        size_t nr_chunks = std::min(get_concurrency(),
+            (count + min_chunk - 1) / min_chunk);
+        if (nr_chunks <= 1)
+        {
+            job(0, count);
+            return;
+        }
+
+        auto state = std::make_shared<job_state_t>();
+        state->job   = &job;
+        state->count = count;
+        state->chunk_size = (count + nr_chunks - 1) / nr_chunks;
+        state->nr_chunks  = (count + state->chunk_size - 1) / state->chunk_size;
+        state->remaining  = state->nr_chunks;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = state;
+            ++generation;
+        }
+
+        work_available.notify_all();
+        run_chunks(*state);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        work_done.wait(lock, [&] { return state->remaining == 0; });
+        current.reset();
+    }
+
+  private:
+    struct job_state_t
+    {
+        const job_t *job;
+        size_t count;
+        size_t chunk_size;
+        size_t nr_chunks;
+        std::atomic<size_t> next_chunk{0};
+        std::atomic<size_t> remaining;
+    };
+
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_done;
+    std::shared_ptr<job_state_t> current;
+    uint64_t generation = 0;
+    bool shutdown = false;
+
+    /*
+     * Claim and process chunks until none are left. A worker which wakes up
+     * late may see a job whose chunks have all been claimed already, in which
+     * case the job function is never touched.
+     */
+    void run_chunks(job_state_t& state)
+    {
+        size_t idx;
+        while ((idx = state.next_chunk.fetch_add(1)) < state.nr_chunks)
+        {
+            size_t begin = idx * state.chunk_size;
+            size_t end   = std::min(state.count, begin + state.chunk_size);
+            (*state.job)(begin, end);
+
+            if (--state.remaining == 0)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                work_done.notify_all();
+            }
+        }
+    }
+
+    void worker_main()
+    {
+        uint64_t last_generation = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            work_available.wait(lock, [&]
+            {
+                return shutdown || (generation != last_generation);
+            });
+
+            if (shutdown)
+            {
+                return;
+            }
+
+            last_generation = generation;
+            auto state = current;
+            lock.unlock();
+            if (state)
+            {
+                run_chunks(*state);
+            }
+
+            lock.lock();
+        }
+    }
+};
+}
@@ -7,6 +7,8 @@
 #include <wayfire/render-manager.hpp>
 #include <wayfire/workspace-stream.hpp>
 #include <wayfire/workspace-manager.hpp>
+#include <wayfire/option-wrapper.hpp>
+#include <list>
 
 namespace wf
 {
@@ -15,6 +17,11 @@ namespace wf
  *
  * Using this interface allows all plugins to use the same OpenGL textures for
  * the workspaces, thereby reducing the memory overhead of a workspace stream.
+ *
+ * Buffers are allocated when a stream is first updated. Buffers of stopped
+ * streams are kept for reuse as long as all buffers of the pool fit in
+ * core/stream_memory_budget, otherwise the least recently stopped ones are
+ * freed.
  */
 class workspace_stream_pool_t : public noncopyable_t, public wf::custom_data_t
 {
@@ -77,15 +84,24 @@ class workspace_stream_pool_t : public noncopyable_t, public wf::custom_data_t
      * Update the contents of the given workspace.
      *
      * If the workspace has not been started before, it will be started.
+     *
+     * @param scale The size at which the workspace is displayed, relative to
+     *   the output. The stream is rendered at the next power of two fraction
+     *   of the output size, so that the buffer is not resized on every frame
+     *   of an animation.
      */
-    void update(wf::point_t workspace)
+    void update(wf::point_t workspace, float scale = 1.0)
     {
         auto& stream = get(workspace);
+        idle.remove(workspace);
+
+        scale = quantize_scale(scale);
         if (stream.running)
         {
-            output->render->workspace_stream_update(stream);
+            output->render->workspace_stream_update(stream, scale, scale);
         } else
         {
+            stream.scale_x = stream.scale_y = scale;
             output->render->workspace_stream_start(stream);
         }
     }
@@ -99,6 +115,9 @@ class workspace_stream_pool_t : public noncopyable_t, public wf::custom_data_t
         if (stream.running)
         {
             output->render->workspace_stream_stop(stream);
+            idle.remove(workspace);
+            idle.push_front(workspace);
+            enforce_budget();
         }
     }
 
@@ -124,5 +143,55 @@ class workspace_stream_pool_t : public noncopyable_t, public wf::custom_data_t
 
     wf::output_t *output;
     std::vector<std::vector<wf::workspace_stream_t>> streams;
+
+    wf::option_wrapper_t<int> memory_budget{"core/stream_memory_budget"};
+    /* Stopped streams with a buffer, the most recently stopped first */
+    std::list<wf::point_t> idle;
+
+    static float quantize_scale(float scale)
+    {
+        float result = 1.0;
+        while ((result / 2 >= scale) && (result > 1.0 / 8))
+        {
+            result /= 2;
+        }
+
+        return result;
+    }
+
+    static size_t get_buffer_size(const wf::workspace_stream_t& stream)
+    {
+        if (stream.buffer.tex == (GLuint) - 1)
+        {
+            return 0;
+        }
+
+        return 4ul * stream.buffer.viewport_width * stream.buffer.viewport_height;
+    }
+
+    /** Free the buffers of idle streams until the pool fits in the budget */
+    void enforce_budget()
+    {
+        size_t used = 0;
+        for (auto& row : streams)
+        {
+            for (auto& stream : row)
+            {
+                used += get_buffer_size(stream);
+            }
+        }
+
+        size_t budget = std::max(0, (int)memory_budget) * (size_t(1) << 20);
+        OpenGL::render_begin();
+        while ((used > budget) && !idle.empty())
+        {
+            auto& stream = get(idle.back());
+            used -= get_buffer_size(stream);
+            stream.buffer.release();
+            idle.pop_back();
+        }
+
+        OpenGL::render_end();
+    }
 };
 }
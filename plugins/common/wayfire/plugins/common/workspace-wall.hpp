@@ -1,7 +1,9 @@
 #pragma once
 
 
+#include <cmath>
 #include <glm/gtc/matrix_transform.hpp>
+#include <wayfire/util.hpp>
 #include "workspace-stream-sharing.hpp"
 
 namespace wf
@@ -15,7 +17,14 @@ namespace wf
 struct wall_frame_event_t : public signal_data_t
 {
     const wf::framebuffer_t& target;
-    wall_frame_event_t(const wf::framebuffer_t& t) : target(t)
+    /**
+     * The region of the target which was repainted in this frame. Anything
+     * drawn on top of the wall should be limited to it.
+     */
+    wf::region_t damage;
+
+    wall_frame_event_t(const wf::framebuffer_t& t, wf::region_t d = {}) :
+        target(t), damage(d)
     {}
 };
 
@@ -32,6 +41,7 @@ class workspace_wall_t : public wf::signal_provider_t
     {
         this->viewport = get_wall_rectangle();
         streams = workspace_stream_pool_t::ensure_pool(output);
+        output->render->connect_signal("workspace-stream-post", &on_stream_post);
     }
 
     ~workspace_wall_t()
@@ -48,6 +58,7 @@ class workspace_wall_t : public wf::signal_provider_t
     void set_background_color(const wf::color_t& color)
     {
         this->background_color = color;
+        this->full_repaint     = true;
     }
 
     /**
@@ -58,7 +69,8 @@ class workspace_wall_t : public wf::signal_provider_t
      */
     void set_gap_size(int size)
     {
-        this->gap_size = size;
+        this->gap_size     = size;
+        this->full_repaint = true;
     }
 
     /**
@@ -90,7 +102,11 @@ class workspace_wall_t : public wf::signal_provider_t
             }
         }
 
-        this->viewport = viewport_geometry;
+        if (viewport_geometry != this->viewport)
+        {
+            this->viewport     = viewport_geometry;
+            this->full_repaint = true;
+        }
     }
 
     /**
@@ -102,29 +118,74 @@ class workspace_wall_t : public wf::signal_provider_t
      */
     void render_wall(const wf::framebuffer_t& fb, wf::geometry_t geometry)
     {
-        update_streams();
+        render_wall(fb, geometry, geometry);
+    }
 
-        OpenGL::render_begin(fb);
-        fb.logic_scissor(geometry);
+    /**
+     * Render the parts of the selected viewport which are damaged or which
+     * changed since the last call.
+     *
+     * @param fb The framebuffer to render on.
+     * @param geometry The rectangle in fb to draw to, in the same coordinate
+     *   system as the framebuffer's geometry.
+     * @param damage The region of fb which has to be repainted.
+     *
+     * @return The region of fb which was repainted.
+     */
+    wf::region_t render_wall(const wf::framebuffer_t& fb,
+        wf::geometry_t geometry, const wf::region_t& damage)
+    {
+        /* Workspaces are displayed at a fraction of their size when the
+         * viewport is larger than the target rectangle */
+        update_streams(std::max(1.0 * geometry.width / viewport.width,
+            1.0 * geometry.height / viewport.height));
+
+        wf::region_t repaint = damage;
+        if (full_repaint || (geometry != last_geometry) ||
+            (fb.geometry != last_fb_geometry))
+        {
+            repaint |= geometry;
+        } else
+        {
+            for (const auto& rect : stream_damage)
+            {
+                repaint |= wall_to_target(wlr_box_from_pixman_box(rect), geometry);
+            }
+        }
+
+        repaint &= geometry;
+        stream_damage.clear();
+        full_repaint     = false;
+        last_geometry    = geometry;
+        last_fb_geometry = fb.geometry;
 
-        OpenGL::clear(this->background_color);
         auto wall_matrix =
             calculate_viewport_transformation_matrix(this->viewport, geometry);
         /* After all transformations of the framebuffer, the workspace should
          * span the visible part of the OpenGL coordinate space. */
         const wf::geometry_t workspace_geometry = {-1, 1, 2, -2};
-        for (auto& ws : get_visible_workspaces(this->viewport))
+        auto visible = get_visible_workspaces(this->viewport);
+
+        OpenGL::render_begin(fb);
+        for (const auto& rect : repaint)
         {
-            auto ws_matrix = calculate_workspace_matrix(ws);
-            OpenGL::render_transformed_texture(
-                streams->get(ws).buffer.tex, workspace_geometry,
-                fb.get_orthographic_projection() * wall_matrix * ws_matrix);
+            fb.logic_scissor(wlr_box_from_pixman_box(rect));
+            OpenGL::clear(this->background_color);
+            for (auto& ws : visible)
+            {
+                auto ws_matrix = calculate_workspace_matrix(ws);
+                OpenGL::render_transformed_texture(
+                    streams->get(ws).buffer.tex, workspace_geometry,
+                    fb.get_orthographic_projection() * wall_matrix * ws_matrix);
+            }
         }
 
         OpenGL::render_end();
 
-        wall_frame_event_t data{fb};
+        wall_frame_event_t data{fb, repaint};
         this->emit_signal("frame", &data);
+
+        return repaint;
     }
 
     /**
@@ -135,8 +196,9 @@ class workspace_wall_t : public wf::signal_provider_t
     {
         if (!render_hook_set)
         {
-            this->output->render->set_renderer(on_render);
+            this->output->render->set_damage_renderer(on_render);
             render_hook_set = true;
+            full_repaint    = true;
         }
     }
 
@@ -204,11 +266,11 @@ class workspace_wall_t : public wf::signal_provider_t
     nonstd::observer_ptr<workspace_stream_pool_t> streams;
 
     /** Update or start visible streams */
-    void update_streams()
+    void update_streams(float scale)
     {
         for (auto& ws : get_visible_workspaces(viewport))
         {
-            streams->update(ws);
+            streams->update(ws, scale);
         }
     }
 
@@ -276,10 +338,58 @@ class workspace_wall_t : public wf::signal_provider_t
         return translation * scaling;
     }
 
+    /* Whether the whole wall has to be repainted in the next frame */
+    bool full_repaint = true;
+    wf::geometry_t last_geometry    = {0, 0, 0, 0};
+    wf::geometry_t last_fb_geometry = {0, 0, 0, 0};
+
+    /* Damage of the workspace streams since the last frame, in the coordinate
+     * system of the wall */
+    wf::region_t stream_damage;
+    wf::signal_connection_t on_stream_post = [=] (wf::signal_data_t *data)
+    {
+        auto ev = static_cast<wf::stream_signal_t*>(data);
+
+        /* The stream damage is relative to the current workspace */
+        auto cws  = output->workspace->get_current_workspace();
+        auto size = output->get_screen_size();
+        auto ws_rect = get_workspace_rectangle(ev->ws);
+        wf::point_t delta = {
+            ws_rect.x - (ev->ws.x - cws.x) * size.width,
+            ws_rect.y - (ev->ws.y - cws.y) * size.height,
+        };
+
+        for (const auto& rect : ev->raw_damage)
+        {
+            stream_damage |= wlr_box_from_pixman_box(rect) + delta;
+        }
+    };
+
+    /** Map a box in the coordinate system of the wall to the target rectangle */
+    wf::geometry_t wall_to_target(wf::geometry_t box,
+        const wf::geometry_t& target) const
+    {
+        const double scale_x = target.width * 1.0 / viewport.width;
+        const double scale_y = target.height * 1.0 / viewport.height;
+
+        /* Include one more pixel on each side, as the workspace textures are
+         * filtered when scaled */
+        int x1 = std::floor(target.x + (box.x - viewport.x) * scale_x) - 1;
+        int y1 = std::floor(target.y + (box.y - viewport.y) * scale_y) - 1;
+        int x2 = std::ceil(target.x +
+            (box.x + box.width - viewport.x) * scale_x) + 1;
+        int y2 = std::ceil(target.y +
+            (box.y + box.height - viewport.y) * scale_y) + 1;
+
+        return {x1, y1, x2 - x1, y2 - y1};
+    }
+
     bool render_hook_set = false;
-    wf::render_hook_t on_render = [=] (const wf::framebuffer_t& target)
+    wf::damage_render_hook_t on_render = [=] (const wf::framebuffer_t& target,
+                                              const wf::region_t& damage)
     {
-        render_wall(target, this->output->get_relative_geometry());
+        return render_wall(target, this->output->get_relative_geometry(),
+            damage);
     };
 };
 }
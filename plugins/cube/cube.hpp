@@ -8,6 +8,8 @@
 #include <wayfire/opengl.hpp>
 
 #define TEX_ERROR_FLAG_COLOR  0, 1, 0, 1
+/* Shown while the background image is still loading */
+#define TEX_LOADING_COLOR     0, 0, 0, 1
 
 using namespace wf::animation;
 
@@ -7,8 +7,9 @@
 
 #include "cubemap-shaders.tpp"
 
-wf_cube_background_cubemap::wf_cube_background_cubemap()
+wf_cube_background_cubemap::wf_cube_background_cubemap(wf::output_t *output)
 {
+    this->output = output;
     create_program();
     reload_texture();
 }
@@ -26,42 +27,37 @@ wf_cube_background_cubemap::~wf_cube_background_cubemap()
 void wf_cube_background_cubemap::create_program()
 {
     OpenGL::render_begin();
-    program.set_simple(
-        OpenGL::compile_program(cubemap_vertex, cubemap_fragment));
+    program.set_simple_lazy(cubemap_vertex, cubemap_fragment);
+    position_attrib = program.get_attrib("position");
+    cube_map_matrix_uniform = program.get_uniform("cubeMapMatrix");
+    GL_CALL(glGenBuffers(1, &vbo_cube_vertices));
+    GL_CALL(glGenBuffers(1, &ibo_cube_indices));
     OpenGL::render_end();
 }
 
 void wf_cube_background_cubemap::reload_texture()
 {
-    if (!last_background_image.compare(background_image))
+    if (last_background_image.compare(background_image))
     {
-        return;
+        /* The old image is displayed until the new one is loaded */
+        last_background_image = background_image;
+        loader.load(last_background_image, GL_TEXTURE_CUBE_MAP, [=] ()
+        {
+            output->render->schedule_redraw();
+        });
     }
 
-    last_background_image = background_image;
-
     OpenGL::render_begin();
-    if (tex == (uint32_t)-1)
-    {
-        GL_CALL(glGenTextures(1, &tex));
-        GL_CALL(glGenBuffers(1, &vbo_cube_vertices));
-        GL_CALL(glGenBuffers(1, &ibo_cube_indices));
-    }
-
-    GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, tex));
-    if (!image_io::load_from_file(last_background_image, GL_TEXTURE_CUBE_MAP))
-    {
-        LOGE("Failed to load cubemap background image from \"%s\".",
-            last_background_image.c_str());
-
-        GL_CALL(glDeleteTextures(1, &tex));
-        GL_CALL(glDeleteBuffers(1, &vbo_cube_vertices));
-        GL_CALL(glDeleteBuffers(1, &ibo_cube_indices));
-        tex = -1;
-    }
-
-    if (tex != (uint32_t)-1)
+    switch (loader.upload_step())
     {
+      case image_io::texture_loader_t::LOAD_DONE:
+        if (tex != (uint32_t)-1)
+        {
+            GL_CALL(glDeleteTextures(1, &tex));
+        }
+
+        tex = loader.take_texture();
+        GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, tex));
         GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER,
             GL_LINEAR));
         GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER,
@@ -72,9 +68,28 @@ void wf_cube_background_cubemap::reload_texture()
             GL_CLAMP_TO_EDGE));
         GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R,
             GL_CLAMP_TO_EDGE));
+        GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, 0));
+        break;
+
+      case image_io::texture_loader_t::LOAD_FAILED:
+        LOGE("Failed to load cubemap background image from \"%s\".",
+            last_background_image.c_str());
+        if (tex != (uint32_t)-1)
+        {
+            GL_CALL(glDeleteTextures(1, &tex));
+            tex = -1;
+        }
+
+        break;
+
+      case image_io::texture_loader_t::LOAD_UPLOADING:
+        output->render->schedule_redraw();
+        break;
+
+      default:
+        break;
     }
 
-    GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, 0));
     OpenGL::render_end();
 }
 
@@ -86,7 +101,14 @@ void wf_cube_background_cubemap::render_frame(const wf::framebuffer_t& fb,
     OpenGL::render_begin(fb);
     if (tex == (uint32_t)-1)
     {
-        GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
+        if (loader.is_loading())
+        {
+            GL_CALL(glClearColor(TEX_LOADING_COLOR));
+        } else
+        {
+            GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
+        }
+
         GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
         OpenGL::render_end();
 
@@ -131,10 +153,7 @@ void wf_cube_background_cubemap::render_frame(const wf::framebuffer_t& fb,
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices,
         GL_STATIC_DRAW);
 
-    GLint vertex = glGetAttribLocation(program.get_program_id(
-        wf::TEXTURE_TYPE_RGBA), "position");
-    glEnableVertexAttribArray(vertex);
-    glVertexAttribPointer(vertex, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    program.attrib_pointer(position_attrib, 3, 0, nullptr);
 
     auto model = glm::rotate(glm::mat4(1.0),
         float(attribs.cube_animation.rotation),
@@ -148,7 +167,7 @@ void wf_cube_background_cubemap::render_frame(const wf::framebuffer_t& fb,
     auto vp   = fb.transform * attribs.projection * view;
 
     model = vp * model;
-    program.uniformMatrix4f("cubeMapMatrix", model);
+    program.uniformMatrix4f(cube_map_matrix_uniform, model);
 
     glDrawElements(GL_TRIANGLES, 12 * 3, GL_UNSIGNED_SHORT, 0);
 
@@ -2,22 +2,29 @@
 #define WF_CUBE_CUBEMAP_HPP
 
 #include "cube-background.hpp"
+#include <wayfire/img.hpp>
+#include <wayfire/output.hpp>
 
 class wf_cube_background_cubemap : public wf_cube_background_base
 {
   public:
-    wf_cube_background_cubemap();
+    wf_cube_background_cubemap(wf::output_t *output);
     virtual void render_frame(const wf::framebuffer_t& fb,
         wf_cube_animation_attribs& attribs) override;
 
     ~wf_cube_background_cubemap();
 
   private:
+    wf::output_t *output;
+
     void reload_texture();
     void create_program();
 
     OpenGL::program_t program;
+    OpenGL::attrib_t position_attrib;
+    OpenGL::uniform_t cube_map_matrix_uniform;
     GLuint tex = -1;
+    image_io::texture_loader_t loader;
     GLuint vbo_cube_vertices;
     GLuint ibo_cube_indices;
 
@@ -29,42 +29,62 @@ wf_cube_background_skydome::~wf_cube_background_skydome()
 void wf_cube_background_skydome::load_program()
 {
     OpenGL::render_begin();
-    program.set_simple(OpenGL::compile_program(cube_vertex_2_0, cube_fragment_2_0));
+    program.set_simple_lazy(cube_vertex_2_0, cube_fragment_2_0);
+    position_attrib    = program.get_attrib("position");
+    uv_position_attrib = program.get_attrib("uvPosition");
+    vp_uniform    = program.get_uniform("VP");
+    model_uniform = program.get_uniform("model");
     OpenGL::render_end();
 }
 
 void wf_cube_background_skydome::reload_texture()
 {
-    if (!last_background_image.compare(background_image))
+    if (last_background_image.compare(background_image))
     {
-        return;
+        /* The old image is displayed until the new one is loaded */
+        last_background_image = background_image;
+        loader.load(last_background_image, GL_TEXTURE_2D, [=] ()
+        {
+            output->render->schedule_redraw();
+        });
     }
 
-    last_background_image = background_image;
     OpenGL::render_begin();
-
-    if (tex == (uint32_t)-1)
+    switch (loader.upload_step())
     {
-        GL_CALL(glGenTextures(1, &tex));
-    }
-
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
+      case image_io::texture_loader_t::LOAD_DONE:
+        if (tex != (uint32_t)-1)
+        {
+            GL_CALL(glDeleteTextures(1, &tex));
+        }
 
-    if (image_io::load_from_file(last_background_image, GL_TEXTURE_2D))
-    {
+        tex = loader.take_texture();
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-    } else
-    {
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+        break;
+
+      case image_io::texture_loader_t::LOAD_FAILED:
         LOGE("Failed to load skydome image from \"%s\".",
             last_background_image.c_str());
-        GL_CALL(glDeleteTextures(1, &tex));
-        tex = -1;
-    }
+        if (tex != (uint32_t)-1)
+        {
+            GL_CALL(glDeleteTextures(1, &tex));
+            tex = -1;
+        }
 
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+        break;
+
+      case image_io::texture_loader_t::LOAD_UPLOADING:
+        output->render->schedule_redraw();
+        break;
+
+      default:
+        break;
+    }
 
     OpenGL::render_end();
 }
@@ -130,15 +150,23 @@ void wf_cube_background_skydome::render_frame(const wf::framebuffer_t& fb,
     fill_vertices();
     reload_texture();
 
+    OpenGL::render_begin(fb);
     if (tex == (uint32_t)-1)
     {
-        GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
+        if (loader.is_loading())
+        {
+            GL_CALL(glClearColor(TEX_LOADING_COLOR));
+        } else
+        {
+            GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
+        }
+
         GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
+        OpenGL::render_end();
 
         return;
     }
 
-    OpenGL::render_begin(fb);
     program.use(wf::TEXTURE_TYPE_RGBA);
 
     auto rotation = glm::rotate(glm::mat4(1.0),
@@ -150,17 +178,17 @@ void wf_cube_background_skydome::render_frame(const wf::framebuffer_t& fb,
         glm::vec3(0., 1., 0.));
 
     auto vp = fb.transform * attribs.projection * view * rotation;
-    program.uniformMatrix4f("VP", vp);
+    program.uniformMatrix4f(vp_uniform, vp);
 
-    program.attrib_pointer("position", 3, 0, vertices.data());
-    program.attrib_pointer("uvPosition", 2, 0, coords.data());
+    program.attrib_pointer(position_attrib, 3, 0, vertices.data());
+    program.attrib_pointer(uv_position_attrib, 2, 0, coords.data());
 
     auto cws   = output->workspace->get_current_workspace();
     auto model = glm::rotate(glm::mat4(1.0),
         float(attribs.cube_animation.rotation) - cws.x * attribs.side_angle,
         glm::vec3(0, 1, 0));
 
-    program.uniformMatrix4f("model", model);
+    program.uniformMatrix4f(model_uniform, model);
 
     GL_CALL(glActiveTexture(GL_TEXTURE0));
     GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
@@ -3,6 +3,7 @@
 
 #include "cube-background.hpp"
 #include "wayfire/output.hpp"
+#include <wayfire/img.hpp>
 #include <vector>
 
 class wf_cube_background_skydome : public wf_cube_background_base
@@ -22,7 +23,10 @@ class wf_cube_background_skydome : public wf_cube_background_base
     void reload_texture();
 
     OpenGL::program_t program;
+    OpenGL::attrib_t position_attrib, uv_position_attrib;
+    OpenGL::uniform_t vp_uniform, model_uniform;
     GLuint tex = -1;
+    image_io::texture_loader_t loader;
 
     std::vector<GLfloat> vertices;
     std::vector<GLfloat> coords;
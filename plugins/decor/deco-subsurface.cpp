@@ -16,6 +16,7 @@
 #include "deco-theme.hpp"
 
 #include <wayfire/plugins/common/cairo-util.hpp>
+#include <wayfire/plugins/common/text-texture-cache.hpp>
 
 #include <cairo.h>
 
@@ -37,19 +38,25 @@ class simple_decoration_surface : public wf::surface_interface_t,
 
     void update_title(int width, int height, double scale)
     {
-        int target_width  = width * scale;
-        int target_height = height * scale;
+        wf::text_texture_key_t key;
+        key.renderer = "decoration-title";
+        key.text  = view->get_title();
+        key.font  = theme.get_font();
+        key.size  = {(int)(width * scale), (int)(height * scale)};
+        key.scale = scale;
+        if (title_texture.tex && (key == title_texture.key))
+        {
+            return;
+        }
 
-        if ((title_texture.tex.width != target_width) ||
-            (title_texture.tex.height != target_height) ||
-            (title_texture.current_text != view->get_title()))
+        title_texture.tex = text_cache->get(key, [&] (wf::text_texture_t& texture)
         {
-            auto surface = theme.render_text(view->get_title(),
-                target_width, target_height);
-            cairo_surface_upload_to_texture(surface, title_texture.tex);
+            auto surface = theme.render_text(key.text,
+                key.size.width, key.size.height);
+            cairo_surface_upload_to_texture(surface, texture.tex);
             cairo_surface_destroy(surface);
-            title_texture.current_text = view->get_title();
-        }
+        });
+        title_texture.key = std::move(key);
     }
 
     int width = 100, height = 100;
@@ -58,10 +65,12 @@ class simple_decoration_surface : public wf::surface_interface_t,
 
     struct
     {
-        wf::simple_texture_t tex;
-        std::string current_text = "";
+        std::shared_ptr<const wf::text_texture_t> tex;
+        wf::text_texture_key_t key;
     } title_texture;
 
+    wf::shared_data::ref_ptr_t<wf::text_texture_cache_t> text_cache;
+
     wf::decor::decoration_theme_t theme;
     wf::decor::decoration_layout_t layout;
     wf::region_t cached_region;
@@ -104,7 +113,7 @@ class simple_decoration_surface : public wf::surface_interface_t,
         wf::geometry_t geometry)
     {
         update_title(geometry.width, geometry.height, fb.scale);
-        OpenGL::render_texture(title_texture.tex.tex, fb, geometry,
+        OpenGL::render_texture(title_texture.tex->tex.tex, fb, geometry,
             glm::vec4(1.0f), OpenGL::TEXTURE_TRANSFORM_INVERT_Y);
     }
 
@@ -24,6 +24,11 @@ int decoration_theme_t::get_border_size() const
     return border_size;
 }
 
+std::string decoration_theme_t::get_font() const
+{
+    return font;
+}
+
 /**
  * Fill the given rectangle with the background color(s).
  *
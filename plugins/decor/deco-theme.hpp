@@ -20,6 +20,8 @@ class decoration_theme_t
     int get_title_height() const;
     /** @return The available border for resizing */
     int get_border_size() const;
+    /** @return The font of the title */
+    std::string get_font() const;
 
     /**
      * Fill the given rectangle with the background color(s).
@@ -39,6 +39,11 @@ void button_t::set_pressed(bool is_pressed)
     add_idle_damage();
 }
 
+void button_t::update_colours()
+{
+    add_idle_damage();
+}
+
 void button_t::render(const wf::framebuffer_t& fb, wf::geometry_t geometry,
     wf::geometry_t scissor, bool active)
 {
@@ -59,6 +59,9 @@ class button_t : public noncopyable_t
      */
     void set_pressed(bool is_pressed);
 
+    /** Redraw the button after the colours of the theme changed */
+    void update_colours();
+
     /**
      * Render the button on the given framebuffer at the given coordinates.
      * Precondition: set_button_type() has been called, otherwise result is no-op
@@ -16,6 +16,7 @@
 #include "deco-theme.hpp"
 
 #include <wayfire/plugins/common/cairo-util.hpp>
+#include <wayfire/plugins/common/text-texture-cache.hpp>
 
 #include <cairo.h>
 
@@ -39,26 +40,54 @@ class simple_decoration_surface : public wf::surface_interface_t,
 
     void update_title(int width, int height, int t_width, double scale)
     {
-        int target_width  = width * scale;
-        int target_height = height * scale;
-
-        auto surface = theme.render_text(view->get_title() + TITLE_SUFFIX,
-            target_width, target_height, t_width, active);
-        cairo_surface_upload_to_texture(surface, title_texture.tex);
-        cairo_surface_destroy(surface);
-        title_texture.current_text = view->get_title() + TITLE_SUFFIX;
+        wf::text_texture_key_t key;
+        key.renderer = "pixdecor-title";
+        key.text  = view->get_title() + TITLE_SUFFIX;
+        key.font  = theme.get_font();
+        key.size  = {(int)(width * scale), (int)(height * scale)};
+        key.scale = scale;
+        key.color = theme.get_text_colour(active);
+        key.flags = t_width;
+        if (title_texture.tex && (key == title_texture.key))
+        {
+            return;
+        }
+
+        title_texture.tex = text_cache->get(key, [&] (wf::text_texture_t& texture)
+        {
+            auto surface = theme.render_text(key.text,
+                key.size.width, key.size.height, t_width, active);
+            cairo_surface_upload_to_texture(surface, texture.tex);
+            cairo_surface_destroy(surface);
+        });
+        title_texture.key = std::move(key);
     }
 
+    wf::signal_connection_t on_colours_changed = [=] (wf::signal_data_t*)
+    {
+        for (auto item : layout.get_renderable_areas())
+        {
+            if (item->get_type() == wf::decor::DECORATION_AREA_BUTTON)
+            {
+                item->as_button().update_colours();
+            }
+        }
+
+        view->damage();
+    };
+
     int width = 100, height = 100;
 
     bool active = true; // when views are mapped, they are usually activated
 
     struct
     {
-        wf::simple_texture_t tex;
-        std::string current_text = "";
+        std::shared_ptr<const wf::text_texture_t> tex;
+        wf::text_texture_key_t key;
     } title_texture;
 
+    wf::shared_data::ref_ptr_t<wf::text_texture_cache_t> text_cache;
+
     wf::decor::decoration_theme_t theme;
     wf::decor::decoration_layout_t layout;
     wf::region_t cached_region;
@@ -71,6 +100,7 @@ class simple_decoration_surface : public wf::surface_interface_t,
         this->view = view;
         view->connect_signal("title-changed", &title_set);
         view->connect_signal("subsurface-removed", &on_subsurface_removed);
+        theme.connect_colours_changed(&on_colours_changed);
 
         /* This is really kludgy, but is invisible to the user...
          * If an application opens in a maximised state, before the window opens,
@@ -129,7 +159,7 @@ class simple_decoration_surface : public wf::surface_interface_t,
         wf::geometry_t geometry, int t_width)
     {
         update_title(geometry.width, geometry.height, t_width, fb.scale);
-        OpenGL::render_texture(title_texture.tex.tex, fb, geometry,
+        OpenGL::render_texture(title_texture.tex->tex.tex, fb, geometry,
             glm::vec4(1.0f), OpenGL::TEXTURE_TRANSFORM_INVERT_Y);
     }
 
@@ -1,116 +1,294 @@
 #include "deco-theme.hpp"
 #include <wayfire/core.hpp>
 #include <wayfire/opengl.hpp>
+#include <wayfire/util/log.hpp>
 #include <config.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <map>
+#include <sstream>
+#include <sys/eventfd.h>
 #include <sys/inotify.h>
+#include <unistd.h>
 
-int handle_theme_updated (int fd, uint32_t mask, void *data)
+namespace wf
+{
+namespace decor
 {
-    int bufsz = sizeof (inotify_event) + NAME_MAX + 1;
-    char buf[bufsz];
+/** The theme colours, with the name of their @define-color rule */
+static const std::pair<const char*, wf::color_t theme_colours_t::*> colour_names[] = {
+    {"theme_selected_bg_color", &theme_colours_t::fg},
+    {"theme_selected_fg_color", &theme_colours_t::fg_text},
+    {"theme_unfocused_bg_color", &theme_colours_t::bg},
+    {"theme_unfocused_fg_color", &theme_colours_t::bg_text},
+};
 
-    if ((mask & WL_EVENT_READABLE) == 0) return 0;
-    if (read (fd, buf, bufsz) < 0) return 0;
+/**
+ * Parse the rules of the form "@define-color name #rrggbb;" in the given CSS.
+ * Colours which are already in the map are not overwritten.
+ */
+static void parse_define_colors(const std::string& css,
+    std::map<std::string, wf::color_t>& result)
+{
+    static const std::string keyword = "@define-color";
 
-    (*((std::function<void (void)>*) data))();
+    size_t pos = 0;
+    while ((pos = css.find(keyword, pos)) != std::string::npos)
+    {
+        pos += keyword.size();
+        std::istringstream rule{css.substr(pos, css.find_first_of(";\n", pos) - pos)};
+
+        std::string name, value;
+        unsigned int r, g, b;
+        char end;
+        if (!(rule >> name >> value) || (value.size() != 7) || (value[0] != '#') ||
+            (sscanf (value.c_str(), "#%02x%02x%02x%c", &r, &g, &b, &end) != 3))
+        {
+            continue;
+        }
 
-    return 0;
+        result.emplace(name, wf::color_t{r / 255.0, g / 255.0, b / 255.0, 1.0});
+    }
 }
 
-namespace wf
+/**
+ * Read the colours from the GTK theme CSS files in the given data
+ * directories, in order of priority. In each directory, the files are read in
+ * alphabetical order, skipping dark variants.
+ */
+static theme_colours_t load_colours(const std::string& theme,
+    const std::vector<std::string>& data_dirs)
 {
-namespace decor
+    theme_colours_t colours;
+    std::vector<std::map<std::string, wf::color_t>> defined;
+    for (auto& data_dir : data_dirs)
+    {
+        std::filesystem::path dir =
+            std::filesystem::path{data_dir} / "themes" / theme / "gtk-3.0";
+
+        std::vector<std::filesystem::path> files;
+        std::error_code ec;
+        for (auto& entry : std::filesystem::directory_iterator{dir, ec})
+        {
+            auto name = entry.path().filename().string();
+            bool is_dark = name.size() >= 9 &&
+                name.compare(name.size() - 9, 9, "-dark.css") == 0;
+            if ((entry.path().extension() == ".css") && !is_dark)
+            {
+                files.push_back(entry.path());
+            }
+        }
+
+        std::sort(files.begin(), files.end());
+        defined.emplace_back();
+        for (auto& file : files)
+        {
+            std::ifstream in{file};
+            std::stringstream css;
+            css << in.rdbuf();
+            parse_define_colors(css.str(), defined.back());
+        }
+    }
+
+    for (auto& [name, colour] : colour_names)
+    {
+        for (auto& dir_colours : defined)
+        {
+            auto it = dir_colours.find(name);
+            if (it != dir_colours.end())
+            {
+                colours.*colour = it->second;
+                break;
+            }
+        }
+    }
+
+    return colours;
+}
+
+/** @return The directories in which GTK themes are searched, in order */
+static std::vector<std::string> get_theme_data_dirs()
 {
-/** Create a new theme with the default parameters */
-decoration_theme_t::decoration_theme_t()
+    return {g_get_user_data_dir (), "/usr/share"};
+}
+
+shared_theme_t::shared_theme_t()
 {
     gs = g_settings_new ("org.gnome.desktop.interface");
 
-    // set up the watch on the xsettings file
-    inotify_fd = inotify_init1 (IN_CLOEXEC);
-    evsrc = wl_event_loop_add_fd (wl_display_get_event_loop (wf::get_core ().display), inotify_fd, WL_EVENT_READABLE,
-        handle_theme_updated, &this->update_event);
+    char *theme = g_settings_get_string (gs, "gtk-theme");
+    colours = load_colours(theme, get_theme_data_dirs());
+    g_free (theme);
+    update_font();
+
+    auto event_loop = wl_display_get_event_loop (wf::get_core ().display);
+    loaded_fd     = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+    loaded_source = wl_event_loop_add_fd (event_loop, loaded_fd,
+        WL_EVENT_READABLE, handle_colours_loaded, this);
+
+    // watch for xsettingsd writing its configuration file
+    char *conf_dir = g_build_filename (g_get_user_config_dir (), "xsettingsd", NULL);
+    inotify_fd = inotify_init1 (IN_CLOEXEC | IN_NONBLOCK);
+    wd_cfg_dir = inotify_add_watch (inotify_fd, conf_dir,
+        IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd_cfg_dir < 0)
+    {
+        LOGD("Cannot watch ", conf_dir, ", theme changes will not be applied");
+    }
 
-    // read initial colours
-    update_colours ();
+    inotify_source = wl_event_loop_add_fd (event_loop, inotify_fd,
+        WL_EVENT_READABLE, handle_config_changed, this);
+    g_free (conf_dir);
+}
 
-    this->update_event = [=] (void)
+shared_theme_t::~shared_theme_t()
+{
+    if (loader.joinable())
     {
-        update_colours ();
-    };
+        loader.join();
+    }
+
+    wl_event_source_remove (inotify_source);
+    wl_event_source_remove (loaded_source);
+    close (inotify_fd);
+    close (loaded_fd);
+    g_object_unref (gs);
 }
 
-decoration_theme_t::~decoration_theme_t()
+GSettings *shared_theme_t::get_settings() const
 {
-    wl_event_source_remove (evsrc);
-    inotify_rm_watch (inotify_fd, wd_cfg_file);
-    inotify_rm_watch (inotify_fd, wd_cfg_dir);
-    close (inotify_fd);
+    return gs;
 }
 
-void decoration_theme_t::update_colours (void)
+const std::string& shared_theme_t::get_font() const
 {
-    if (!read_colour ("theme_selected_bg_color", fg)) fg = {0.13, 0.13, 0.13, 0.67};
-    if (!read_colour ("theme_selected_fg_color", fg_text)) fg_text = {1.0, 1.0, 1.0, 1.0};
-    if (!read_colour ("theme_unfocused_bg_color", bg)) bg = {0.2, 0.2, 0.2, 0.87};
-    if (!read_colour ("theme_unfocused_fg_color", bg_text)) bg_text = {1.0, 1.0, 1.0, 1.0};
-
-    // re-enable watches on xsettings file
-    char *conf_dir = g_build_filename (g_get_user_config_dir (), "xsettingsd/", NULL);
-    char *conf_file = g_build_filename (conf_dir, "xsettingsd.conf", NULL);
-    wd_cfg_dir = inotify_add_watch (inotify_fd, conf_dir, IN_CREATE);
-    wd_cfg_file = inotify_add_watch (inotify_fd, conf_file, IN_CLOSE_WRITE);
-    g_free (conf_file);
-    g_free (conf_dir);
+    return font;
 }
 
-gboolean decoration_theme_t::read_colour (const char *name, wf::color_t &col)
+void shared_theme_t::update_font()
 {
-    FILE *fp;
-    char *cmd, *line, *theme;
-    size_t len;
-    int i, n, ir, ig, ib;
+    char *font_name = g_settings_get_string (gs, "font-name");
+    font = font_name;
+    g_free (font_name);
+}
+
+const theme_colours_t& shared_theme_t::get_colours() const
+{
+    return colours;
+}
 
-    theme = g_settings_get_string (gs, "gtk-theme");
+void shared_theme_t::start_reload()
+{
+    if (loader.joinable())
+    {
+        /* Parse again once the running loader is done */
+        reload_pending = true;
+        return;
+    }
 
-    for (i = 0; i < 2; i++)
+    char *theme_name = g_settings_get_string (gs, "gtk-theme");
+    loader = std::thread([this, theme = std::string(theme_name),
+                          dirs = get_theme_data_dirs()] ()
     {
-        n = 0;
-        line = NULL;
-        len = 0;
-        cmd = g_strdup_printf ("bash -O extglob -c \"grep -hPo '(?<=@define-color\\s%s\\s)#[0-9A-Fa-f]{6}' %s/themes/%s/gtk-3.0/!(*-dark).css 2> /dev/null\"", name, i ? "/usr/share" : g_get_user_data_dir (), theme);
-        fp = popen (cmd, "r");
-        if (fp)
+        auto result = load_colours(theme, dirs);
         {
-            if (getline (&line, &len, fp) > 0)
-            {
-                n = sscanf (line, "#%02x%02x%02x", &ir, &ig, &ib);
-                g_free (line);
-            }
-            pclose (fp);
+            std::lock_guard<std::mutex> lock(loaded_mutex);
+            loaded = result;
+        }
+
+        uint64_t done = 1;
+        if (write (loaded_fd, &done, sizeof (done)) < 0)
+        {
+            LOGE("pixdecor: failed to signal the loaded theme ", theme, ": ",
+                strerror (errno));
         }
-        g_free (cmd);
+    });
+    g_free (theme_name);
+}
 
-        if (n == 3)
+int shared_theme_t::handle_config_changed(int fd, uint32_t mask, void *data)
+{
+    auto self = (shared_theme_t*) data;
+    char buf[sizeof (inotify_event) + NAME_MAX + 1]
+        __attribute__((aligned(alignof(inotify_event))));
+
+    bool changed = false;
+    ssize_t len;
+    while ((len = read (fd, buf, sizeof (buf))) > 0)
+    {
+        for (char *ptr = buf; ptr < buf + len;)
         {
-            col = { ir / 255.0, ig / 255.0, ib / 255.0, 1.0 };
-            g_free (theme);
-            return TRUE;
+            auto event = (inotify_event*) ptr;
+            changed |= event->len && !strcmp (event->name, "xsettingsd.conf");
+            ptr += sizeof (inotify_event) + event->len;
         }
     }
-    g_free (theme);
-    return FALSE;
+
+    if (changed)
+    {
+        self->start_reload();
+    }
+
+    return 0;
+}
+
+int shared_theme_t::handle_colours_loaded(int fd, uint32_t mask, void *data)
+{
+    auto self = (shared_theme_t*) data;
+    uint64_t count;
+    if (read (fd, &count, sizeof (count)) < 0)
+    {
+        return 0;
+    }
+
+    self->loader.join();
+    {
+        std::lock_guard<std::mutex> lock(self->loaded_mutex);
+        self->colours = self->loaded;
+    }
+
+    self->update_font();
+
+    self->emit_signal("colours-changed", nullptr);
+    if (self->reload_pending)
+    {
+        self->reload_pending = false;
+        self->start_reload();
+    }
+
+    return 0;
+}
+
+/** Create a new theme with the default parameters */
+decoration_theme_t::decoration_theme_t()
+{}
+
+decoration_theme_t::~decoration_theme_t()
+{}
+
+std::string decoration_theme_t::get_font() const
+{
+    return shared->get_font();
+}
+
+wf::color_t decoration_theme_t::get_text_colour(bool active) const
+{
+    return active ? shared->get_colours().fg_text : shared->get_colours().bg_text;
+}
+
+void decoration_theme_t::connect_colours_changed(wf::signal_connection_t *callback)
+{
+    shared->connect_signal("colours-changed", callback);
 }
 
 /** @return The available height for displaying the title */
 int decoration_theme_t::get_font_height_px() const
 {
-    char *font = g_settings_get_string (gs, "font-name");
-
-    PangoFontDescription *font_desc = pango_font_description_from_string (font);
+    PangoFontDescription *font_desc = pango_font_description_from_string (shared->get_font ().c_str ());
     int font_height = pango_font_description_get_size (font_desc);
-    g_free (font);
     if (!pango_font_description_get_size_is_absolute (font_desc))
     {
         font_height *= 4;
@@ -151,7 +329,8 @@ void decoration_theme_t::set_maximize (bool state)
 void decoration_theme_t::render_background(const wf::framebuffer_t& fb,
     wf::geometry_t rectangle, const wf::geometry_t& scissor, bool active) const
 {
-    wf::color_t color = active ? fg : bg;
+    auto& colours = shared->get_colours ();
+    wf::color_t color = active ? colours.fg : colours.bg;
     OpenGL::render_begin (fb);
     fb.logic_scissor (scissor);
     int border = maximized ? 0 : get_border_size ();
@@ -187,23 +366,22 @@ cairo_surface_t*decoration_theme_t::render_text(std::string text,
 
     PangoFontDescription *font_desc;
     PangoLayout *layout;
-    char *font = g_settings_get_string (gs, "font-name");
     int w, h;
 
     // render text
-    font_desc = pango_font_description_from_string (font);
+    font_desc = pango_font_description_from_string (shared->get_font ().c_str ());
 
     layout = pango_cairo_create_layout(cr);
     pango_layout_set_font_description(layout, font_desc);
     pango_layout_set_text(layout, text.c_str(), text.size());
-    cairo_set_source_rgba(cr, active ? fg_text.r : bg_text.r, active ? fg_text.g : bg_text.g, active ? fg_text.b : bg_text.b, 1);
+    auto& text_colour = active ? shared->get_colours ().fg_text : shared->get_colours ().bg_text;
+    cairo_set_source_rgba(cr, text_colour.r, text_colour.g, text_colour.b, 1);
     pango_layout_get_pixel_size (layout, &w, &h);
     cairo_translate (cr, (t_width - w) / 2, (height - h) / 2);
     pango_cairo_show_layout(cr, layout);
     pango_font_description_free(font_desc);
     g_object_unref(layout);
     cairo_destroy(cr);
-    g_free (font);
 
     return surface;
 }
@@ -219,9 +397,10 @@ cairo_surface_t *decoration_theme_t::get_button_surface(button_type_t button,
     float fr, fg, fb;
 
     // get the current text colour
-    fr = (active ? fg_text.r : bg_text.r) * 255.0;
-    fg = (active ? fg_text.g : bg_text.g) * 255.0;
-    fb = (active ? fg_text.b : bg_text.b) * 255.0;
+    auto& text = active ? shared->get_colours ().fg_text : shared->get_colours ().bg_text;
+    fr = text.r * 255.0;
+    fg = text.g * 255.0;
+    fb = text.b * 255.0;
     r = fr;
     g = fg;
     b = fb;
@@ -239,7 +418,7 @@ cairo_surface_t *decoration_theme_t::get_button_surface(button_type_t button,
                                         break;
     }
 
-    theme = g_settings_get_string (gs, "icon-theme");
+    theme = g_settings_get_string (shared->get_settings (), "icon-theme");
     iconfile = g_strdup_printf ("/usr/share/icons/%s/%s/ui/window-%s%s-symbolic.symbolic.png", theme,
         get_font_height_px () >= LARGE_ICON_THRESHOLD ? "24x24" : "16x16", icon_name, state.hover ? "-hover" : "-nohover");
     g_free (theme);
@@ -1,6 +1,9 @@
 #pragma once
 #include <gio/gio.h>
 #include <wayfire/render-manager.hpp>
+#include <wayfire/plugins/common/shared-core-data.hpp>
+#include <mutex>
+#include <thread>
 #include "deco-button.hpp"
 
 #define LARGE_ICON_THRESHOLD 20
@@ -11,6 +14,60 @@ namespace wf
 {
 namespace decor
 {
+/** The colours of the decorations, taken from the GTK theme */
+struct theme_colours_t
+{
+    wf::color_t fg = {0.13, 0.13, 0.13, 0.67};
+    wf::color_t bg = {0.2, 0.2, 0.2, 0.87};
+    wf::color_t fg_text = {1.0, 1.0, 1.0, 1.0};
+    wf::color_t bg_text = {1.0, 1.0, 1.0, 1.0};
+};
+
+/**
+ * The settings and colours shared by all decorations, held with
+ * wf::shared_data::ref_ptr_t.
+ *
+ * The colours are parsed from the @define-color rules of the GTK theme CSS.
+ * When xsettingsd writes its configuration, they are parsed again in a worker
+ * thread, and the new set replaces the old one on the main thread. Then the
+ * "colours-changed" signal is emitted.
+ */
+class shared_theme_t : public wf::signal_provider_t
+{
+  public:
+    shared_theme_t();
+    ~shared_theme_t();
+
+    /** @return The org.gnome.desktop.interface settings */
+    GSettings *get_settings() const;
+    /** @return The system font, read again when the theme is reloaded */
+    const std::string& get_font() const;
+    /** @return The current colours */
+    const theme_colours_t& get_colours() const;
+
+  private:
+    GSettings *gs;
+    std::string font;
+    theme_colours_t colours;
+
+    int inotify_fd;
+    int wd_cfg_dir;
+    wl_event_source *inotify_source;
+
+    /* The loader thread stores its result in loaded and writes to loaded_fd */
+    std::thread loader;
+    std::mutex loaded_mutex;
+    theme_colours_t loaded;
+    int loaded_fd;
+    wl_event_source *loaded_source;
+    bool reload_pending = false;
+
+    void update_font();
+    void start_reload();
+    static int handle_config_changed(int fd, uint32_t mask, void *data);
+    static int handle_colours_loaded(int fd, uint32_t mask, void *data);
+};
+
 /**
  * A  class which manages the outlook of decorations.
  * It is responsible for determining the background colors, sizes, etc.
@@ -29,8 +86,13 @@ class decoration_theme_t
     /** @return The available border for resizing */
     int get_border_size() const;
 
-    gboolean read_colour (const char *name, wf::color_t &col);
-    void update_colours (void);
+    /** @return The system font */
+    std::string get_font() const;
+    /** @return The colour of the title text */
+    wf::color_t get_text_colour(bool active) const;
+
+    /** Call the given callback after the colours of the theme change */
+    void connect_colours_changed(wf::signal_connection_t *callback);
 
     /**
      * Fill the given rectangle with the background color(s).
@@ -76,18 +138,8 @@ class decoration_theme_t
   private:
     wf::option_wrapper_t<int> border_size{"pixdecor/border_size"};
 
-    std::function<void (void)> update_event;
-
-    GSettings *gs;
-	wf::color_t fg;
-	wf::color_t bg;
-	wf::color_t fg_text;
-	wf::color_t bg_text;
+    wf::shared_data::ref_ptr_t<shared_theme_t> shared;
 	bool maximized;
-	int inotify_fd;
-	int wd_cfg_file;
-	int wd_cfg_dir;
-	wl_event_source *evsrc;
 };
 }
 }
@@ -4,6 +4,7 @@
 #include <wayfire/util/log.hpp>
 #include <wayfire/plugins/common/cairo-util.hpp>
 #include <wayfire/plugins/common/simple-texture.hpp>
+#include <wayfire/plugins/common/text-texture-cache.hpp>
 
 /**
  * Get the topmost parent of a view.
@@ -24,8 +25,9 @@ static wayfire_view find_toplevel_parent(wayfire_view view)
 struct view_title_texture_t : public wf::custom_data_t
 {
     wayfire_view view;
-    wf::cairo_text_t overlay;
+    std::shared_ptr<const wf::text_texture_t> overlay;
     wf::cairo_text_t::params par;
+    wf::shared_data::ref_ptr_t<wf::text_texture_cache_t> text_cache;
     bool overflow = false;
     wayfire_view dialog; /* the texture should be rendered on top of this dialog */
 
@@ -41,13 +43,13 @@ struct view_title_texture_t : public wf::custom_data_t
 
     void update_overlay_texture()
     {
-        auto res = overlay.render_text(view->get_title(), par);
-        overflow = res.width > overlay.tex.width;
+        overlay  = text_cache->get_cairo_text(view->get_title(), par);
+        overflow = overlay->text_size.width > overlay->tex.width;
     }
 
     wf::signal_connection_t view_changed = [this] (auto)
     {
-        if (overlay.tex.tex != (GLuint) - 1)
+        if (overlay)
         {
             update_overlay_texture();
         }
@@ -269,19 +271,19 @@ class view_title_overlay_t : public wf::scale_transformer_t::overlay_t
          * TODO: check if this wastes too high CPU power when views are being
          * animated and maybe redraw less frequently
          */
-        if ((tex.overlay.tex.tex == (GLuint) - 1) ||
+        if (!tex.overlay ||
             (output_scale != tex.par.output_scale) ||
-            (tex.overlay.tex.width > box.width * output_scale) ||
+            (tex.overlay->tex.width > box.width * output_scale) ||
             (tex.overflow &&
-             (tex.overlay.tex.width < std::floor(box.width * output_scale))))
+             (tex.overlay->tex.width < std::floor(box.width * output_scale))))
         {
             tex.par.output_scale = output_scale;
             tex.update_overlay_texture({box.width, box.height});
             ret = true;
         }
 
-        int w = tex.overlay.tex.width;
-        int h = tex.overlay.tex.height;
+        int w = tex.overlay->tex.width;
+        int h = tex.overlay->tex.height;
         int y = 0;
         switch (pos)
         {
@@ -353,14 +355,14 @@ class view_title_overlay_t : public wf::scale_transformer_t::overlay_t
         view_title_texture_t& title = get_overlay_texture(find_toplevel_parent(
             tr.get_transformed_view()));
 
-        GLuint tex = title.overlay.tex.tex;
-
-        if (tex == (GLuint) - 1)
+        if (!title.overlay)
         {
             /* this should not happen */
             return;
         }
 
+        GLuint tex = title.overlay->tex.tex;
+
         auto ortho = fb.get_orthographic_projection();
         OpenGL::render_begin(fb);
         for (const auto& box : damage)
@@ -381,10 +383,10 @@ class view_title_overlay_t : public wf::scale_transformer_t::overlay_t
         auto parent = find_toplevel_parent(view);
         auto& title = get_overlay_texture(parent);
 
-        if (title.overlay.tex.tex != (GLuint) - 1)
+        if (title.overlay)
         {
             text_height = (unsigned int)std::ceil(
-                title.overlay.tex.height / title.par.output_scale);
+                title.overlay->tex.height / title.par.output_scale);
         } else
         {
             text_height =
@@ -128,10 +128,7 @@ class wayfire_fisheye : public wf::plugin_interface_t
             }
         });
 
-        OpenGL::render_begin();
-        program.set_simple(
-            OpenGL::compile_program(vertex_shader, fragment_shader));
-        OpenGL::render_end();
+        program.set_simple_lazy(vertex_shader, fragment_shader);
     }
 
     wf::activator_callback toggle_cb = [=] (auto)
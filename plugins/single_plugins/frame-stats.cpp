@@ -0,0 +1,238 @@
+#include <wayfire/plugin.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/opengl.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/frame-profiler.hpp>
+#include <wayfire/util/log.hpp>
+#include <wayfire/plugins/common/cairo-util.hpp>
+#include <fstream>
+
+/**
+ * Shows the statistics of the frame profiler of the output in a corner, and
+ * dumps them to the log or to a file on request.
+ *
+ * The profiler records frames as long as the plugin is loaded.
+ */
+class wayfire_frame_stats : public wf::plugin_interface_t
+{
+    wf::option_wrapper_t<wf::activatorbinding_t> toggle_key{"frame-stats/toggle"};
+    wf::option_wrapper_t<wf::activatorbinding_t> dump_key{"frame-stats/dump"};
+    wf::option_wrapper_t<std::string> dump_file{"frame-stats/dump_file"};
+    wf::option_wrapper_t<int> refresh_interval{"frame-stats/refresh_interval"};
+    wf::option_wrapper_t<int> font_size{"frame-stats/font_size"};
+    wf::option_wrapper_t<wf::color_t> text_color{"frame-stats/text_color"};
+    wf::option_wrapper_t<wf::color_t> bg_color{"frame-stats/bg_color"};
+
+    static constexpr int margin  = 16;
+    static constexpr int padding = 8;
+
+    bool overlay_shown = false;
+    float output_scale = 1.0;
+    wf::geometry_t overlay_box = {0, 0, 0, 0};
+
+    struct text_line_t
+    {
+        wf::cairo_text_t text;
+        wf::geometry_t geometry;
+    };
+
+    std::vector<std::unique_ptr<text_line_t>> lines;
+
+    /* The overlay is refreshed periodically, so that showing it does not
+     * force every frame to be redrawn */
+    wf::wl_timer refresh_timer;
+    wf::effect_hook_t render_hook = [=] () { render(); };
+
+  public:
+    void init() override
+    {
+        grab_interface->name = "frame-stats";
+        grab_interface->capabilities = 0;
+
+        output->render->get_frame_profiler().set_active(true);
+        output->add_activator(toggle_key, &toggle_cb);
+        output->add_activator(dump_key, &dump_cb);
+    }
+
+    wf::activator_callback toggle_cb = [=] (auto)
+    {
+        if (overlay_shown)
+        {
+            hide_overlay();
+        } else
+        {
+            show_overlay();
+        }
+
+        return true;
+    };
+
+    wf::activator_callback dump_cb = [=] (auto)
+    {
+        std::string stats = "Frame statistics for " + output->to_string() +
+            ":\n" + output->render->get_frame_profiler().dump();
+
+        std::string file = dump_file;
+        if (file.empty())
+        {
+            LOGI(stats);
+            return true;
+        }
+
+        std::ofstream out{file, std::ios::app};
+        out << stats << std::endl;
+        if (!out)
+        {
+            LOGE("Failed to write frame statistics to ", file);
+        }
+
+        return true;
+    };
+
+    void show_overlay()
+    {
+        overlay_shown = true;
+        output->render->add_effect(&render_hook, wf::OUTPUT_EFFECT_OVERLAY);
+        update_overlay();
+        refresh_timer.set_timeout(std::max(int(refresh_interval), 50), [=] ()
+        {
+            update_overlay();
+            return true;
+        });
+    }
+
+    void hide_overlay()
+    {
+        overlay_shown = false;
+        refresh_timer.disconnect();
+        output->render->rem_effect(&render_hook);
+        output->render->damage(overlay_box);
+        lines.clear();
+    }
+
+    static std::string format_row(const std::string& name,
+        const wf::duration_histogram_t& histogram)
+    {
+        if (histogram.count == 0)
+        {
+            return name + ": n/a";
+        }
+
+        return name + ": avg " + std::to_string(histogram.average()) +
+               "  p99 " + std::to_string(histogram.percentile(99)) +
+               "  max " + std::to_string(histogram.max_us) + " us";
+    }
+
+    std::vector<std::string> get_stats_text()
+    {
+        auto& profiler = output->render->get_frame_profiler();
+        auto samples   = profiler.get_samples();
+
+        uint64_t scanout = 0, surfaces = 0, rects = 0, draw_calls = 0;
+        for (auto& sample : samples)
+        {
+            scanout    += sample.scanout;
+            surfaces   += sample.surfaces;
+            rects      += sample.damage_rects;
+            draw_calls += sample.draw_calls;
+        }
+
+        size_t nr_samples = std::max<size_t>(samples.size(), 1);
+        std::vector<std::string> text;
+        text.push_back(output->to_string() + ": " +
+            std::to_string(samples.size()) + " frames, " +
+            std::to_string(scanout) + " scanout");
+
+        for (int i = 0; i < wf::FRAME_STAGE_COUNT; i++)
+        {
+            auto stage = (wf::frame_stage_t)i;
+            text.push_back(format_row(wf::get_frame_stage_name(stage),
+                profiler.get_stage_histogram(stage)));
+        }
+
+        text.push_back(format_row("cpu", profiler.get_cpu_histogram()));
+        text.push_back(format_row("gpu", profiler.get_gpu_histogram()));
+        text.push_back(format_row("latency", profiler.get_latency_histogram()));
+        text.push_back("surfaces " + std::to_string(surfaces / nr_samples) +
+            "  rects " + std::to_string(rects / nr_samples) +
+            "  draws " + std::to_string(draw_calls / nr_samples));
+
+        return text;
+    }
+
+    /** Render the current statistics and damage the overlay. */
+    void update_overlay()
+    {
+        auto text = get_stats_text();
+        lines.resize(text.size());
+
+        wf::region_t damage = overlay_box;
+        int y = margin + padding;
+        int width = 0;
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            if (!lines[i])
+            {
+                lines[i] = std::make_unique<text_line_t>();
+            }
+
+            auto size = lines[i]->text.render_text(text[i],
+                wf::cairo_text_t::params(font_size, bg_color, text_color,
+                    output_scale, {0, 0}, false, true));
+
+            lines[i]->geometry = {
+                margin + padding, y,
+                (int)(size.width / output_scale),
+                (int)(size.height / output_scale)
+            };
+
+            y    += lines[i]->geometry.height;
+            width = std::max(width, lines[i]->geometry.width);
+        }
+
+        overlay_box = {margin, margin, width + 2 * padding, y + padding - margin};
+        damage |= overlay_box;
+        output->render->damage(damage);
+    }
+
+    void render()
+    {
+        auto fb = output->render->get_target_framebuffer();
+        if (fb.scale != output_scale)
+        {
+            output_scale = fb.scale;
+            update_overlay();
+        }
+
+        auto damage = output->render->get_scheduled_damage() & overlay_box;
+        auto ortho  = fb.get_orthographic_projection();
+
+        OpenGL::render_begin(fb);
+        for (auto& box : damage)
+        {
+            fb.logic_scissor(wlr_box_from_pixman_box(box));
+            OpenGL::render_rectangle(overlay_box, bg_color, ortho);
+            for (auto& line : lines)
+            {
+                OpenGL::render_texture(line->text.tex.tex, fb, line->geometry,
+                    glm::vec4(1.0), OpenGL::TEXTURE_TRANSFORM_INVERT_Y);
+            }
+        }
+
+        OpenGL::render_end();
+    }
+
+    void fini() override
+    {
+        if (overlay_shown)
+        {
+            hide_overlay();
+        }
+
+        output->render->get_frame_profiler().set_active(false);
+        output->rem_binding(&toggle_cb);
+        output->rem_binding(&dump_cb);
+    }
+};
+
+DECLARE_WAYFIRE_PLUGIN(wayfire_frame_stats);
@@ -59,6 +59,10 @@ class wayfire_invert_screen : public wf::plugin_interface_t
         grab_interface->name = "invert";
         grab_interface->capabilities = 0;
 
+        /* The hook only redraws damaged areas, so redraw everything when the
+         * effect itself changes */
+        preserve_hue.set_callback([=] () { output->render->damage_whole(); });
+
         hook = [=] (const wf::framebuffer_base_t& source,
                     const wf::framebuffer_base_t& destination)
         {
@@ -77,7 +81,7 @@ class wayfire_invert_screen : public wf::plugin_interface_t
                 output->render->rem_post(&hook);
             } else
             {
-                output->render->add_post(&hook);
+                output->render->add_post(&hook, wf::post_damage::per_pixel());
             }
 
             active = !active;
@@ -85,10 +89,7 @@ class wayfire_invert_screen : public wf::plugin_interface_t
             return true;
         };
 
-        OpenGL::render_begin();
-        program.set_simple(
-            OpenGL::compile_program(vertex_shader, fragment_shader));
-        OpenGL::render_end();
+        program.set_simple_lazy(vertex_shader, fragment_shader);
 
         output->add_activator(toggle_key, &toggle_cb);
     }
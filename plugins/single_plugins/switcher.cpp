@@ -138,11 +138,27 @@ class WayfireSwitcher : public wf::plugin_interface_t
         return handle_switch_request(1);
     };
 
+    /* Damage the whole output while the views are animated. The frame after
+     * the animation ends is damaged too, so that the renderer sees it end. */
+    bool was_animating = false;
     wf::effect_hook_t damage = [=] ()
     {
-        output->render->damage_whole();
+        bool animating = duration.running() ||
+            background_dim_duration.running();
+        if (animating || was_animating)
+        {
+            output->render->damage_whole();
+        }
+
+        was_animating = animating;
     };
 
+    void start_animation()
+    {
+        duration.start();
+        output->render->schedule_redraw();
+    }
+
     wf::signal_callback_t view_removed = [=] (wf::signal_data_t *data)
     {
         handle_view_removed(get_signaled_view(data));
@@ -233,8 +249,7 @@ class WayfireSwitcher : public wf::plugin_interface_t
         }
 
         output->render->add_effect(&damage, wf::OUTPUT_EFFECT_PRE);
-        output->render->set_renderer(switcher_renderer);
-        output->render->set_redraw_always();
+        output->render->set_damage_renderer(switcher_renderer);
 
         return true;
     }
@@ -246,7 +261,6 @@ class WayfireSwitcher : public wf::plugin_interface_t
 
         output->render->rem_effect(&damage);
         output->render->set_renderer(nullptr);
-        output->render->set_redraw_always(false);
 
         for (auto& view : output->workspace->get_views_in_layer(wf::ALL_LAYERS))
         {
@@ -430,7 +444,7 @@ class WayfireSwitcher : public wf::plugin_interface_t
         // clear views in case that deinit() hasn't been run
         views.clear();
 
-        duration.start();
+        start_animation();
         background_dim.set(1, background_dim_factor);
         background_dim_duration.start();
 
@@ -495,7 +509,7 @@ class WayfireSwitcher : public wf::plugin_interface_t
 
         background_dim.restart_with_end(1);
         background_dim_duration.start();
-        duration.start();
+        start_animation();
         active = false;
 
         /* Potentially restore view[0] if it was maximized */
@@ -559,7 +573,8 @@ class WayfireSwitcher : public wf::plugin_interface_t
         return sw;
     }
 
-    void render_view(const SwitcherView& sv, const wf::framebuffer_t& buffer)
+    void render_view(const SwitcherView& sv, const wf::framebuffer_t& buffer,
+        const wf::region_t& damage)
     {
         auto transform = dynamic_cast<wf::view_3D*>(
             sv.view->get_transformer(switcher_transformer).get());
@@ -576,30 +591,58 @@ class WayfireSwitcher : public wf::plugin_interface_t
             (float)sv.attribs.rotation, {0.0, 1.0, 0.0});
 
         transform->color[3] = sv.attribs.alpha;
-        sv.view->render_transformed(buffer, buffer.geometry);
+        sv.view->render_transformed(buffer, damage);
+    }
+
+    /* Whether a view is shown in more than one place. Its damage is then
+     * reported only for the place where it was rendered last. */
+    bool has_duplicate_views()
+    {
+        std::set<wayfire_view> seen;
+        for (auto& sv : views)
+        {
+            if (!seen.insert(sv.view).second)
+            {
+                return true;
+            }
+        }
+
+        return false;
     }
 
-    wf::render_hook_t switcher_renderer = [=] (const wf::framebuffer_t& fb)
+    wf::damage_render_hook_t switcher_renderer =
+        [=] (const wf::framebuffer_t& fb, const wf::region_t& damage)
     {
+        wf::region_t repaint = damage;
+        if (!repaint.empty() && has_duplicate_views())
+        {
+            repaint = fb.geometry;
+        }
+
         OpenGL::render_begin(fb);
-        OpenGL::clear({0, 0, 0, 1});
+        for (const auto& box : repaint)
+        {
+            fb.logic_scissor(wlr_box_from_pixman_box(box));
+            OpenGL::clear({0, 0, 0, 1});
+        }
+
         OpenGL::render_end();
 
         dim_background(background_dim);
         for (auto view : get_background_views())
         {
-            view->render_transformed(fb, fb.geometry);
+            view->render_transformed(fb, repaint);
         }
 
         /* Render in the reverse order because we don't use depth testing */
         for (auto& view : wf::reverse(views))
         {
-            render_view(view, fb);
+            render_view(view, fb, repaint);
         }
 
         for (auto view : get_overlay_views())
         {
-            view->render_transformed(fb, fb.geometry);
+            view->render_transformed(fb, repaint);
         }
 
         if (!duration.running())
@@ -611,6 +654,8 @@ class WayfireSwitcher : public wf::plugin_interface_t
                 deinit_switcher();
             }
         }
+
+        return repaint;
     };
 
     /* delete all views matching the given criteria, skipping the first "start" views
@@ -718,7 +763,7 @@ class WayfireSwitcher : public wf::plugin_interface_t
 
         rebuild_view_list();
         output->workspace->bring_to_front(views.front().view);
-        duration.start();
+        start_animation();
     }
 
     int count_different_active_views()
@@ -7,6 +7,7 @@
 #include <wayfire/plugins/common/view-change-viewport-signal.hpp>
 
 #include "tree-controller.hpp"
+#include "transaction.hpp"
 
 namespace wf
 {
@@ -58,6 +59,8 @@ class tile_plugin_t : public wf::plugin_interface_t
     wf::option_wrapper_t<int> outer_vert_gaps{"simple-tile/outer_vert_gap_size"};
 
   private:
+    /* Declared before the roots, so that it outlives their view nodes */
+    std::unique_ptr<wf::tile::transaction_manager_t> transactions;
     std::vector<std::vector<std::unique_ptr<wf::tile::tree_node_t>>> roots;
     std::vector<std::vector<nonstd::observer_ptr<wf::sublayer_t>>> tiled_sublayer;
 
@@ -249,7 +252,8 @@ class tile_plugin_t : public wf::plugin_interface_t
             vp = output->workspace->get_current_workspace();
         }
 
-        auto view_node = std::make_unique<wf::tile::view_node_t>(view);
+        auto view_node = std::make_unique<wf::tile::view_node_t>(view,
+            nonstd::make_observer(transactions.get()));
         roots[vp.x][vp.y]->as_split_node()->add_child(std::move(view_node));
         output->workspace->add_view_to_sublayer(view, tiled_sublayer[vp.x][vp.y]);
         output->workspace->bring_to_front(view); // bring that layer to the front
@@ -549,6 +553,7 @@ class tile_plugin_t : public wf::plugin_interface_t
          * their own, and should be able to have more than one */
         this->grab_interface->capabilities = CAPABILITY_MANAGE_COMPOSITOR;
 
+        transactions = std::make_unique<wf::tile::transaction_manager_t>(output);
         initialize_roots();
         // TODO: check whether this was successful
         output->workspace->set_workspace_implementation(
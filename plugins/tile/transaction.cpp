@@ -0,0 +1,150 @@
+#include "transaction.hpp"
+
+namespace wf
+{
+namespace tile
+{
+transaction_manager_t::transaction_manager_t(wf::output_t *output)
+{
+    this->output = output;
+    on_frame     = [=] ()
+    {
+        /* Wait until the transaction in flight has been applied */
+        if (in_flight.empty())
+        {
+            start_transaction();
+        }
+    };
+}
+
+transaction_manager_t::~transaction_manager_t()
+{
+    if (hook_set)
+    {
+        output->render->rem_effect(&on_frame);
+    }
+}
+
+void transaction_manager_t::set_geometry(view_node_t *node,
+    wf::geometry_t node_geometry, const gap_size_t& gaps)
+{
+    pending[node] = {node_geometry, gaps};
+    schedule_transaction();
+}
+
+void transaction_manager_t::remove_node(view_node_t *node)
+{
+    pending.erase(node);
+    if (in_flight.erase(node))
+    {
+        check_ready();
+    }
+}
+
+void transaction_manager_t::schedule_transaction()
+{
+    if (!hook_set)
+    {
+        output->render->add_effect(&on_frame, wf::OUTPUT_EFFECT_PRE);
+        hook_set = true;
+    }
+
+    output->render->schedule_redraw();
+}
+
+void transaction_manager_t::start_transaction()
+{
+    output->render->rem_effect(&on_frame);
+    hook_set = false;
+
+    /* Setting the geometry may already resize some views, but the transaction
+     * is complete only after all configures have been sent */
+    starting = true;
+    auto requests = std::move(pending);
+    pending.clear();
+    for (auto& [node, request] : requests)
+    {
+        auto view   = node->view;
+        auto target = node->calculate_target_geometry(
+            request.node_geometry, request.gaps);
+
+        in_flight_t entry;
+        entry.request     = request;
+        entry.old_size    = wf::dimensions(view->get_wm_geometry());
+        entry.target_size = wf::dimensions(target);
+        entry.ready = (entry.old_size == entry.target_size);
+        in_flight[node] = entry;
+
+        view->set_tiled(TILED_EDGES_ALL);
+        view->set_geometry(target);
+    }
+
+    starting = false;
+    if (in_flight.empty())
+    {
+        return;
+    }
+
+    timeout_timer.set_timeout(std::max(1, (int)timeout), [=] ()
+    {
+        apply_transaction();
+        return false;
+    });
+
+    check_ready();
+}
+
+void transaction_manager_t::handle_view_resized(view_node_t *node)
+{
+    auto it = in_flight.find(node);
+    if (it == in_flight.end())
+    {
+        return;
+    }
+
+    /* The client may pick a different size than the requested one, for ex.
+     * because of size hints, so any new size counts as an answer */
+    auto size = wf::dimensions(node->view->get_wm_geometry());
+    if ((size == it->second.target_size) || (size != it->second.old_size))
+    {
+        it->second.ready = true;
+        check_ready();
+    }
+}
+
+void transaction_manager_t::check_ready()
+{
+    if (starting)
+    {
+        return;
+    }
+
+    for (auto& [node, entry] : in_flight)
+    {
+        if (!entry.ready)
+        {
+            return;
+        }
+    }
+
+    apply_transaction();
+}
+
+void transaction_manager_t::apply_transaction()
+{
+    timeout_timer.disconnect();
+
+    auto applied = std::move(in_flight);
+    in_flight.clear();
+    for (auto& [node, entry] : applied)
+    {
+        node->show_geometry(entry.request.node_geometry, entry.request.gaps);
+    }
+
+    if (!pending.empty())
+    {
+        schedule_transaction();
+    }
+}
+}
+}
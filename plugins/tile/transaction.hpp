@@ -0,0 +1,88 @@
+#ifndef WF_TILE_PLUGIN_TRANSACTION_HPP
+#define WF_TILE_PLUGIN_TRANSACTION_HPP
+
+#include <map>
+#include <wayfire/output.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/option-wrapper.hpp>
+#include "tree.hpp"
+
+namespace wf
+{
+namespace tile
+{
+/**
+ * Collects the geometry changes of the tiled views on an output and applies
+ * them together, so that the layout does not tear while clients resize.
+ *
+ * Changes requested during a frame are sent to the clients at the start of
+ * the next frame, with at most one configure per view. The views are still
+ * displayed with their old geometry until all of them have committed a new
+ * size, or until a timeout. Then all new geometries are displayed at once,
+ * and views whose size does not match yet are scaled to their new box.
+ *
+ * Only one transaction is in flight at a time, so that slow clients are not
+ * sent more configures before they have handled the previous one.
+ */
+class transaction_manager_t
+{
+  public:
+    transaction_manager_t(wf::output_t *output);
+    ~transaction_manager_t();
+
+    /**
+     * Request a new geometry for the view of the node.
+     *
+     * @param node_geometry The geometry of the node, in the coordinate system
+     *   of the tiling trees.
+     * @param gaps The gaps of the node.
+     */
+    void set_geometry(view_node_t *node, wf::geometry_t node_geometry,
+        const gap_size_t& gaps);
+
+    /** Called when the size of the view of the node changes. */
+    void handle_view_resized(view_node_t *node);
+
+    /** Forget about the node, for ex. because it is being destroyed. */
+    void remove_node(view_node_t *node);
+
+  private:
+    wf::output_t *output;
+    wf::option_wrapper_t<int> timeout{"simple-tile/transaction_timeout"};
+
+    struct request_t
+    {
+        wf::geometry_t node_geometry;
+        gap_size_t gaps;
+    };
+
+    struct in_flight_t
+    {
+        request_t request;
+        /* The size of the view when the configure was sent */
+        wf::dimensions_t old_size;
+        wf::dimensions_t target_size;
+        bool ready;
+    };
+
+    /* Requests which will be sent with the next transaction */
+    std::map<view_node_t*, request_t> pending;
+    /* Requests which were sent to the clients and are not displayed yet */
+    std::map<view_node_t*, in_flight_t> in_flight;
+
+    bool hook_set = false;
+    bool starting = false;
+    wf::effect_hook_t on_frame;
+    void schedule_transaction();
+    void start_transaction();
+
+    wf::wl_timer timeout_timer;
+    /** Apply the transaction if all views are ready */
+    void check_ready();
+    /** Display the new geometries of the views in the transaction */
+    void apply_transaction();
+};
+}
+}
+
+#endif /* end of include guard: WF_TILE_PLUGIN_TRANSACTION_HPP */
@@ -1,4 +1,5 @@
 #include "tree.hpp"
+#include "transaction.hpp"
 #include <wayfire/util.hpp>
 #include <wayfire/util/log.hpp>
 
@@ -298,14 +299,28 @@ struct view_node_t::scale_transformer_t : public wf::view_2D
         this->translation_x = box.x - scaled_x;
         this->translation_y = box.y - scaled_y;
     }
+
+    bool get_matrix_transform(wf::geometry_t, glm::mat4& matrix,
+        glm::vec4& color) override
+    {
+        matrix = get_output_matrix();
+        color  = {1.0f, 1.0f, 1.0f, alpha};
+        return true;
+    }
 };
 
-view_node_t::view_node_t(wayfire_view view)
+view_node_t::view_node_t(wayfire_view view,
+    nonstd::observer_ptr<transaction_manager_t> transactions)
 {
     this->view = view;
+    this->transactions = transactions;
     view->store_data(std::make_unique<view_node_custom_data_t>(this));
 
-    this->on_geometry_changed   = [=] (wf::signal_data_t*) {update_transformer(); };
+    this->on_geometry_changed = [=] (wf::signal_data_t*)
+    {
+        update_transformer();
+        this->transactions->handle_view_resized(this);
+    };
     this->on_decoration_changed = [=] (wf::signal_data_t*)
     {
         set_geometry(geometry);
@@ -316,6 +331,7 @@ view_node_t::view_node_t(wayfire_view view)
 
 view_node_t::~view_node_t()
 {
+    transactions->remove_node(this);
     view->pop_transformer(scale_transformer_name);
     view->disconnect_signal("geometry-changed", &on_geometry_changed);
     view->disconnect_signal("decoration-changed", &on_decoration_changed);
@@ -334,18 +350,19 @@ void view_node_t::set_gaps(const gap_size_t& size)
     }
 }
 
-wf::geometry_t view_node_t::calculate_target_geometry()
+wf::geometry_t view_node_t::calculate_target_geometry(
+    wf::geometry_t node_geometry, const gap_size_t& node_gaps)
 {
     /* Calculate view geometry in coordinates local to the active workspace,
      * because tree coordinates are kept in workspace-agnostic coordinates. */
     auto output = view->get_output();
     auto local_geometry = get_output_local_coordinates(
-        view->get_output(), geometry);
+        view->get_output(), node_geometry);
 
-    local_geometry.x     += gaps.left;
-    local_geometry.y     += gaps.top;
-    local_geometry.width -= gaps.left + gaps.right;
-    local_geometry.height -= gaps.top + gaps.bottom;
+    local_geometry.x     += node_gaps.left;
+    local_geometry.y     += node_gaps.top;
+    local_geometry.width -= node_gaps.left + node_gaps.right;
+    local_geometry.height -= node_gaps.top + node_gaps.bottom;
 
     auto size = output->get_screen_size();
     /* If view is maximized, we want to use the full available geometry */
@@ -353,8 +370,8 @@ wf::geometry_t view_node_t::calculate_target_geometry()
     {
         auto vp = output->workspace->get_current_workspace();
 
-        int view_vp_x = std::floor(1.0 * geometry.x / size.width);
-        int view_vp_y = std::floor(1.0 * geometry.y / size.height);
+        int view_vp_x = std::floor(1.0 * node_geometry.x / size.width);
+        int view_vp_y = std::floor(1.0 * node_geometry.y / size.height);
 
         local_geometry = {
             (view_vp_x - vp.x) * size.width,
@@ -384,13 +401,20 @@ void view_node_t::set_geometry(wf::geometry_t geometry)
         return;
     }
 
-    view->set_tiled(TILED_EDGES_ALL);
-    view->set_geometry(calculate_target_geometry());
+    transactions->set_geometry(this, this->geometry, this->gaps);
+}
+
+void view_node_t::show_geometry(wf::geometry_t node_geometry,
+    const gap_size_t& node_gaps)
+{
+    this->shown_geometry = node_geometry;
+    this->shown_gaps     = node_gaps;
+    update_transformer();
 }
 
 void view_node_t::update_transformer()
 {
-    auto target_geometry = calculate_target_geometry();
+    auto target_geometry = calculate_target_geometry(shown_geometry, shown_gaps);
     if ((target_geometry.width <= 0) || (target_geometry.height <= 0))
     {
         return;
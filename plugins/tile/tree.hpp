@@ -17,6 +17,7 @@ namespace tile
  */
 struct split_node_t;
 struct view_node_t;
+class transaction_manager_t;
 
 struct gap_size_t
 {
@@ -142,7 +143,12 @@ struct split_node_t : public tree_node_t
  */
 struct view_node_t : public tree_node_t
 {
-    view_node_t(wayfire_view view);
+    /**
+     * @param transactions The transaction manager of the output, used to set
+     *   the geometry of the view.
+     */
+    view_node_t(wayfire_view view,
+        nonstd::observer_ptr<transaction_manager_t> transactions);
     ~view_node_t();
 
     wayfire_view view;
@@ -152,6 +158,9 @@ struct view_node_t : public tree_node_t
      * Note that the resulting view geometry will not always be equal to the
      * geometry of the node. For example, a fullscreen view will always have
      * the geometry of the whole output.
+     *
+     * The view is resized with the next transaction of the output, see
+     * transaction_manager_t.
      */
     void set_geometry(wf::geometry_t geometry) override;
 
@@ -164,12 +173,31 @@ struct view_node_t : public tree_node_t
     /* Return the tree node corresponding to the view, or nullptr if none */
     static nonstd::observer_ptr<view_node_t> get_node(wayfire_view view);
 
+    /**
+     * Calculate the geometry of the view in output-local coordinates, if the
+     * node has the given geometry and gaps.
+     */
+    wf::geometry_t calculate_target_geometry(wf::geometry_t node_geometry,
+        const gap_size_t& node_gaps);
+
+    /**
+     * Display the view in the box for the given node geometry and gaps. If the
+     * size of the view does not match yet, it is scaled to the box.
+     */
+    void show_geometry(wf::geometry_t node_geometry,
+        const gap_size_t& node_gaps);
+
   private:
+    nonstd::observer_ptr<transaction_manager_t> transactions;
+
+    /* The node geometry and gaps which the view is displayed with */
+    wf::geometry_t shown_geometry = {0, 0, 0, 0};
+    gap_size_t shown_gaps;
+
     struct scale_transformer_t;
     nonstd::observer_ptr<scale_transformer_t> transformer;
     signal_callback_t on_geometry_changed, on_decoration_changed;
 
-    wf::geometry_t calculate_target_geometry();
     void update_transformer();
 };
 
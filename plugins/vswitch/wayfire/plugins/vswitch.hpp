@@ -172,9 +172,13 @@ class workspace_switch_t
     wayfire_view overlay_view;
 
     bool running = false;
+    /* The region of the output repainted by the wall in the current frame */
+    wf::region_t frame_damage;
     wf::signal_connection_t on_frame = [=] (wf::signal_data_t *data)
     {
-        render_frame(static_cast<wall_frame_event_t*>(data)->target);
+        auto ev = static_cast<wall_frame_event_t*>(data);
+        frame_damage = ev->damage;
+        render_frame(ev->target);
     };
 
     virtual void render_overlay_view(const framebuffer_t& fb)
@@ -206,7 +210,7 @@ class workspace_switch_t
         auto all_views = overlay_view->enumerate_views();
         for (auto v : wf::reverse(all_views))
         {
-            v->render_transformed(fb, fb.geometry);
+            v->render_transformed(fb, frame_damage);
         }
     }
 
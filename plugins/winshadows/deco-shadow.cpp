@@ -1,14 +1,8 @@
 #include "deco-shadow.hpp"
 
 wf::winshadows::decoration_shadow_t::decoration_shadow_t() {
-    OpenGL::render_begin();
-    shadow_program.set_simple(
-        OpenGL::compile_program(shadow_vert_shader, shadow_frag_shader)
-    );
-    shadow_glow_program.set_simple(
-        OpenGL::compile_program(shadow_vert_shader, shadow_glow_frag_shader)
-    );
-    OpenGL::render_end();
+    shadow_program.set_simple_lazy(shadow_vert_shader, shadow_frag_shader);
+    shadow_glow_program.set_simple_lazy(shadow_vert_shader, shadow_glow_frag_shader);
 }
 
 wf::winshadows::decoration_shadow_t::~decoration_shadow_t() {
@@ -78,7 +78,6 @@ typedef struct _Model {
     Spring	 springs[MODEL_MAX_SPRINGS];
     int		 numSprings;
     Object	 *anchorObject;
-    float	 steps;
     Point	 topLeft;
     Point	 bottomRight;
 } Model;
@@ -268,7 +267,6 @@ static Model * createModel(int x, int y, int width, int height)
 
     model->anchorObject = 0;
     model->numSprings = 0;
-    model->steps = 0;
 
     modelInitObjects (model, x, y, width, height);
     modelInitSprings (model, width, height);
@@ -335,19 +333,12 @@ static float modelStepObject(Object *object, float friction, float *force)
     }
 }
 
-static int modelStep(Model *model, float friction, float k, float time)
+static int modelStep(Model *model, float friction, float k, int steps)
 {
-    int   i, j, steps, wobbly = 0;
+    int   i, j, wobbly = 0;
     float velocitySum = 0.0f;
     float force, forceSum = 0.0f;
 
-    model->steps += time / 15.0f;
-    steps = floor (model->steps);
-    model->steps -= steps;
-
-    if (!steps)
-        return 1;
-
     for (j = 0; j < steps; j++)
     {
         for (i = 0; i < model->numSprings; i++)
@@ -370,40 +361,6 @@ static int modelStep(Model *model, float friction, float k, float time)
     return wobbly;
 }
 
-static void bezierPatchEvaluate (Model *model, float u, float v,
-        float *patchX, float *patchY)
-{
-    float coeffsU[4], coeffsV[4];
-    float x, y;
-    int   i, j;
-
-    coeffsU[0] = (1 - u) * (1 - u) * (1 - u);
-    coeffsU[1] = 3 * u * (1 - u) * (1 - u);
-    coeffsU[2] = 3 * u * u * (1 - u);
-    coeffsU[3] = u * u * u;
-
-    coeffsV[0] = (1 - v) * (1 - v) * (1 - v);
-    coeffsV[1] = 3 * v * (1 - v) * (1 - v);
-    coeffsV[2] = 3 * v * v * (1 - v);
-    coeffsV[3] = v * v * v;
-
-    x = y = 0.0f;
-
-    for (i = 0; i < 4; i++)
-    {
-        for (j = 0; j < 4; j++)
-        {
-            x += coeffsU[i] * coeffsV[j] *
-                model->objects[j * GRID_WIDTH + i].position.x;
-            y += coeffsU[i] * coeffsV[j] *
-                model->objects[j * GRID_HEIGHT + i].position.y;
-        }
-    }
-
-    *patchX = x;
-    *patchY = y;
-}
-
 static int wobblyEnsureModel(struct wobbly_surface *surface)
 {
     WobblyWindow *ww = surface->ww;
@@ -511,7 +468,7 @@ static int modelRemoveEdgeAnchors(Model *model)
     return result;
 }
 
-void wobbly_prepare_paint(struct wobbly_surface *surface, int msSinceLastPaint)
+void wobbly_step(struct wobbly_surface *surface, int steps)
 {
     WobblyWindow *ww = surface->ww;
     float  friction, springK;
@@ -519,21 +476,16 @@ void wobbly_prepare_paint(struct wobbly_surface *surface, int msSinceLastPaint)
     friction = wobbly_settings_get_friction();
     springK  = wobbly_settings_get_spring_k();
 
-    if (ww->wobbly)
+    if (ww->wobbly & (WobblyInitial | WobblyVelocity | WobblyForce))
     {
-        if (ww->wobbly & (WobblyInitial | WobblyVelocity | WobblyForce))
-        {
-            ww->wobbly = modelStep(ww->model, friction, springK,
-                    (ww->wobbly & WobblyVelocity) ?
-                    msSinceLastPaint : 16);
-
-            if (ww->wobbly) {
-                modelCalcBounds(ww->model);
-            } else {
-                surface->x = ww->model->topLeft.x;
-                surface->y = ww->model->topLeft.y;
-                surface->synced = 1;
-            }
+        ww->wobbly = modelStep(ww->model, friction, springK, steps);
+
+        if (ww->wobbly) {
+            modelCalcBounds(ww->model);
+        } else {
+            surface->x = ww->model->topLeft.x;
+            surface->y = ww->model->topLeft.y;
+            surface->synced = 1;
         }
     }
 }
@@ -551,45 +503,18 @@ void wobbly_done_paint(struct wobbly_surface *surface)
 void wobbly_add_geometry(struct wobbly_surface *surface)
 {
     WobblyWindow *ww = surface->ww;
+    int i;
 
-    float    width, height;
-    float    deformedX, deformedY;
-    int      x, y, iw, ih;
-    float    cell_w, cell_h;
-    GLfloat  *v, *uv;
-
+    /* The patch itself is evaluated when rendering */
     if (ww->wobbly)
     {
-        width  = surface->width;
-        height = surface->height;
-
-        cell_w = width / surface->x_cells;
-        cell_h = height / surface->y_cells;
-
-        iw = surface->x_cells + 1;
-        ih = surface->y_cells + 1;
-
-        v = realloc(surface->v, sizeof(GLfloat) * 2 * iw * ih);
-        uv = realloc(surface->uv, sizeof(GLfloat) * 2 * iw * ih);
-
-        surface->v = v;
-        surface->uv = uv;
-
-        for (y = 0; y < ih; y++)
+        for (i = 0; i < GRID_WIDTH * GRID_HEIGHT; i++)
         {
-            for (x = 0; x < iw; x++)
-            {
-                bezierPatchEvaluate(ww->model,
-                        (x * cell_w) / width, (y * cell_h) / height,
-                        &deformedX, &deformedY);
-
-                *v++ = deformedX;
-                *v++ = deformedY;
-
-                *uv++ = (x * cell_w) / width;
-                *uv++ = 1.0 - ((y * cell_h) / height);
-            }
+            surface->control_points[2 * i] = ww->model->objects[i].position.x;
+            surface->control_points[2 * i + 1] = ww->model->objects[i].position.y;
         }
+
+        surface->has_control_points = 1;
     }
 }
 
@@ -753,7 +678,6 @@ void wobbly_fini(struct wobbly_surface *surface)
     {
         free(ww->model->objects);
         free(ww->model);
-        free(surface->v);
     }
 
     free (ww);
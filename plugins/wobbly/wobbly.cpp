@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <wayfire/plugin.hpp>
 #include <wayfire/signal-definitions.hpp>
 #include <wayfire/core.hpp>
@@ -16,17 +17,32 @@ namespace wobbly_graphics
 {
 namespace
 {
+/* The model is rendered as a static grid, which is deformed by evaluating
+ * the Bezier patch of the model in the vertex shader */
 const char *vertex_source =
     R"(
 #version 100
-attribute mediump vec2 position;
-attribute mediump vec2 uvPosition;
+attribute highp vec2 gridPosition;
 varying highp vec2 uvpos;
 uniform mat4 MVP;
 
+/* The x and y coordinates of the control points, indexed by [v][u] */
+uniform mat4 controlX;
+uniform mat4 controlY;
+
+vec4 bernstein(float t)
+{
+    float s = 1.0 - t;
+    return vec4(s * s * s, 3.0 * t * s * s, 3.0 * t * t * s, t * t * t);
+}
+
 void main() {
-    gl_Position = MVP * vec4(position.xy, 0.0, 1.0);
-    uvpos = uvPosition;
+    vec4 bu = bernstein(gridPosition.x);
+    vec4 bv = bernstein(gridPosition.y);
+    vec2 position = vec2(dot(bu, controlX * bv), dot(bu, controlY * bv));
+
+    gl_Position = MVP * vec4(position, 0.0, 1.0);
+    uvpos = vec2(gridPosition.x, 1.0 - gridPosition.y);
 }
 )";
 
@@ -46,8 +62,17 @@ void main()
 }
 
 OpenGL::program_t program;
+OpenGL::attrib_t grid_position_attrib;
+OpenGL::uniform_t mvp_uniform, control_x_uniform, control_y_uniform;
 int times_loaded = 0;
 
+/* The grid of the last used resolution, shared by all views */
+GLuint grid_vbo = 0, grid_ibo = 0;
+int grid_x_cells = 0, grid_y_cells = 0;
+
+/* Grid vertices are indexed with 16-bit integers */
+const int MAX_CELLS = 255;
+
 void load_program()
 {
     if (times_loaded++ > 0)
@@ -56,7 +81,11 @@ void load_program()
     }
 
     OpenGL::render_begin();
-    program.compile(vertex_source, frag_source);
+    program.compile_lazy(vertex_source, frag_source);
+    grid_position_attrib = program.get_attrib("gridPosition");
+    mvp_uniform = program.get_uniform("MVP");
+    control_x_uniform = program.get_uniform("controlX");
+    control_y_uniform = program.get_uniform("controlY");
     OpenGL::render_end();
 }
 
@@ -66,82 +95,172 @@ void destroy_program()
     {
         OpenGL::render_begin();
         program.free_resources();
+        if (grid_vbo)
+        {
+            GL_CALL(glDeleteBuffers(1, &grid_vbo));
+            GL_CALL(glDeleteBuffers(1, &grid_ibo));
+            grid_vbo = grid_ibo = 0;
+        }
+
         OpenGL::render_end();
     }
 }
 
 /**
- * Enumerate the needed triangles for rendering the model
+ * Upload the grid with the given number of cells, unless it is already
+ * uploaded. Requires bound opengl context.
  */
-void prepare_geometry(wobbly_surface *model, wf::geometry_t src_box,
-    std::vector<float>& vert, std::vector<float>& uv)
+void ensure_grid(int x_cells, int y_cells)
 {
-    float x = src_box.x, y = src_box.y, w = src_box.width, h = src_box.height;
-    std::vector<int> idx;
+    if (grid_vbo && (x_cells == grid_x_cells) && (y_cells == grid_y_cells))
+    {
+        return;
+    }
 
-    int per_row = model->x_cells + 1;
+    if (!grid_vbo)
+    {
+        GL_CALL(glGenBuffers(1, &grid_vbo));
+        GL_CALL(glGenBuffers(1, &grid_ibo));
+    }
 
-    for (int j = 0; j < model->y_cells; j++)
+    std::vector<float> vert;
+    for (int j = 0; j <= y_cells; j++)
     {
-        for (int i = 0; i < model->x_cells; i++)
+        for (int i = 0; i <= x_cells; i++)
         {
-            idx.push_back(i * per_row + j);
-            idx.push_back((i + 1) * per_row + j + 1);
-            idx.push_back(i * per_row + j + 1);
-
-            idx.push_back(i * per_row + j);
-            idx.push_back((i + 1) * per_row + j);
-            idx.push_back((i + 1) * per_row + j + 1);
+            vert.push_back(1.0f * i / x_cells);
+            vert.push_back(1.0f * j / y_cells);
         }
     }
 
-    if (!model->v || !model->uv)
+    std::vector<GLushort> idx;
+    int per_row = x_cells + 1;
+    for (int j = 0; j < y_cells; j++)
     {
-        for (auto id : idx)
+        for (int i = 0; i < x_cells; i++)
         {
-            float tile_w = w / model->x_cells;
-            float tile_h = h / model->y_cells;
+            idx.push_back(j * per_row + i);
+            idx.push_back((j + 1) * per_row + i + 1);
+            idx.push_back((j + 1) * per_row + i);
 
-            int i = id / per_row;
-            int j = id % per_row;
+            idx.push_back(j * per_row + i);
+            idx.push_back(j * per_row + i + 1);
+            idx.push_back((j + 1) * per_row + i + 1);
+        }
+    }
 
-            vert.push_back(i * tile_w + x);
-            vert.push_back(j * tile_h + y);
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, grid_vbo));
+    GL_CALL(glBufferData(GL_ARRAY_BUFFER, vert.size() * sizeof(float),
+        vert.data(), GL_STATIC_DRAW));
+    GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, grid_ibo));
+    GL_CALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(GLushort),
+        idx.data(), GL_STATIC_DRAW));
 
-            uv.push_back(1.0f * i / model->x_cells);
-            uv.push_back(1.0f - 1.0f * j / model->y_cells);
-        }
-    } else
+    grid_x_cells = x_cells;
+    grid_y_cells = y_cells;
+}
+
+/**
+ * Get the control points of the model, or, if it has not been deformed yet,
+ * control points which map the grid linearly to @src_box.
+ */
+void get_control_points(wobbly_surface *model, wf::geometry_t src_box,
+    glm::mat4& control_x, glm::mat4& control_y)
+{
+    for (int j = 0; j < 4; j++)
     {
-        for (auto i : idx)
+        for (int i = 0; i < 4; i++)
         {
-            vert.push_back(model->v[2 * i]);
-            vert.push_back(model->v[2 * i + 1]);
-
-            uv.push_back(model->uv[2 * i]);
-            uv.push_back(model->uv[2 * i + 1]);
+            if (model->has_control_points)
+            {
+                control_x[j][i] = model->control_points[2 * (j * 4 + i)];
+                control_y[j][i] = model->control_points[2 * (j * 4 + i) + 1];
+            } else
+            {
+                control_x[j][i] = src_box.x + src_box.width * i / 3.0f;
+                control_y[j][i] = src_box.y + src_box.height * j / 3.0f;
+            }
         }
     }
 }
 
 /* Requires bound opengl context */
-void render_triangles(wf::texture_t tex, glm::mat4 mat, float *pos, float *uv,
-    int cnt)
+void render_model(wf::texture_t tex, glm::mat4 mat, wobbly_surface *model,
+    wf::geometry_t src_box)
 {
+    glm::mat4 control_x, control_y;
+    get_control_points(model, src_box, control_x, control_y);
+
+    ensure_grid(model->x_cells, model->y_cells);
     program.use(tex.type);
     program.set_active_texture(tex);
 
-    program.attrib_pointer("position", 2, 0, pos);
-    program.attrib_pointer("uvPosition", 2, 0, uv);
-    program.uniformMatrix4f("MVP", mat);
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, grid_vbo));
+    GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, grid_ibo));
+    program.attrib_pointer(grid_position_attrib, 2, 0, nullptr);
+    program.uniformMatrix4f(mvp_uniform, mat);
+    program.uniformMatrix4f(control_x_uniform, control_x);
+    program.uniformMatrix4f(control_y_uniform, control_y);
 
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
 
-    GL_CALL(glDrawArrays(GL_TRIANGLES, 0, 3 * cnt));
+    GL_CALL(glDrawElements(GL_TRIANGLES, 6 * model->x_cells * model->y_cells,
+        GL_UNSIGNED_SHORT, nullptr));
     GL_CALL(glDisable(GL_BLEND));
 
     program.deactivate();
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+}
+}
+
+namespace wobbly_physics
+{
+/* The models are always advanced in steps of this length */
+const uint32_t STEP_MS = 15;
+/* The maximal number of steps at once, for ex. after a stalled frame */
+const int MAX_STEPS = 8;
+
+/* The models of all wobbly views, on all outputs */
+std::vector<wobbly_surface*> models;
+uint32_t last_step = 0;
+
+void add_model(wobbly_surface *model)
+{
+    if (models.empty())
+    {
+        /* Do a step on the first frame */
+        last_step = wf::get_current_time() - STEP_MS;
+    }
+
+    models.push_back(model);
+}
+
+void remove_model(wobbly_surface *model)
+{
+    models.erase(std::remove(models.begin(), models.end(), model), models.end());
+}
+
+/**
+ * Advance all models by the number of whole steps since the last call.
+ * The physics thus do not depend on the refresh rate, and calling it again
+ * in the same frame, for ex. for another view, does nothing.
+ */
+void advance()
+{
+    uint32_t now = wf::get_current_time();
+    int steps    = (now - last_step) / STEP_MS;
+    if (steps == 0)
+    {
+        return;
+    }
+
+    last_step += steps * STEP_MS;
+    for (auto model : models)
+    {
+        wobbly_step(model, std::min(steps, MAX_STEPS));
+    }
 }
 }
 
@@ -592,7 +711,6 @@ class wf_wobbly : public wf::view_transformer_t
 
     std::unique_ptr<wobbly_surface> model;
     std::unique_ptr<wf::iwobbly_state_t> state;
-    uint32_t last_frame;
 
     void init_model()
     {
@@ -607,12 +725,13 @@ class wf_wobbly : public wf::view_transformer_t
         model->grabbed = 0;
         model->synced  = 1;
 
-        model->x_cells = wobbly_settings::resolution;
-        model->y_cells = wobbly_settings::resolution;
+        model->x_cells = wf::clamp((int)wobbly_settings::resolution,
+            1, wobbly_graphics::MAX_CELLS);
+        model->y_cells = model->x_cells;
 
-        model->v  = NULL;
-        model->uv = NULL;
+        model->has_control_points = 0;
         wobbly_init(model.get());
+        wobbly_physics::add_model(model.get());
     }
 
   public:
@@ -620,7 +739,6 @@ class wf_wobbly : public wf::view_transformer_t
     {
         this->view = view;
         init_model();
-        last_frame = wf::get_current_time();
 
         pre_hook = [=] () { update_model(); };
         view->get_output()->render->add_effect(&pre_hook, wf::OUTPUT_EFFECT_PRE);
@@ -679,12 +797,10 @@ class wf_wobbly : public wf::view_transformer_t
         state->handle_frame();
         view->connect_signal("geometry-changed", &this->view_geometry_changed);
 
-        /* Update all the wobbly model */
-        auto now = wf::get_current_time();
-        wobbly_prepare_paint(model.get(), now - last_frame);
+        /* Update all the wobbly models */
+        wobbly_physics::advance();
 
         /* Update wobbly geometry */
-        last_frame = now;
         wobbly_add_geometry(model.get());
         wobbly_done_paint(model.get());
         view->damage();
@@ -701,12 +817,8 @@ class wf_wobbly : public wf::view_transformer_t
         OpenGL::render_begin(target_fb);
         target_fb.logic_scissor(scissor_box);
 
-        std::vector<float> vert, uv;
-        wobbly_graphics::prepare_geometry(model.get(), src_box, vert, uv);
-        wobbly_graphics::render_triangles(src_tex,
-            target_fb.get_orthographic_projection(),
-            vert.data(), uv.data(),
-            model->x_cells * model->y_cells * 2);
+        wobbly_graphics::render_model(src_tex,
+            target_fb.get_orthographic_projection(), model.get(), src_box);
 
         OpenGL::render_end();
     }
@@ -864,6 +976,7 @@ class wf_wobbly : public wf::view_transformer_t
     virtual ~wf_wobbly()
     {
         state = nullptr;
+        wobbly_physics::remove_model(model.get());
         wobbly_fini(model.get());
 
         if (view->get_output())
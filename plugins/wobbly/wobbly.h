@@ -41,9 +41,11 @@ struct wobbly_surface
    int x, y, width, height;
    int x_cells, y_cells;
    int grabbed, synced;
-   int vertex_count;
 
-   GLfloat *v, *uv;
+   /* The 4x4 control points of the Bezier patch, as x, y pairs in row-major
+    * order, valid if has_control_points is set */
+   GLfloat control_points[2 * 16];
+   int has_control_points;
 };
 
 struct wobbly_rect
@@ -64,7 +66,7 @@ void wobbly_ungrab_notify(struct wobbly_surface *surface);
 void wobbly_scale(struct wobbly_surface *surface, double dx, double dy);
 void wobbly_resize(struct wobbly_surface *surface, int width, int height);
 void wobbly_move_notify(struct wobbly_surface *surface, int x, int y);
-void wobbly_prepare_paint(struct wobbly_surface *surface, int msSinceLastPaint);
+void wobbly_step(struct wobbly_surface *surface, int steps);
 void wobbly_done_paint(struct wobbly_surface *surface);
 void wobbly_add_geometry(struct wobbly_surface *surface);
 struct wobbly_rect wobbly_boundingbox(struct wobbly_surface *surface);
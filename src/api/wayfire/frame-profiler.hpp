@@ -0,0 +1,135 @@
+#ifndef WF_FRAME_PROFILER_HPP
+#define WF_FRAME_PROFILER_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace wf
+{
+/** The stages of repainting an output, in the order in which they happen. */
+enum frame_stage_t
+{
+    /* Running OUTPUT_EFFECT_PRE and OUTPUT_EFFECT_DAMAGE hooks */
+    FRAME_STAGE_EFFECTS     = 0,
+    /* Trying to scan out a view directly */
+    FRAME_STAGE_SCANOUT     = 1,
+    /* Drawing the scene, or running the custom renderer of a plugin */
+    FRAME_STAGE_RENDER      = 2,
+    /* Running OUTPUT_EFFECT_OVERLAY hooks */
+    FRAME_STAGE_OVERLAY     = 3,
+    /* Running post hooks */
+    FRAME_STAGE_POSTPROCESS = 4,
+    /* Drawing software cursors */
+    FRAME_STAGE_CURSORS     = 5,
+    /* Swapping buffers and running OUTPUT_EFFECT_POST hooks */
+    FRAME_STAGE_SWAP        = 6,
+    /* Number of stages, not a real stage */
+    FRAME_STAGE_COUNT       = 7,
+};
+
+/** @return A short human-readable name of the stage. */
+const char *get_frame_stage_name(frame_stage_t stage);
+
+/**
+ * Measurements of a single frame. Durations are in microseconds, and -1 if
+ * they are not known (yet).
+ */
+struct frame_sample_t
+{
+    /** CPU time spent in each stage. Skipped stages take no time. */
+    std::array<int64_t, FRAME_STAGE_COUNT> stage_us;
+    /** CPU time spent on the whole frame. */
+    int64_t cpu_us = 0;
+    /** GPU time for the frame, if timer queries are supported. */
+    int64_t gpu_us = -1;
+    /** Time from the start of the frame until it was presented. */
+    int64_t latency_us = -1;
+
+    /** Whether the frame was scanned out directly. */
+    bool scanout = false;
+    /** The number of surfaces which were drawn. */
+    uint32_t surfaces = 0;
+    /** The number of rectangles in the damage which was swapped. */
+    uint32_t damage_rects = 0;
+    /** The number of draw calls by the OpenGL helpers in core. */
+    uint32_t draw_calls = 0;
+};
+
+/**
+ * A histogram of durations, with a bucket for each power of two
+ * microseconds.
+ */
+struct duration_histogram_t
+{
+    static constexpr int NR_BUCKETS = 24;
+    /* Bucket i counts the durations in [2^i, 2^(i+1)) microseconds, bucket 0
+     * also counts shorter ones */
+    std::array<uint32_t, NR_BUCKETS> buckets = {};
+
+    uint32_t count   = 0;
+    int64_t total_us = 0;
+    int64_t max_us   = 0;
+
+    /** Add a duration to the histogram. Negative (unknown) ones are ignored. */
+    void add(int64_t us);
+
+    /** @return The average duration, or 0 if the histogram is empty. */
+    int64_t average() const;
+
+    /**
+     * @return An upper bound for the given percentile (between 0 and 100),
+     *   which is the upper limit of the bucket containing it.
+     */
+    int64_t percentile(double p) const;
+};
+
+/**
+ * The frame profiler records how long each stage of repainting an output
+ * takes, together with some statistics about what was drawn.
+ *
+ * It keeps the samples of the most recent frames, so that the histograms
+ * always describe the current configuration. Recording is off by default,
+ * and is active while at least one user requests it via set_active().
+ */
+class frame_profiler_t
+{
+  public:
+    /** The number of frames which are kept. */
+    static constexpr size_t HISTORY_SIZE = 512;
+
+    frame_profiler_t();
+    ~frame_profiler_t();
+
+    /**
+     * Request recording, or drop a previous request. Calls are counted, so
+     * each set_active(true) should be matched by a set_active(false).
+     */
+    void set_active(bool active);
+
+    /** @return Whether samples are being recorded. */
+    bool is_active() const;
+
+    /** @return The recorded samples, from the oldest to the newest one. */
+    std::vector<frame_sample_t> get_samples() const;
+
+    /** @return A histogram of the CPU time of a stage in recent frames. */
+    duration_histogram_t get_stage_histogram(frame_stage_t stage) const;
+    /** @return A histogram of the CPU time of recent frames. */
+    duration_histogram_t get_cpu_histogram() const;
+    /** @return A histogram of the GPU time of recent frames. */
+    duration_histogram_t get_gpu_histogram() const;
+    /** @return A histogram of the presentation latency of recent frames. */
+    duration_histogram_t get_latency_histogram() const;
+
+    /** @return A multi-line human-readable summary of the recent frames. */
+    std::string dump() const;
+
+    class impl;
+    std::unique_ptr<impl> priv;
+};
+}
+
+#endif /* end of include guard: WF_FRAME_PROFILER_HPP */
@@ -2,15 +2,102 @@
 #define IMG_HPP_
 
 #include <GLES2/gl2.h>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace image_io
 {
+/** An image decoded into CPU memory */
+struct image_t
+{
+    int width  = 0;
+    int height = 0;
+    /* 3 for RGB, 4 for RGBA */
+    int channels = 4;
+    /* Tightly packed rows, from top to bottom */
+    std::vector<uint8_t> pixels;
+};
+
 /* Load the image from the given file, binding it to the given GL texture target
  * Bind the texture before you call this function
  * Guaranteed: doesn't change any GL state except pixel packing */
 bool load_from_file(std::string name, GLuint target);
 
+/**
+ * Decode the given file into CPU memory.
+ *
+ * Decoded images are kept in a small cache, keyed by the path and the
+ * modification time of the file, so loading the same file again is cheap.
+ *
+ * @return The decoded image, or null if the file could not be decoded.
+ */
+std::shared_ptr<const image_t> decode_file(std::string name);
+
+/**
+ * Loads an image file into a new GL texture without blocking the compositor.
+ *
+ * The file is decoded on a worker thread. Afterwards, each call to
+ * upload_step() uploads a band of rows, so that large images are spread over
+ * several frames. The texture is handed over only once it is complete.
+ */
+class texture_loader_t
+{
+  public:
+    texture_loader_t();
+    ~texture_loader_t();
+
+    enum status_t
+    {
+        /* Nothing to load */
+        LOAD_IDLE,
+        /* The file is being decoded */
+        LOAD_DECODING,
+        /* Parts of the image still have to be uploaded */
+        LOAD_UPLOADING,
+        /* The texture is complete, see take_texture() */
+        LOAD_DONE,
+        /* The file could not be loaded */
+        LOAD_FAILED,
+    };
+
+    /**
+     * Start loading the file, cancelling any load in progress.
+     *
+     * @param target GL_TEXTURE_2D, or GL_TEXTURE_CUBE_MAP for an image with
+     *   the cube faces in a 4x3 cross layout.
+     * @param on_decoded Called from the event loop when a file decoded on
+     *   the worker thread is ready to be uploaded.
+     */
+    void load(std::string name, GLuint target, std::function<void()> on_decoded);
+
+    /**
+     * Upload the next band of the image, if it has been decoded. Must be
+     * called between OpenGL::render_begin() and OpenGL::render_end().
+     *
+     * LOAD_DONE and LOAD_FAILED are returned only once, after that the loader
+     * is idle again.
+     */
+    status_t upload_step();
+
+    /** @return Whether a file is being decoded or uploaded. */
+    bool is_loading() const;
+
+    /**
+     * Get the texture completed by the last upload_step(). The caller takes
+     * ownership of the texture.
+     *
+     * @return The texture, or 0 if there is none.
+     */
+    GLuint take_texture();
+
+    class impl;
+
+  private:
+    std::unique_ptr<impl> priv;
+};
+
 /* Function that saves the given pixels(in rgba format) to a (currently) png file */
 void write_to_file(std::string name, uint8_t *pixels, int w, int h,
     std::string type);
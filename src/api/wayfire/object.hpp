@@ -22,6 +22,25 @@ struct signal_data_t
 using signal_callback_t = std::function<void (signal_data_t*)>;
 class signal_provider_t;
 
+/**
+ * Signal names are interned to small integer IDs. Connecting to and emitting
+ * a signal by its ID avoids hashing and copying the name, so hot paths should
+ * look up the ID once and reuse it, for ex.:
+ *
+ *   static const wf::signal_id_t motion = wf::get_signal_id("pointer_motion");
+ *   wf::get_core().emit_signal(motion, &data);
+ *
+ * Connecting or emitting by name and by ID can be freely mixed.
+ */
+using signal_id_t = uint32_t;
+
+/** @return The ID of the signal with the given name, the same on each call. */
+signal_id_t get_signal_id(const std::string& name);
+
+/** @return The name of the signal with the given ID. The reference stays valid
+ * for the lifetime of the compositor. */
+const std::string& get_signal_name(signal_id_t id);
+
 /**
  * Provides an interface to connect to signal providers.
  *
@@ -67,8 +86,10 @@ class signal_provider_t
 {
   public:
     /** Register a connection to be called when the given signal is emitted. */
-    void connect_signal(std::string name, signal_connection_t *callback);
-    /** Unregister a connection. */
+    void connect_signal(signal_id_t id, signal_connection_t *callback);
+    /** Same as connect_signal(get_signal_id(name), callback). */
+    void connect_signal(const std::string& name, signal_connection_t *callback);
+    /** Unregister a connection from all signals of this provider. */
     void disconnect_signal(signal_connection_t *callback);
 
     /**
@@ -82,8 +103,13 @@ class signal_provider_t
      */
     void disconnect_signal(std::string name, signal_callback_t *callback);
 
-    /** Emit the given signal. No type checking for data is required */
-    void emit_signal(std::string name, signal_data_t *data);
+    /**
+     * Emit the given signal. No type checking for data is required.
+     * Does not allocate, and returns early if nothing is connected.
+     */
+    void emit_signal(signal_id_t id, signal_data_t *data);
+    /** Same as emit_signal(get_signal_id(name), data). */
+    void emit_signal(const std::string& name, signal_data_t *data);
 
     virtual ~signal_provider_t();
 
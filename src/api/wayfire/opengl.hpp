@@ -208,6 +208,11 @@ enum rendering_flags_t
      * This allows re-use of uniform values for different damage rectangles.
      */
     RENDER_FLAG_CACHED         = (1 << 3),
+    /*
+     * Use GL_NEAREST for texture magnification. The previous filter of the
+     * texture is restored afterwards. Only supported by batch_texture().
+     */
+    RENDER_FLAG_NEAREST_MAG_FILTER = (1 << 4),
 };
 
 /**
@@ -272,6 +277,16 @@ void render_texture(wf::texture_t texture,
  */
 void draw_cached();
 
+/**
+ * Forget the texture parameters cached by the rendering functions.
+ *
+ * GL reuses the names of deleted textures, so this has to be called after
+ * creating a texture with glGenTextures(), otherwise the new texture may
+ * keep the default filter of GL. Textures of framebuffer_base_t do this
+ * automatically.
+ */
+void invalidate_texture_cache();
+
 /**
  * Clear the cached state.
  *
@@ -279,6 +294,51 @@ void draw_cached();
  */
 void clear_cached();
 
+/**
+ * Queue a textured quad for batched rendering with the built-in shaders.
+ *
+ * Instead of scissoring, the quad is clipped against each rectangle of
+ * @damage on the CPU. Queued quads are accumulated in a single vertex buffer,
+ * and consecutive quads with the same texture and color are drawn with a
+ * single draw call when the batch is flushed.
+ *
+ * Quads are only accumulated between begin_batch() and end_batch(), outside
+ * of such a scope they are drawn right away. Within the scope, the batch is
+ * flushed by flush_batch(), by render_begin(), by the last end_batch(), and
+ * when a quad for a different framebuffer is queued. Therefore, this function
+ * does not need to be called inside a render_begin/end() block, and the
+ * texture must stay valid until the batch is flushed.
+ *
+ * @param texture   The texture to render.
+ * @param fb        The framebuffer to render onto.
+ * @param geometry  The geometry of the quad to render, in the same coordinate
+ *                    system as the framebuffer geometry.
+ * @param damage    The region to render, in the same coordinate system as
+ *                    @geometry.
+ * @param color     A color multiplier for each channel of the texture.
+ * @param bits      A bitwise OR of texture_rendering_flags_t. TEX_GEOMETRY
+ *                    and CACHED are ignored.
+ */
+void batch_texture(wf::texture_t texture,
+    const wf::framebuffer_t& framebuffer,
+    const wf::geometry_t& geometry,
+    const wf::region_t& damage,
+    glm::vec4 color = glm::vec4(1.f),
+    uint32_t bits   = 0);
+
+/** Draw all quads queued with batch_texture(). */
+void flush_batch();
+
+/**
+ * Start accumulating the quads of batch_texture() instead of drawing them
+ * right away. Scopes can be nested, each call must be matched by end_batch().
+ */
+void begin_batch();
+
+/** End a scope started by begin_batch(), flushing the batch if it was the
+ * outermost one. */
+void end_batch();
+
 /* Compiles the given shader source */
 GLuint compile_shader(std::string source, GLuint type);
 
@@ -287,6 +347,10 @@ GLuint compile_shader(std::string source, GLuint type);
  *
  * @param vertex_source The source code of the vertex shader.
  * @param frag_source The source code of the fragment shader.
+ *
+ * Linked programs are cached on disk in $XDG_CACHE_HOME/wayfire/shaders when
+ * the driver supports program binaries, so that the same sources are not
+ * compiled again on the next start. Set WAYFIRE_NO_SHADER_CACHE to disable.
  */
 GLuint compile_program(std::string vertex_source, std::string frag_source);
 
@@ -299,6 +363,27 @@ GLuint compile_program(std::string vertex_source, std::string frag_source);
  */
 void render_rectangle(wf::geometry_t box, wf::color_t color, glm::mat4 matrix);
 
+/**
+ * A handle to a uniform of a program_t, obtained via program_t::get_uniform().
+ *
+ * Setting a uniform via its handle avoids looking up its location by name.
+ * Handles stay valid for the lifetime of the program_t, even if it is
+ * recompiled.
+ */
+struct uniform_t
+{
+    int index = -1;
+};
+
+/**
+ * A handle to a vertex attribute of a program_t, obtained via
+ * program_t::get_attrib(). See uniform_t.
+ */
+struct attrib_t
+{
+    int index = -1;
+};
+
 /**
  * An OpenGL program for rendering texture_t.
  * It contains multiple programs for the different texture types.
@@ -337,7 +422,27 @@ class program_t : public noncopyable_t
     void set_simple(GLuint program_id,
         wf::texture_type_t type = wf::TEXTURE_TYPE_RGBA);
 
-    /** Deletes the underlying OpenGL programs */
+    /**
+     * Same as compile(), but the program is compiled only when it is first
+     * needed, i.e. on the first call to use() or get_program_id().
+     *
+     * Plugins should prefer this over compile() during init(), so that
+     * programs of effects which are never shown are never compiled. Uniform
+     * and attribute handles may be requested before the program is compiled.
+     */
+    void compile_lazy(const std::string& vertex_source,
+        const std::string& fragment_source);
+
+    /**
+     * Same as set_simple(compile_program(vertex_source, fragment_source)),
+     * but the program is compiled only when it is first needed, see
+     * compile_lazy().
+     */
+    void set_simple_lazy(const std::string& vertex_source,
+        const std::string& fragment_source,
+        wf::texture_type_t type = wf::TEXTURE_TYPE_RGBA);
+
+    /** Deletes the underlying OpenGL programs, and any pending ones */
     void free_resources();
 
     /**
@@ -350,6 +455,34 @@ class program_t : public noncopyable_t
     /** @return The program ID for the given texture type, or 0 on failure */
     int get_program_id(wf::texture_type_t type);
 
+    /**
+     * Get a handle to the uniform with the given name. The uniform location is
+     * resolved for all texture types once, and again after each compile().
+     */
+    uniform_t get_uniform(const std::string& name);
+
+    /** Get a handle to the vertex attribute with the given name. */
+    attrib_t get_attrib(const std::string& name);
+
+    /*
+     * The values of uniforms are remembered per program, so that setting a
+     * uniform to the value it already has does not result in a GL call.
+     * Uniforms should therefore only be set via the functions below.
+     */
+
+    /** Set the given uniform for the currently used program. */
+    void uniform1i(uniform_t uniform, int value);
+    /** Set the given uniform for the currently used program. */
+    void uniform1f(uniform_t uniform, float value);
+    /** Set the given uniform for the currently used program. */
+    void uniform2f(uniform_t uniform, float x, float y);
+    /** Set the given uniform for the currently used program. */
+    void uniform3f(uniform_t uniform, float x, float y, float z);
+    /** Set the given uniform for the currently used program. */
+    void uniform4f(uniform_t uniform, const glm::vec4& value);
+    /** Set the given uniform for the currently used program. */
+    void uniformMatrix4f(uniform_t uniform, const glm::mat4& value);
+
     /** Set the given uniform for the currently used program. */
     void uniform1i(const std::string& name, int value);
     /** Set the given uniform for the currently used program. */
@@ -372,6 +505,8 @@ class program_t : public noncopyable_t
      */
     void attrib_pointer(const std::string& attrib,
         int size, int stride, const void *ptr, GLenum type = GL_FLOAT);
+    void attrib_pointer(attrib_t attrib,
+        int size, int stride, const void *ptr, GLenum type = GL_FLOAT);
 
     /*
      * Set the attrib divisor. Analogous to glVertexAttribDivisor().
@@ -380,10 +515,14 @@ class program_t : public noncopyable_t
      * @param divisor The divisor value.
      */
     void attrib_divisor(const std::string& attrib, int divisor);
+    void attrib_divisor(attrib_t attrib, int divisor);
 
     /**
      * Set the active texture, and modify the builtin Y-inversion uniforms.
      * Will not work with custom programs.
+     *
+     * The texture's minification filter is set only if the texture differs
+     * from the one set last in the current render_begin/end() block.
      */
     void set_active_texture(const wf::texture_t& texture);
 
@@ -396,6 +535,9 @@ class program_t : public noncopyable_t
   private:
     class impl;
     std::unique_ptr<impl> priv;
+
+    /** Compile the program set with compile_lazy() or set_simple_lazy() */
+    void compile_pending();
 };
 }
 
@@ -3,6 +3,11 @@
 
 #include "wayfire/output.hpp"
 #include "wayfire/object.hpp"
+#include "wayfire/frame-profiler.hpp"
+
+#include <map>
+#include <optional>
+#include <string>
 
 namespace wf
 {
@@ -17,6 +22,22 @@ struct workspace_stream_t;
  * @param fb Indicates the framebuffer that the custom renderer should draw to */
 using render_hook_t = std::function<void (const wf::framebuffer_t& fb)>;
 
+/**
+ * A render hook which repaints only the parts of the output which changed,
+ * see render_manager::set_damage_renderer().
+ *
+ * @param fb The framebuffer that the custom renderer should draw to.
+ * @param damage The region of fb which is out of date and has to be repainted,
+ *   in the coordinate system of fb.geometry. It contains the damage scheduled
+ *   on the output, as well as the parts of fb which were updated in frames
+ *   since the buffer was last used.
+ *
+ * @return The region which the hook repainted. It must contain @damage, and
+ *   may be larger if the contents drawn by the hook changed elsewhere.
+ */
+using damage_render_hook_t = std::function<wf::region_t(
+    const wf::framebuffer_t& fb, const wf::region_t& damage)>;
+
 /* Effect hooks provide the plugins with a way to execute custom code
  * at certain parts of the repaint cycle */
 using effect_hook_t = std::function<void ()>;
@@ -56,6 +77,86 @@ enum output_effect_type_t
 using post_hook_t = std::function<void (const wf::framebuffer_base_t& source,
     const wf::framebuffer_base_t& destination)>;
 
+/**
+ * Describes how a post hook spreads damage from its source buffer to its
+ * destination buffer.
+ *
+ * Post hooks are run only for the damaged parts of the output. Before calling
+ * a hook, the render manager sets the GL scissor box to the extents of the
+ * region which has to be redrawn, and render_manager::get_swap_damage()
+ * returns that region. Hooks may draw outside of it, but they must update at
+ * least the region.
+ *
+ * @param damage The damaged region of the source buffer, in output-local
+ *   coordinates.
+ *
+ * @return The region of the destination buffer which changes as a result.
+ */
+using post_damage_expander_t =
+    std::function<wf::region_t(const wf::region_t& damage)>;
+
+namespace post_damage
+{
+/** For effects where each pixel depends only on the same pixel, like invert. */
+post_damage_expander_t per_pixel();
+
+/** For effects where each pixel depends on pixels within @radius, like blur. */
+post_damage_expander_t radius(int radius);
+}
+
+/** The reason why an output was composited instead of scanned out directly. */
+enum class scanout_fallback_t
+{
+    /* A drag-and-drop operation is active */
+    DRAG_ACTIVE,
+    /* A plugin has a render hook or inhibits the output */
+    PLUGIN_RENDERER,
+    /* A plugin has effect or postprocessing hooks */
+    OUTPUT_EFFECTS,
+    /* The cursor is rendered in software */
+    SOFTWARE_CURSOR,
+    /* There are no views on the current workspace */
+    NO_VIEWS,
+    /* The topmost view does not cover the whole output */
+    VIEW_NOT_FULLSCREEN,
+    /* The main surface's buffer does not match the output */
+    VIEW_BUFFER_MISMATCH,
+    /* The topmost view is not fully opaque */
+    VIEW_NOT_OPAQUE,
+    /* The topmost view or one of its children has a transformer */
+    VIEW_TRANSFORMED,
+    /* A surface above the main surface does not match the output */
+    SURFACE_MISMATCH,
+    /* More overlay planes are needed than available */
+    NOT_ENOUGH_PLANES,
+    /* The overlay planes are simulated, so they cannot display anything */
+    SIMULATED_PLANES,
+    /* The output rejected the plane configuration */
+    COMMIT_FAILED,
+};
+
+/** @return A human-readable description of the fallback reason. */
+const char *to_string(scanout_fallback_t reason);
+
+/**
+ * Statistics about direct scanout on an output, useful to find out why a
+ * fullscreen view is composited instead of scanned out.
+ */
+struct scanout_stats_t
+{
+    /** The number of frames which were scanned out directly. */
+    uint64_t scanout_frames = 0;
+    /** The number of frames which were composited. */
+    uint64_t composited_frames = 0;
+    /** The number of composited frames, per reason why scanout was not possible. */
+    std::map<scanout_fallback_t, uint64_t> fallback_reasons;
+    /** The id of the view scanned out in the last frame, if any. An id is
+     * stored instead of the view, so that it cannot dangle. */
+    std::optional<uint32_t> last_view_id;
+    /** The number of overlay planes used in the last scanned out frame. */
+    int last_overlay_planes = 0;
+};
+
 /** Render manager
  *
  * Each output has a render manager, which is responsible for all rendering
@@ -75,6 +176,17 @@ class render_manager : public wf::signal_provider_t
      */
     void set_renderer(render_hook_t rh = nullptr);
 
+    /**
+     * Set a render hook which repaints only part of the output each frame.
+     * Unlike hooks set with set_renderer(), the output is repainted only where
+     * it is damaged or where the hook reports changes, so the hook should damage
+     * the output when its contents change. set_renderer(nullptr) restores the
+     * default renderer.
+     *
+     * @param rh The render hook to use.
+     */
+    void set_damage_renderer(damage_render_hook_t rh);
+
     /**
      * Rendering an output is done on demand, that is, when the output is
      * damaged. Some plugins however need to redraw the output as often as
@@ -116,8 +228,10 @@ class render_manager : public wf::signal_provider_t
      * Add a new post hook.
      *
      * @param hook The hook callback
+     * @param expand How the hook spreads damage. By default, any damage causes
+     *   the whole output to be redrawn by the hook.
      */
-    void add_post(post_hook_t *hook);
+    void add_post(post_hook_t *hook, post_damage_expander_t expand = nullptr);
 
     /**
      * Remove a post hook. No-op if hook isn't active.
@@ -185,6 +299,8 @@ class render_manager : public wf::signal_provider_t
      * Initialize a workspace stream. If you need to change the stream's
      * attributes, you should stop the stream, and start it again
      *
+     * The stream is rendered with its current scale_x and scale_y.
+     *
      * @param stream The stream to be initialized
      */
     void workspace_stream_start(workspace_stream_t& stream);
@@ -194,9 +310,14 @@ class render_manager : public wf::signal_provider_t
      * This function should be called inside the rendering cycle, i.e in a
      * render or an overlay hook.
      *
+     * The stream's buffer has the size of the output multiplied by the scale.
+     * When the scale changes, the buffer is resized and fully repainted.
+     * Since framebuffers have a single scale, the larger of scale_x and
+     * scale_y is used for both dimensions. Scales are clamped to (0, 1].
+     *
      * @param stream The workspace stream to update
-     * @param scale_x Unused for now
-     * @param scale_y Unused for now
+     * @param scale_x The horizontal scale of the stream relative to the output
+     * @param scale_y The vertical scale of the stream relative to the output
      */
     void workspace_stream_update(workspace_stream_t& stream,
         float scale_x = 1, float scale_y = 1);
@@ -208,6 +329,17 @@ class render_manager : public wf::signal_provider_t
      */
     void workspace_stream_stop(workspace_stream_t& stream);
 
+    /**
+     * @return Direct scanout statistics for the output.
+     */
+    const scanout_stats_t& get_scanout_stats() const;
+
+    /**
+     * @return The frame profiler of the output. It records samples only while
+     *   activated, see frame_profiler_t::set_active().
+     */
+    frame_profiler_t& get_frame_profiler();
+
   private:
     class impl;
     std::unique_ptr<impl> pimpl;
@@ -251,6 +251,42 @@ using output_gain_focus_signal = _output_signal;
  */
 using output_start_rendering_signal = _output_signal;
 
+/**
+ * How much of a surface is visible on its output's current workspace.
+ */
+enum surface_visibility_t
+{
+    /** No part of the surface is covered by opaque surfaces above it. */
+    SURFACE_VISIBLE           = 0,
+    /** Some, but not all of the surface is covered. */
+    SURFACE_PARTIALLY_VISIBLE = 1,
+    /** The surface is completely covered, or entirely outside of the output. */
+    SURFACE_OCCLUDED          = 2,
+};
+
+/**
+ * name: surface-occluded
+ * on: render-manager
+ * when: Emitted after each frame for each surface which core has classified
+ *   as fully occluded by opaque surfaces above it, before frame callbacks are
+ *   sent. Frame callbacks for occluded surfaces are throttled according to
+ *   core/occluded_frame_rate. Plugins which nevertheless display the surface
+ *   (for ex. in a thumbnail) can set visibility to SURFACE_VISIBLE to keep the
+ *   surface updating at the full frame rate.
+ *
+ *   The signal is not emitted while a custom renderer is active, in that case
+ *   all surfaces are considered visible.
+ */
+struct surface_occluded_signal : public wf::signal_data_t
+{
+    /** The occluded surface. */
+    wf::surface_interface_t *surface;
+    /** The view the surface belongs to. */
+    wayfire_view view;
+    /** The visibility core will use for throttling the surface. */
+    surface_visibility_t visibility = SURFACE_OCCLUDED;
+};
+
 /* ----------------------------------------------------------------------------/
  * Output workspace signals
  * -------------------------------------------------------------------------- */
@@ -583,11 +619,15 @@ struct view_geometry_changed_signal : public _view_signal
 
 /**
  * name: region-damaged
- * on: view
+ * on: view, output(view-)
  * when: Whenever a region of the view becomes damaged, for ex. when the client
  *   updates its contents.
- * argument: Unused.
  */
+struct view_region_damaged_signal : public _view_signal
+{
+    /** The damaged box, in output-local coordinates */
+    wf::geometry_t box;
+};
 
 /**
  * name: decoration-state-updated
@@ -107,6 +107,38 @@ class view_transformer_t
         wlr_box scissor_box, const wf::framebuffer_t& target_fb)
     {}
 
+    /**
+     * Describe the transformer as a matrix and a color multiplier, if that is
+     * all it does. Consecutive transformers which can be described this way
+     * are drawn together in a single pass, without intermediate buffers, and
+     * their render_with_damage() is not called.
+     *
+     * @param view The bounding box of the view up to this transformer.
+     * @param matrix Set to the matrix which maps output-local points before
+     *   the transformer to output-local points after it, in homogeneous
+     *   coordinates.
+     * @param color Set to the color multiplier of the transformer.
+     *
+     * @return Whether the transformer can be described as a matrix. The
+     *   default implementation returns false.
+     */
+    virtual bool get_matrix_transform(wf::geometry_t view, glm::mat4& matrix,
+        glm::vec4& color);
+
+    /**
+     * When a transformer is followed by other transformers, it renders to an
+     * intermediate buffer. A cacheable transformer's output depends only on
+     * its input texture and bounding box, so the buffer is rendered again
+     * only when those change or the view is damaged.
+     *
+     * @return Whether the transformer is cacheable. The default implementation
+     *   returns false, so the buffer is rendered on each frame.
+     */
+    virtual bool is_cacheable()
+    {
+        return false;
+    }
+
     virtual ~view_transformer_t()
     {}
 };
@@ -139,6 +171,17 @@ class view_2D : public view_transformer_t
         wf::geometry_t view, wf::pointf_t point) override;
     void render_box(wf::texture_t src_tex, wlr_box src_box,
         wlr_box scissor_box, const wf::framebuffer_t& target_fb) override;
+
+    /**
+     * Subclasses may override render_box() to draw more than the transformed
+     * view, so only view_2D itself is described as a matrix. Subclasses which
+     * do not change rendering can override this to return true as well.
+     */
+    bool get_matrix_transform(wf::geometry_t view, glm::mat4& matrix,
+        glm::vec4& color) override;
+
+    /** @return The transform as a matrix in output-local coordinates. */
+    glm::mat4 get_output_matrix();
 };
 
 /* Those are centered relative to the view's bounding box */
@@ -169,6 +212,13 @@ class view_3D : public view_transformer_t
     void render_box(wf::texture_t src_tex, wlr_box src_box,
         wlr_box scissor_box, const wf::framebuffer_t& target_fb) override;
 
+    /** Same as view_2D::get_matrix_transform() */
+    bool get_matrix_transform(wf::geometry_t view, glm::mat4& matrix,
+        glm::vec4& color) override;
+
+    /** @return The transform as a matrix in output-local coordinates. */
+    glm::mat4 get_output_matrix();
+
     static const float fov; // PI / 8
     static glm::mat4 default_view_matrix();
     static glm::mat4 default_proj_matrix();
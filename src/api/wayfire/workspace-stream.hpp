@@ -14,6 +14,8 @@ struct workspace_stream_t
     wf::framebuffer_base_t buffer;
     bool running = false;
 
+    /* The size of the buffer relative to the output, see
+     * render_manager::workspace_stream_update() */
     float scale_x = 1.0;
     float scale_y = 1.0;
 
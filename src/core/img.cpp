@@ -1,6 +1,7 @@
 #include <wayfire/util/log.hpp>
 #include "wayfire/img.hpp"
 #include "wayfire/opengl.hpp"
+#include "wayfire/core.hpp"
 
 #include <config.h>
 
@@ -13,120 +14,249 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cerrno>
 #include <cstdio>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <tuple>
 #include <unordered_map>
 #include <functional>
+#include <limits>
+#include <wayland-server-core.h>
 
 #define TEXTURE_LOAD_ERROR 0
 
 namespace image_io
 {
-using Loader = std::function<bool (const char*, GLuint)>;
-using Writer = std::function<void (const char*name, uint8_t*pixels, unsigned long,
+using Decoder = std::function<bool (const char*, image_t&)>;
+using Writer  = std::function<void (const char*name, uint8_t*pixels, unsigned long,
     unsigned long)>;
 namespace
 {
-std::unordered_map<std::string, Loader> loaders;
+std::unordered_map<std::string, Decoder> decoders;
 std::unordered_map<std::string, Writer> writers;
+
+/* Images are cached by path and modification time, so that a file which was
+ * changed on disk is decoded again */
+struct cache_key_t
+{
+    std::string path;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+
+    bool operator <(const cache_key_t& other) const
+    {
+        return std::tie(path, mtime_sec, mtime_nsec) <
+               std::tie(other.path, other.mtime_sec, other.mtime_nsec);
+    }
+
+    bool operator ==(const cache_key_t& other) const
+    {
+        return std::tie(path, mtime_sec, mtime_nsec) ==
+               std::tie(other.path, other.mtime_sec, other.mtime_nsec);
+    }
+};
+
+struct cache_entry_t
+{
+    std::shared_ptr<const image_t> image;
+    uint64_t last_use;
+};
+
+std::map<cache_key_t, cache_entry_t> cache;
+uint64_t use_counter = 0;
+/* Backgrounds are usually a few large images. The most recently used image
+ * is kept even if it alone exceeds the budget. */
+constexpr size_t MAX_CACHE_BYTES = 64 << 20;
+
+struct decode_job_t
+{
+    cache_key_t key;
+    Decoder decoder;
+
+    /* Protects the result of the job, the worker thread is detached and
+     * keeps the job alive on its own */
+    std::mutex mutex;
+    std::shared_ptr<const image_t> image;
+    bool done = false;
+};
+
+std::vector<std::shared_ptr<decode_job_t>> jobs;
+int jobs_done_fd = -1;
+wl_event_source *jobs_done_source = nullptr;
+
+std::set<texture_loader_t::impl*> waiting_loaders;
+
+/* Rows uploaded by a single texture_loader_t::upload_step() */
+constexpr size_t UPLOAD_BAND_BYTES = 4 << 20;
 }
 
-bool load_data_as_cubemap(unsigned char *data, int width, int height, int channels)
+/*
+ *  CUBEMAP IMAGE FORMAT
+ *
+ *    0    1    2    3
+ *    _____________________
+ *  0 | X  | T  | X  | X  |
+ *    |____|____|____|____|
+ *  1 | R  | F  | L  | BA |
+ *    |____|____|____|____|
+ *  2 | X  | BO | X  | X  |
+ *    |____|____|____|____|
+ *
+ *  WIDTH / 4 == HEIGHT / 3
+ *
+ *  X : UNUSED
+ *  T:  TOP
+ *  R:  RIGHT
+ *  F:  FRONT
+ *  L:  LEFT
+ *  BA: BACK
+ *  BO: BOTTOM
+ *
+ */
+struct cubemap_face_t
+{
+    GLenum target;
+    int x, y;
+};
+
+static const cubemap_face_t cubemap_faces[] = {
+    {GL_TEXTURE_CUBE_MAP_POSITIVE_X, 2, 1},
+    {GL_TEXTURE_CUBE_MAP_NEGATIVE_X, 0, 1},
+    {GL_TEXTURE_CUBE_MAP_POSITIVE_Y, 1, 0},
+    {GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, 1, 2},
+    {GL_TEXTURE_CUBE_MAP_POSITIVE_Z, 1, 1},
+    {GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 3, 1},
+};
+
+/** @return The number of faces of the texture target */
+static int count_faces(GLuint target)
 {
-    width  /= 4;
-    height /= 3;
-    int x, y, t;
+    return target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+}
 
-    if (width != height)
+/** @return The size of a single face of the texture target */
+static int face_width(const image_t& image, GLuint target)
+{
+    return target == GL_TEXTURE_CUBE_MAP ? image.width / 4 : image.width;
+}
+
+static int face_height(const image_t& image, GLuint target)
+{
+    return target == GL_TEXTURE_CUBE_MAP ? image.height / 3 : image.height;
+}
+
+static GLenum image_format(const image_t& image)
+{
+    return image.channels == 4 ? GL_RGBA : GL_RGB;
+}
+
+/**
+ * Allocate the storage of the bound texture for the image.
+ *
+ * @return false if the image cannot be used for the target.
+ */
+static bool begin_upload(const image_t& image, GLuint target)
+{
+    int width  = face_width(image, target);
+    int height = face_height(image, target);
+    if ((target == GL_TEXTURE_CUBE_MAP) && (width != height))
     {
         LOGE("cubemap width / 4(", width, ") != height / 3(", height, ")");
         return false;
     }
 
-    /*
-     *  CUBEMAP IMAGE FORMAT
-     *
-     *    0    1    2    3
-     *    _____________________
-     *  0 | X  | T  | X  | X  |
-     *    |____|____|____|____|
-     *  1 | R  | F  | L  | BA |
-     *    |____|____|____|____|
-     *  2 | X  | BO | X  | X  |
-     *    |____|____|____|____|
-     *
-     *  WIDTH / 4 == HEIGHT / 3
-     *
-     *  X : UNUSED
-     *  T:  TOP
-     *  R:  RIGHT
-     *  F:  FRONT
-     *  L:  LEFT
-     *  BA: BACK
-     *  BO: BOTTOM
-     *
-     */
-
-    for (t = GL_TEXTURE_CUBE_MAP_POSITIVE_X;
-         t < GL_TEXTURE_CUBE_MAP_POSITIVE_X + 6;
-         t++)
-    {
-        switch (t)
-        {
-          case GL_TEXTURE_CUBE_MAP_POSITIVE_X:
-            x = 2, y = 1;
-            break;
-
-          case GL_TEXTURE_CUBE_MAP_NEGATIVE_X:
-            x = 0, y = 1;
-            break;
+    auto format = image_format(image);
+    for (int face = 0; face < count_faces(target); face++)
+    {
+        GLenum face_target = (target == GL_TEXTURE_CUBE_MAP) ?
+            cubemap_faces[face].target : target;
+        GL_CALL(glTexImage2D(face_target, 0, format, width, height, 0,
+            format, GL_UNSIGNED_BYTE, nullptr));
+    }
 
-          case GL_TEXTURE_CUBE_MAP_POSITIVE_Y:
-            x = 1, y = 0;
-            break;
+    return true;
+}
 
-          case GL_TEXTURE_CUBE_MAP_NEGATIVE_Y:
-            x = 1, y = 2;
-            break;
+/**
+ * Upload at most max_rows rows of the image to the bound texture, starting at
+ * the given face and row, which are advanced past the uploaded rows.
+ *
+ * @return true if the whole image has been uploaded.
+ */
+static bool upload_rows(const image_t& image, GLuint target,
+    int& face, int& row, int max_rows)
+{
+    int width  = face_width(image, target);
+    int height = face_height(image, target);
+    auto format = image_format(image);
+
+    /* GL_UNPACK_ROW_LENGTH is not available on plain GLES2, so it is only set
+     * when the rows of a face are not contiguous, as in cubemaps */
+    const bool sub_rows = (image.width != width);
+    GL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    if (sub_rows)
+    {
+        GL_CALL(glPixelStorei(GL_UNPACK_ROW_LENGTH, image.width));
+    }
 
-          case GL_TEXTURE_CUBE_MAP_POSITIVE_Z:
-            x = 1, y = 1;
-            break;
+    while ((face < count_faces(target)) && (max_rows > 0))
+    {
+        GLenum face_target = target;
+        int x = 0, y = 0;
+        if (target == GL_TEXTURE_CUBE_MAP)
+        {
+            face_target = cubemap_faces[face].target;
+            x = cubemap_faces[face].x * width;
+            y = cubemap_faces[face].y * height;
+        }
 
-          case GL_TEXTURE_CUBE_MAP_NEGATIVE_Z:
-            x = 3, y = 1;
-            break;
+        int rows = std::min(max_rows, height - row);
+        auto data = image.pixels.data() +
+            ((size_t)(y + row) * image.width + x) * image.channels;
+        GL_CALL(glTexSubImage2D(face_target, 0, 0, row, width, rows,
+            format, GL_UNSIGNED_BYTE, data));
 
-          default:
-            return false;
-            break;
+        max_rows -= rows;
+        row += rows;
+        if (row == height)
+        {
+            row = 0;
+            ++face;
         }
+    }
 
-        auto format = (channels == 4 ? GL_RGBA : GL_RGB);
-        GL_CALL(glPixelStorei(GL_UNPACK_ROW_LENGTH, width * 4));
-        GL_CALL(glPixelStorei(GL_UNPACK_SKIP_ROWS, y * height));
-        GL_CALL(glPixelStorei(GL_UNPACK_SKIP_PIXELS, x * width));
-
-        GL_CALL(glTexImage2D(t, 0, format, width, height, 0,
-            format, GL_UNSIGNED_BYTE, data));
+    if (sub_rows)
+    {
+        GL_CALL(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
     }
 
-    GL_CALL(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
-    GL_CALL(glPixelStorei(GL_UNPACK_SKIP_ROWS, 0));
-    GL_CALL(glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0));
+    GL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
 
-    return true;
+    return face == count_faces(target);
 }
 
 #ifdef BUILD_WITH_IMAGEIO
 /* All backend functions are taken from the internet.
  * If you want to be credited, contact me */
-bool texture_from_png(const char *filename, GLuint target)
+bool image_from_png(const char *filename, image_t& image)
 {
     FILE *fp = fopen(filename, "rb");
+    if (!fp)
+    {
+        return false;
+    }
+
     int width, height;
     png_byte color_type;
     png_byte bit_depth;
-    png_bytep *row_pointers;
+    /* Declared before setjmp(), so that it is freed on the error path too */
+    std::vector<png_bytep> row_pointers;
 
     png_structp png =
         png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
@@ -139,12 +269,14 @@ bool texture_from_png(const char *filename, GLuint target)
     png_infop infos = png_create_info_struct(png);
     if (!infos)
     {
+        png_destroy_read_struct(&png, NULL, NULL);
         fclose(fp);
         return false;
     }
 
     if (setjmp(png_jmpbuf(png)))
     {
+        png_destroy_read_struct(&png, &infos, NULL);
         fclose(fp);
         return false;
     }
@@ -194,36 +326,20 @@ bool texture_from_png(const char *filename, GLuint target)
 
     png_read_update_info(png, infos);
 
-    row_pointers = new png_bytep[height];
-    png_byte *data = new png_byte[height * png_get_rowbytes(png, infos)];
+    image.width    = width;
+    image.height   = height;
+    image.channels = png_get_channels(png, infos);
+    image.pixels.resize((size_t)height * png_get_rowbytes(png, infos));
 
+    row_pointers.resize(height);
     for (int i = 0; i < height; i++)
     {
-        row_pointers[i] = data + i * png_get_rowbytes(png, infos);
+        row_pointers[i] = image.pixels.data() + i * png_get_rowbytes(png, infos);
     }
 
-    png_read_image(png, row_pointers);
-
-    if (target == GL_TEXTURE_CUBE_MAP)
-    {
-        if (!load_data_as_cubemap(data, width, height,
-            png_get_channels(png, infos)))
-        {
-            png_destroy_read_struct(&png, &infos, NULL);
-            delete[] row_pointers;
-            delete[] data;
-            fclose(fp);
-            return false;
-        }
-    } else if (target == GL_TEXTURE_2D)
-    {
-        GL_CALL(glTexImage2D(target, 0, GL_RGBA, width, height, 0,
-            GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*)data));
-    }
+    png_read_image(png, row_pointers.data());
 
     png_destroy_read_struct(&png, &infos, NULL);
-    delete[] row_pointers;
-    delete[] data;
 
     fclose(fp);
 
@@ -288,73 +404,61 @@ void texture_to_png(const char *name, uint8_t *pixels, int w, int h)
     delete[] rows;
 }
 
-bool texture_from_jpeg(const char *FileName, GLuint target)
+bool image_from_jpeg(const char *FileName, image_t& image)
 {
-    unsigned long data_size;
     unsigned char *rowptr[1];
-    unsigned char *jdata;
     struct jpeg_decompress_struct infot;
     struct jpeg_error_mgr err;
 
     std::FILE *file = fopen(FileName, "rb");
-    infot.err = jpeg_std_error(&err);
-    jpeg_create_decompress(&infot);
-
     if (!file)
     {
-        LOGE("failed to read JPEG file ", FileName);
-
         return false;
     }
 
+    infot.err = jpeg_std_error(&err);
+    jpeg_create_decompress(&infot);
+
     jpeg_stdio_src(&infot, file);
     jpeg_read_header(&infot, TRUE);
+    /* Grayscale images are expanded, so that all images have 3 channels */
+    infot.out_color_space = JCS_RGB;
     jpeg_start_decompress(&infot);
 
-    data_size = infot.output_width * infot.output_height * 3;
-
-    jdata = new unsigned char [data_size];
+    image.width    = infot.output_width;
+    image.height   = infot.output_height;
+    image.channels = 3;
+    image.pixels.resize((size_t)image.width * image.height * 3);
     while (infot.output_scanline < infot.output_height)
     {
-        rowptr[0] = (unsigned char*)jdata + 3 * infot.output_width *
+        rowptr[0] = image.pixels.data() + 3 * infot.output_width *
             infot.output_scanline;
         jpeg_read_scanlines(&infot, rowptr, 1);
     }
 
     jpeg_finish_decompress(&infot);
-
-    GLint width  = infot.output_width;
-    GLint height = infot.output_height;
-
-    if (target == GL_TEXTURE_CUBE_MAP)
-    {
-        if (!load_data_as_cubemap(jdata, width, height, 3))
-        {
-            fclose(file);
-            delete[] jdata;
-            return false;
-        }
-    } else if (target == GL_TEXTURE_2D)
-    {
-        GL_CALL(glTexImage2D(target, 0, GL_RGB, width, height, 0,
-            GL_RGB, GL_UNSIGNED_BYTE, jdata));
-    }
-
+    jpeg_destroy_decompress(&infot);
     fclose(file);
-    delete[] jdata;
 
     return true;
 }
 
 #endif
 
-bool load_from_file(std::string name, GLuint target)
+/**
+ * Find the cache key and the decoder of the file.
+ *
+ * @return false if the file cannot be decoded.
+ */
+static bool prepare_decode(const std::string& name, cache_key_t& key,
+    Decoder& decoder)
 {
-    if (access(name.c_str(), F_OK) == -1)
+    struct stat st;
+    if (stat(name.c_str(), &st) == -1)
     {
         if (!name.empty())
         {
-            LOGE(__func__, "() cannot access ", name);
+            LOGE("image_io: cannot access ", name);
         }
 
         return false;
@@ -363,8 +467,8 @@ bool load_from_file(std::string name, GLuint target)
     int len = name.length();
     if ((len < 4) || (name[len - 4] != '.'))
     {
-        LOGE(
-            "load_from_file() called with file without extension or with invalid extension!");
+        LOGE("image_io: file without extension or with invalid extension: ",
+            name);
 
         return false;
     }
@@ -375,16 +479,321 @@ bool load_from_file(std::string name, GLuint target)
         ext[i] = std::tolower(ext[i]);
     }
 
-    auto it = loaders.find(ext);
-    if (it == loaders.end())
+    auto it = decoders.find(ext);
+    if (it == decoders.end())
     {
-        LOGE("load_from_file() called with unsupported extension ", ext);
+        LOGE("image_io: unsupported extension ", ext);
 
         return false;
-    } else
+    }
+
+    key     = {name, st.st_mtim.tv_sec, st.st_mtim.tv_nsec};
+    decoder = it->second;
+    return true;
+}
+
+static std::shared_ptr<const image_t> cache_lookup(const cache_key_t& key)
+{
+    auto it = cache.find(key);
+    if (it == cache.end())
+    {
+        return nullptr;
+    }
+
+    it->second.last_use = ++use_counter;
+    return it->second.image;
+}
+
+static void cache_insert(const cache_key_t& key,
+    std::shared_ptr<const image_t> image)
+{
+    size_t total = image->pixels.size();
+    for (auto it = cache.begin(); it != cache.end();)
+    {
+        /* Older versions of the file will not be used again */
+        if (it->first.path == key.path)
+        {
+            it = cache.erase(it);
+        } else
+        {
+            total += it->second.image->pixels.size();
+            ++it;
+        }
+    }
+
+    while ((total > MAX_CACHE_BYTES) && !cache.empty())
+    {
+        auto oldest = cache.begin();
+        for (auto it = cache.begin(); it != cache.end(); ++it)
+        {
+            if (it->second.last_use < oldest->second.last_use)
+            {
+                oldest = it;
+            }
+        }
+
+        total -= oldest->second.image->pixels.size();
+        cache.erase(oldest);
+    }
+
+    cache[key] = {image, ++use_counter};
+}
+
+std::shared_ptr<const image_t> decode_file(std::string name)
+{
+    cache_key_t key;
+    Decoder decoder;
+    if (!prepare_decode(name, key, decoder))
+    {
+        return nullptr;
+    }
+
+    if (auto image = cache_lookup(key))
+    {
+        return image;
+    }
+
+    auto image = std::make_shared<image_t>();
+    if (!decoder(name.c_str(), *image))
+    {
+        return nullptr;
+    }
+
+    cache_insert(key, image);
+    return image;
+}
+
+bool load_from_file(std::string name, GLuint target)
+{
+    auto image = decode_file(name);
+    if (!image || !begin_upload(*image, target))
     {
-        return it->second(name.c_str(), target);
+        return false;
     }
+
+    int face = 0, row = 0;
+    return upload_rows(*image, target, face, row,
+        std::numeric_limits<int>::max());
+}
+
+class texture_loader_t::impl
+{
+  public:
+    status_t status = LOAD_IDLE;
+    cache_key_t key;
+    GLuint target;
+    std::function<void()> on_decoded;
+
+    std::shared_ptr<const image_t> image;
+    /* The texture being uploaded, and the next rows to upload */
+    GLuint texture = 0;
+    int face = 0;
+    int row  = 0;
+
+    GLuint done_texture = 0;
+
+    void set_image(std::shared_ptr<const image_t> image)
+    {
+        this->image  = image;
+        this->status = image ? LOAD_UPLOADING : LOAD_FAILED;
+    }
+
+    void delete_textures()
+    {
+        if (texture || done_texture)
+        {
+            OpenGL::render_begin();
+            GL_CALL(glDeleteTextures(1, &texture));
+            GL_CALL(glDeleteTextures(1, &done_texture));
+            OpenGL::render_end();
+            texture = done_texture = 0;
+        }
+    }
+
+    ~impl()
+    {
+        waiting_loaders.erase(this);
+        delete_textures();
+    }
+};
+
+static void start_job(const cache_key_t& key, const Decoder& decoder)
+{
+    for (auto& job : jobs)
+    {
+        if (job->key == key)
+        {
+            return;
+        }
+    }
+
+    auto job = std::make_shared<decode_job_t>();
+    job->key     = key;
+    job->decoder = decoder;
+    jobs.push_back(job);
+
+    std::thread([job] ()
+    {
+        auto image = std::make_shared<image_t>();
+        bool decoded = job->decoder(job->key.path.c_str(), *image);
+
+        {
+            std::lock_guard<std::mutex> lock(job->mutex);
+            job->image = decoded ? image : nullptr;
+            job->done  = true;
+        }
+
+        uint64_t done = 1;
+        if (write(jobs_done_fd, &done, sizeof(done)) < 0)
+        {
+            LOGE("image_io: failed to signal the decoded image ",
+                job->key.path, ": ", strerror(errno));
+        }
+    }).detach();
+}
+
+static int handle_jobs_done(int fd, uint32_t mask, void *data)
+{
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) < 0)
+    {
+        return 0;
+    }
+
+    std::vector<std::shared_ptr<decode_job_t>> done;
+    for (auto it = jobs.begin(); it != jobs.end();)
+    {
+        std::lock_guard<std::mutex> lock((*it)->mutex);
+        if ((*it)->done)
+        {
+            done.push_back(*it);
+            it = jobs.erase(it);
+        } else
+        {
+            ++it;
+        }
+    }
+
+    for (auto& job : done)
+    {
+        if (job->image)
+        {
+            cache_insert(job->key, job->image);
+        }
+
+        /* Loaders may start loading other files from their callback */
+        auto waiting = waiting_loaders;
+        for (auto loader : waiting)
+        {
+            if (waiting_loaders.count(loader) && (loader->key == job->key))
+            {
+                waiting_loaders.erase(loader);
+                loader->set_image(job->image);
+                if (loader->on_decoded)
+                {
+                    loader->on_decoded();
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+texture_loader_t::texture_loader_t()
+{
+    priv = std::make_unique<impl>();
+}
+
+texture_loader_t::~texture_loader_t() = default;
+
+void texture_loader_t::load(std::string name, GLuint target,
+    std::function<void()> on_decoded)
+{
+    waiting_loaders.erase(priv.get());
+    priv->delete_textures();
+    priv->image.reset();
+    priv->face   = priv->row = 0;
+    priv->target = target;
+    priv->on_decoded = on_decoded;
+
+    Decoder decoder;
+    if (!prepare_decode(name, priv->key, decoder))
+    {
+        priv->status = LOAD_FAILED;
+        return;
+    }
+
+    if (auto image = cache_lookup(priv->key))
+    {
+        priv->set_image(image);
+        return;
+    }
+
+    priv->status = LOAD_DECODING;
+    waiting_loaders.insert(priv.get());
+    start_job(priv->key, decoder);
+}
+
+texture_loader_t::status_t texture_loader_t::upload_step()
+{
+    if (priv->status == LOAD_FAILED)
+    {
+        priv->status = LOAD_IDLE;
+        return LOAD_FAILED;
+    }
+
+    if (priv->status != LOAD_UPLOADING)
+    {
+        return priv->status;
+    }
+
+    auto& image = *priv->image;
+    if (!priv->texture)
+    {
+        GL_CALL(glGenTextures(1, &priv->texture));
+        OpenGL::invalidate_texture_cache();
+        GL_CALL(glBindTexture(priv->target, priv->texture));
+        if (!begin_upload(image, priv->target))
+        {
+            GL_CALL(glBindTexture(priv->target, 0));
+            GL_CALL(glDeleteTextures(1, &priv->texture));
+            priv->texture = 0;
+            priv->image.reset();
+            priv->status = LOAD_IDLE;
+            return LOAD_FAILED;
+        }
+    }
+
+    size_t row_bytes = std::max(1, face_width(image, priv->target)) *
+        image.channels;
+    int band = std::max<size_t>(1, UPLOAD_BAND_BYTES / row_bytes);
+
+    GL_CALL(glBindTexture(priv->target, priv->texture));
+    bool complete = upload_rows(image, priv->target, priv->face, priv->row, band);
+    GL_CALL(glBindTexture(priv->target, 0));
+    if (!complete)
+    {
+        return LOAD_UPLOADING;
+    }
+
+    priv->done_texture = priv->texture;
+    priv->texture = 0;
+    priv->image.reset();
+    priv->status = LOAD_IDLE;
+    return LOAD_DONE;
+}
+
+bool texture_loader_t::is_loading() const
+{
+    return (priv->status == LOAD_DECODING) || (priv->status == LOAD_UPLOADING);
+}
+
+GLuint texture_loader_t::take_texture()
+{
+    GLuint texture = priv->done_texture;
+    priv->done_texture = 0;
+    return texture;
 }
 
 void write_to_file(std::string name, uint8_t *pixels, int w, int h, std::string type)
@@ -404,9 +813,14 @@ void init()
 {
     LOGD("init ImageIO");
 #ifdef BUILD_WITH_IMAGEIO
-    loaders["png"] = Loader(texture_from_png);
-    loaders["jpg"] = Loader(texture_from_jpeg);
-    writers["png"] = Writer(texture_to_png);
+    decoders["png"] = Decoder(image_from_png);
+    decoders["jpg"] = Decoder(image_from_jpeg);
+    writers["png"]  = Writer(texture_to_png);
 #endif
+
+    auto event_loop = wl_display_get_event_loop(wf::get_core().display);
+    jobs_done_fd     = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    jobs_done_source = wl_event_loop_add_fd(event_loop, jobs_done_fd,
+        WL_EVENT_READABLE, handle_jobs_done, nullptr);
 }
 }
@@ -1,22 +1,81 @@
 #include "wayfire/object.hpp"
 #include "wayfire/nonstd/safe-list.hpp"
+#include <deque>
 #include <unordered_map>
-#include <set>
+#include <vector>
 
 /* Implementation note: because of circular dependencies between
  * signal_connection_t and signal_provider_t, the chosen way to resolve
  * them is to have signal_provider_t directly modify signal_connection_t
  * private data when needed. */
 
+namespace
+{
+/* All signal names seen so far, indexed by their ID. The names are kept in a
+ * deque, so that references returned by get_signal_name() stay valid when
+ * more signals are interned. */
+struct signal_registry_t
+{
+    std::unordered_map<std::string, wf::signal_id_t> ids;
+    std::deque<std::string> names;
+};
+
+signal_registry_t& get_signal_registry()
+{
+    static signal_registry_t registry;
+    return registry;
+}
+
+/** @return Whether the signal was interned, without interning it. */
+bool find_signal_id(const std::string& name, wf::signal_id_t& id)
+{
+    auto& registry = get_signal_registry();
+    auto it = registry.ids.find(name);
+    if (it == registry.ids.end())
+    {
+        return false;
+    }
+
+    id = it->second;
+    return true;
+}
+}
+
+wf::signal_id_t wf::get_signal_id(const std::string& name)
+{
+    wf::signal_id_t id;
+    if (find_signal_id(name, id))
+    {
+        return id;
+    }
+
+    auto& registry = get_signal_registry();
+    id = registry.names.size();
+    registry.names.push_back(name);
+    registry.ids.emplace(name, id);
+    return id;
+}
+
+const std::string& wf::get_signal_name(signal_id_t id)
+{
+    static const std::string unknown = "";
+    auto& registry = get_signal_registry();
+    return id < registry.names.size() ? registry.names[id] : unknown;
+}
+
 class wf::signal_connection_t::impl
 {
   public:
     signal_callback_t callback;
-    std::set<nonstd::observer_ptr<signal_provider_t>> connected_providers;
 
-    void add(signal_provider_t *provider)
+    /* The signals this connection is connected to on each provider, so that
+     * disconnecting does not need to go over all signals of the provider */
+    std::unordered_map<signal_provider_t*, std::vector<signal_id_t>>
+    connected_providers;
+
+    void add(signal_provider_t *provider, signal_id_t id)
     {
-        connected_providers.insert(provider);
+        connected_providers[provider].push_back(id);
     }
 
     void remove(signal_provider_t *provider)
@@ -50,7 +109,12 @@ void wf::signal_connection_t::emit(signal_data_t *data)
 
 void wf::signal_connection_t::disconnect()
 {
-    auto connected = this->priv->connected_providers;
+    std::vector<signal_provider_t*> connected;
+    for (auto& [provider, ids] : this->priv->connected_providers)
+    {
+        connected.push_back(provider);
+    }
+
     for (auto& provider : connected)
     {
         provider->disconnect_signal(this);
@@ -60,10 +124,12 @@ void wf::signal_connection_t::disconnect()
 class wf::signal_provider_t::sprovider_impl
 {
   public:
-    std::unordered_map<std::string,
+    /* Lists are never erased, so that they stay valid while emitting even if
+     * the callbacks connect to other signals. */
+    std::unordered_map<signal_id_t,
         wf::safe_list_t<signal_connection_t*>> signals;
 
-    std::unordered_map<std::string,
+    std::unordered_map<signal_id_t,
         wf::safe_list_t<signal_callback_t*>> deprecated_signals;
 };
 
@@ -83,58 +149,101 @@ wf::signal_provider_t::~signal_provider_t()
     }
 }
 
-void wf::signal_provider_t::connect_signal(std::string name,
+void wf::signal_provider_t::connect_signal(signal_id_t id,
     signal_connection_t *callback)
 {
-    sprovider_priv->signals[name].push_back(callback);
-    callback->priv->add(this);
+    sprovider_priv->signals[id].push_back(callback);
+    callback->priv->add(this, id);
+}
+
+void wf::signal_provider_t::connect_signal(const std::string& name,
+    signal_connection_t *callback)
+{
+    connect_signal(get_signal_id(name), callback);
 }
 
 void wf::signal_provider_t::disconnect_signal(signal_connection_t *connection)
 {
-    for (auto& s : sprovider_priv->signals)
+    auto& connected = connection->priv->connected_providers;
+    auto it = connected.find(this);
+    if (it == connected.end())
     {
-        s.second.remove_if([=] (signal_connection_t *connected)
-        {
-            if (connected == connection)
-            {
-                connected->priv->remove(this);
-
-                return true;
-            }
+        return;
+    }
 
-            return false;
-        });
+    for (auto& id : it->second)
+    {
+        auto list = sprovider_priv->signals.find(id);
+        if (list != sprovider_priv->signals.end())
+        {
+            list->second.remove_all(connection);
+        }
     }
+
+    connected.erase(it);
 }
 
 /* Deprecated: */
 void wf::signal_provider_t::connect_signal(std::string name,
     signal_callback_t *callback)
 {
-    sprovider_priv->deprecated_signals[name].push_back(callback);
+    sprovider_priv->deprecated_signals[get_signal_id(name)].push_back(callback);
 }
 
 /* Deprecated: */
 void wf::signal_provider_t::disconnect_signal(std::string name,
     signal_callback_t *callback)
 {
-    sprovider_priv->deprecated_signals[name].remove_all(callback);
+    signal_id_t id;
+    if (!find_signal_id(name, id))
+    {
+        return;
+    }
+
+    auto it = sprovider_priv->deprecated_signals.find(id);
+    if (it != sprovider_priv->deprecated_signals.end())
+    {
+        it->second.remove_all(callback);
+    }
 }
 
 /* Emit the given signal. No type checking for data is required */
-void wf::signal_provider_t::emit_signal(std::string name, wf::signal_data_t *data)
+void wf::signal_provider_t::emit_signal(signal_id_t id, wf::signal_data_t *data)
 {
-    sprovider_priv->signals[name].for_each([data] (auto call)
+    auto it = sprovider_priv->signals.find(id);
+    if (it != sprovider_priv->signals.end())
     {
-        call->emit(data);
-    });
+        it->second.for_each([data] (auto call)
+        {
+            call->emit(data);
+        });
+    }
 
     /* Deprecated: */
-    sprovider_priv->deprecated_signals[name].for_each([data] (auto call)
+    if (sprovider_priv->deprecated_signals.empty())
+    {
+        return;
+    }
+
+    auto deprecated = sprovider_priv->deprecated_signals.find(id);
+    if (deprecated != sprovider_priv->deprecated_signals.end())
+    {
+        deprecated->second.for_each([data] (auto call)
+        {
+            (*call)(data);
+        });
+    }
+}
+
+void wf::signal_provider_t::emit_signal(const std::string& name,
+    wf::signal_data_t *data)
+{
+    /* A signal which was never interned cannot have any listeners */
+    signal_id_t id;
+    if (find_signal_id(name, id))
     {
-        (*call)(data);
-    });
+        emit_signal(id, data);
+    }
 }
 
 class wf::object_base_t::obase_impl
@@ -14,6 +14,8 @@ void fini();
 void bind_output(uint32_t fb);
 /** Indicate the output frame has been finished */
 void unbind_output();
+/** @return The number of draw calls issued by the OpenGL helpers so far */
+uint64_t get_draw_call_count();
 }
 
 #endif /* end of include guard: WF_OPENGL_PRIV_HPP */
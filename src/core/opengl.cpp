@@ -1,11 +1,19 @@
 #include <wayfire/util/log.hpp>
 #include <map>
+#include <optional>
+#include <cinttypes>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include <unistd.h>
 #include "opengl-priv.hpp"
 #include "wayfire/output.hpp"
 #include "core-impl.hpp"
 #include "config.h"
 #include <wayfire/nonstd/wlroots-full.hpp>
 
+#include <glm/common.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "shaders.tpp"
@@ -50,6 +58,291 @@ namespace OpenGL
  * Each of the following functions uses the currently bound context
  */
 program_t program, color_program;
+
+namespace
+{
+/**
+ * The texture whose minification filter was last set by set_active_texture().
+ * Reset at the start and end of each render block, and whenever a texture is
+ * created or deleted, since GL reuses the names of deleted textures.
+ */
+struct
+{
+    GLenum target = 0;
+    GLuint tex_id = 0;
+} last_filtered_texture;
+
+/** Pre-resolved uniforms and attributes of program and color_program */
+struct default_program_handles_t
+{
+    uniform_t mvp, color;
+    attrib_t position, uv_position;
+} texture_handles, color_handles;
+
+/** The number of draw calls issued by the helpers in this file */
+uint64_t draw_call_count = 0;
+}
+
+namespace
+{
+/** A sequence of quads in the batch which can be drawn with one call. */
+struct batch_run_t
+{
+    wf::texture_t texture;
+    glm::vec4 color;
+    bool nearest_mag_filter;
+
+    /* Range of vertices in the batch */
+    int first;
+    int count;
+};
+
+struct
+{
+    /* The framebuffer the batch is rendered to */
+    GLuint fb = 0;
+    int32_t viewport_width  = 0;
+    int32_t viewport_height = 0;
+
+    /* Interleaved vertex data: position in NDC, followed by UV */
+    std::vector<GLfloat> vertices;
+    std::vector<batch_run_t> runs;
+
+    GLuint vbo = 0;
+    /* Nesting depth of begin_batch()/end_batch(). Outside of a batch scope,
+     * quads are drawn right away. */
+    int scope_depth = 0;
+} batch;
+
+constexpr int batch_vertex_size = 4;
+
+bool same_texture(const wf::texture_t& a, const wf::texture_t& b)
+{
+    if ((a.type != b.type) || (a.target != b.target) || (a.tex_id != b.tex_id) ||
+        (a.invert_y != b.invert_y) || (a.has_viewport != b.has_viewport))
+    {
+        return false;
+    }
+
+    return !a.has_viewport ||
+           ((a.viewport_box.x1 == b.viewport_box.x1) &&
+            (a.viewport_box.y1 == b.viewport_box.y1) &&
+            (a.viewport_box.x2 == b.viewport_box.x2) &&
+            (a.viewport_box.y2 == b.viewport_box.y2));
+}
+
+/** @return Whether the projection keeps rectangles axis-aligned */
+bool is_axis_aligned(const glm::mat4& m)
+{
+    return ((m[0][1] == 0) && (m[1][0] == 0)) ||
+           ((m[0][0] == 0) && (m[1][1] == 0));
+}
+}
+
+namespace
+{
+/**
+ * An on-disk cache of linked programs, stored with glGetProgramBinary().
+ *
+ * Programs are keyed by a hash of their sources and of the driver identity,
+ * so that a driver update invalidates the cache. Binaries which the driver
+ * rejects are compiled from source again and replaced.
+ */
+class program_binary_cache_t
+{
+  public:
+    /** @return A hash of the program sources and the driver identity. */
+    uint64_t get_key(const std::string& vertex, const std::string& fragment)
+    {
+        init();
+        uint64_t hash = hash_string(vertex, driver_hash);
+        return hash_string(fragment, hash);
+    }
+
+    /** @return The program loaded from the cache, or 0 if not available. */
+    GLuint load(uint64_t key)
+    {
+        init();
+        if (!enabled)
+        {
+            return 0;
+        }
+
+        std::ifstream file(get_path(key), std::ios::binary);
+        header_t header;
+        if (!file.read((char*)&header, sizeof(header)) ||
+            (header.magic != MAGIC) || (header.key != key))
+        {
+            return 0;
+        }
+
+        std::vector<char> binary(header.length);
+        if (!file.read(binary.data(), binary.size()))
+        {
+            return 0;
+        }
+
+        GLuint program = GL_CALL(glCreateProgram());
+        GL_CALL(glProgramBinary(program, header.format, binary.data(),
+            binary.size()));
+
+        GLint status = GL_FALSE;
+        GL_CALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+        if (status == GL_FALSE)
+        {
+            LOGD("Discarding stale program binary ", get_path(key));
+            GL_CALL(glDeleteProgram(program));
+            return 0;
+        }
+
+        return program;
+    }
+
+    /** @return Whether program binaries are loaded from and stored to disk */
+    bool is_enabled()
+    {
+        init();
+        return enabled;
+    }
+
+    /** Store the binary of a successfully linked program. */
+    void store(uint64_t key, GLuint program)
+    {
+        init();
+        if (!enabled)
+        {
+            return;
+        }
+
+        GLint length = 0;
+        GL_CALL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+        if (length <= 0)
+        {
+            return;
+        }
+
+        header_t header;
+        std::vector<char> binary(length);
+        GL_CALL(glGetProgramBinary(program, length, &length, &header.format,
+            binary.data()));
+        header.key    = key;
+        header.length = length;
+
+        /* Write to a temporary file first, so that concurrent instances never
+         * see a partial binary */
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        auto path = get_path(key);
+        auto tmp  = path + ".tmp" + std::to_string(getpid());
+        {
+            std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+            file.write((char*)&header, sizeof(header));
+            file.write(binary.data(), length);
+            if (!file)
+            {
+                std::filesystem::remove(tmp, ec);
+                return;
+            }
+        }
+
+        std::filesystem::rename(tmp, path, ec);
+        if (ec)
+        {
+            LOGW("Failed to store program binary ", path, ": ", ec.message());
+            std::filesystem::remove(tmp, ec);
+        }
+    }
+
+  private:
+    static constexpr uint32_t MAGIC = 0x42504657; // "WFPB"
+    struct header_t
+    {
+        uint32_t magic = MAGIC;
+        GLenum format  = 0;
+        uint64_t key   = 0;
+        uint32_t length = 0;
+    };
+
+    bool initialized = false;
+    bool enabled     = false;
+    uint64_t driver_hash = 0;
+    std::string directory;
+
+    /* FNV-1a, which unlike std::hash is stable across builds */
+    static uint64_t hash_string(const std::string& str,
+        uint64_t hash = 0xcbf29ce484222325)
+    {
+        for (unsigned char c : str)
+        {
+            hash ^= c;
+            hash *= 0x100000001b3;
+        }
+
+        return hash;
+    }
+
+    std::string get_path(uint64_t key) const
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016" PRIx64 ".bin", key);
+        return directory + "/" + name;
+    }
+
+    void init()
+    {
+        if (initialized)
+        {
+            return;
+        }
+
+        initialized = true;
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+        {
+            auto value = (const char*)GL_CALL(glGetString(name));
+            driver_hash = hash_string(value ? value : "", driver_hash);
+        }
+
+        if (getenv("WAYFIRE_NO_SHADER_CACHE"))
+        {
+            return;
+        }
+
+        /* Program binaries are core only since GLES 3.0 */
+        auto version = (const char*)GL_CALL(glGetString(GL_VERSION));
+        int major    = 0;
+        if (!version || (sscanf(version, "OpenGL ES %d", &major) != 1) ||
+            (major < 3))
+        {
+            return;
+        }
+
+        GLint formats = 0;
+        GL_CALL(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats));
+        if (formats <= 0)
+        {
+            return;
+        }
+
+        std::string cache_dir;
+        if (const char *xdg_cache = getenv("XDG_CACHE_HOME"))
+        {
+            cache_dir = xdg_cache;
+        } else if (const char *home = getenv("HOME"))
+        {
+            cache_dir = std::string(home) + "/.cache";
+        } else
+        {
+            return;
+        }
+
+        directory = cache_dir + "/wayfire/shaders";
+        enabled   = true;
+    }
+};
+
+program_binary_cache_t binary_cache;
+}
+
 GLuint compile_shader(std::string source, GLuint type)
 {
     GLuint shader = GL_CALL(glCreateShader(type));
@@ -58,17 +351,19 @@ GLuint compile_shader(std::string source, GLuint type)
     GL_CALL(glShaderSource(shader, 1, &c_src, NULL));
 
     int s;
-#define LENGTH 1024 * 128
-    char b1[LENGTH];
     GL_CALL(glCompileShader(shader));
     GL_CALL(glGetShaderiv(shader, GL_COMPILE_STATUS, &s));
-    GL_CALL(glGetShaderInfoLog(shader, LENGTH, NULL, b1));
 
     if (s == GL_FALSE)
     {
+        int length = 0;
+        GL_CALL(glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length));
+        std::string log(std::max(length, 1), '\0');
+        GL_CALL(glGetShaderInfoLog(shader, log.size(), NULL, log.data()));
         LOGE("Failed to load shader:\n", source,
-            "\nCompiler output:\n", b1);
+            "\nCompiler output:\n", log.c_str());
 
+        GL_CALL(glDeleteShader(shader));
         return -1;
     }
 
@@ -78,17 +373,45 @@ GLuint compile_shader(std::string source, GLuint type)
 /* Create a very simple gl program from the given shader sources */
 GLuint compile_program(std::string vertex_source, std::string frag_source)
 {
+    uint64_t key = binary_cache.get_key(vertex_source, frag_source);
+    if (GLuint cached = binary_cache.load(key))
+    {
+        return cached;
+    }
+
     auto vertex_shader   = compile_shader(vertex_source, GL_VERTEX_SHADER);
     auto fragment_shader = compile_shader(frag_source, GL_FRAGMENT_SHADER);
     auto result_program  = GL_CALL(glCreateProgram());
     GL_CALL(glAttachShader(result_program, vertex_shader));
     GL_CALL(glAttachShader(result_program, fragment_shader));
+    /* A GLES3 entry point, not available on GLES2-only drivers */
+    if (binary_cache.is_enabled())
+    {
+        GL_CALL(glProgramParameteri(result_program,
+            GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    }
+
     GL_CALL(glLinkProgram(result_program));
 
     /* won't be really deleted until program is deleted as well */
     GL_CALL(glDeleteShader(vertex_shader));
     GL_CALL(glDeleteShader(fragment_shader));
 
+    GLint status = GL_FALSE;
+    GL_CALL(glGetProgramiv(result_program, GL_LINK_STATUS, &status));
+    if (status == GL_FALSE)
+    {
+        int length = 0;
+        GL_CALL(glGetProgramiv(result_program, GL_INFO_LOG_LENGTH, &length));
+        std::string log(std::max(length, 1), '\0');
+        GL_CALL(glGetProgramInfoLog(result_program, log.size(), NULL,
+            log.data()));
+        LOGE("Failed to link program:\n", log.c_str());
+    } else
+    {
+        binary_cache.store(key, result_program);
+    }
+
     return result_program;
 }
 
@@ -102,12 +425,29 @@ void init()
     color_program.set_simple(compile_program(default_vertex_shader_source,
         color_rect_fragment_source));
 
+    auto resolve_handles = [] (program_t& prog, default_program_handles_t& handles)
+    {
+        handles.mvp   = prog.get_uniform("MVP");
+        handles.color = prog.get_uniform("color");
+        handles.position    = prog.get_attrib("position");
+        handles.uv_position = prog.get_attrib("uvPosition");
+    };
+
+    resolve_handles(program, texture_handles);
+    resolve_handles(color_program, color_handles);
+
     render_end();
 }
 
 void fini()
 {
     render_begin();
+    if (batch.vbo)
+    {
+        GL_CALL(glDeleteBuffers(1, &batch.vbo));
+        batch.vbo = 0;
+    }
+
     program.free_resources();
     color_program.free_resources();
     render_end();
@@ -128,6 +468,11 @@ void unbind_output()
     current_output_fb = 0;
 }
 
+uint64_t get_draw_call_count()
+{
+    return draw_call_count;
+}
+
 std::vector<GLfloat> vertexData;
 std::vector<GLfloat> coordData;
 
@@ -170,10 +515,10 @@ void render_transformed_texture(wf::texture_t tex,
     };
 
     program.set_active_texture(tex);
-    program.attrib_pointer("position", 2, 0, vertexData.data());
-    program.attrib_pointer("uvPosition", 2, 0, coordData.data());
-    program.uniformMatrix4f("MVP", model);
-    program.uniform4f("color", color);
+    program.attrib_pointer(texture_handles.position, 2, 0, vertexData.data());
+    program.attrib_pointer(texture_handles.uv_position, 2, 0, coordData.data());
+    program.uniformMatrix4f(texture_handles.mvp, model);
+    program.uniform4f(texture_handles.color, color);
 
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
@@ -190,6 +535,7 @@ void render_transformed_texture(wf::texture_t tex,
 void draw_cached()
 {
     GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
+    ++draw_call_count;
 }
 
 void clear_cached()
@@ -234,13 +580,15 @@ void render_rectangle(wf::geometry_t geometry, wf::color_t color,
         x, y,
     };
 
-    color_program.attrib_pointer("position", 2, 0, vertexData);
-    color_program.uniformMatrix4f("MVP", matrix);
-    color_program.uniform4f("color", {color.r, color.g, color.b, color.a});
+    color_program.attrib_pointer(color_handles.position, 2, 0, vertexData);
+    color_program.uniformMatrix4f(color_handles.mvp, matrix);
+    color_program.uniform4f(color_handles.color,
+        {color.r, color.g, color.b, color.a});
 
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
     GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
+    ++draw_call_count;
 
     color_program.deactivate();
 }
@@ -269,8 +617,18 @@ void render_begin()
         egl_make_current(wf::get_core_impl().egl);
     }
 
+    /* Somebody is about to draw directly, so pending quads have to be drawn
+     * first to keep the order of rendering. */
+    flush_batch();
+
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+    last_filtered_texture = {};
+}
+
+void invalidate_texture_cache()
+{
+    last_filtered_texture = {};
 }
 
 void render_begin(const wf::framebuffer_base_t& fb)
@@ -297,6 +655,248 @@ void render_end()
 {
     GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, current_output_fb));
     GL_CALL(glDisable(GL_SCISSOR_TEST));
+    last_filtered_texture = {};
+}
+
+void batch_texture(wf::texture_t texture, const wf::framebuffer_t& framebuffer,
+    const wf::geometry_t& geometry, const wf::region_t& damage,
+    glm::vec4 color, uint32_t bits)
+{
+    auto projection = framebuffer.get_orthographic_projection();
+    if (!is_axis_aligned(projection))
+    {
+        /* Cannot clip on the CPU, fall back to scissoring */
+        render_begin(framebuffer);
+        render_texture(texture, framebuffer, geometry, color,
+            (bits & ~RENDER_FLAG_NEAREST_MAG_FILTER) | RENDER_FLAG_CACHED);
+
+        /* render_texture() leaves the texture bound */
+        GLint old_filter = GL_LINEAR;
+        const bool nearest = bits & RENDER_FLAG_NEAREST_MAG_FILTER;
+        if (nearest)
+        {
+            GL_CALL(glGetTexParameteriv(texture.target, GL_TEXTURE_MAG_FILTER,
+                &old_filter));
+            GL_CALL(glTexParameteri(texture.target, GL_TEXTURE_MAG_FILTER,
+                GL_NEAREST));
+        }
+
+        for (const auto& rect : damage)
+        {
+            framebuffer.logic_scissor(wlr_box_from_pixman_box(rect));
+            draw_cached();
+        }
+
+        if (nearest)
+        {
+            GL_CALL(glTexParameteri(texture.target, GL_TEXTURE_MAG_FILTER,
+                old_filter));
+        }
+
+        clear_cached();
+        render_end();
+        return;
+    }
+
+    if ((batch.fb != framebuffer.fb) ||
+        (batch.viewport_width != framebuffer.viewport_width) ||
+        (batch.viewport_height != framebuffer.viewport_height))
+    {
+        flush_batch();
+        batch.fb = framebuffer.fb;
+        batch.viewport_width  = framebuffer.viewport_width;
+        batch.viewport_height = framebuffer.viewport_height;
+    }
+
+    const float w = framebuffer.viewport_width;
+    const float h = framebuffer.viewport_height;
+
+    /* Texture coordinates at the top-left and bottom-right corners of the
+     * quad, as in render_transformed_texture() */
+    glm::vec2 uv_tl = {0.0f, 1.0f};
+    glm::vec2 uv_br = {1.0f, 0.0f};
+    if (bits & TEXTURE_TRANSFORM_INVERT_X)
+    {
+        uv_tl.x = 1.0 - uv_tl.x;
+        uv_br.x = 1.0 - uv_br.x;
+    }
+
+    if (bits & TEXTURE_TRANSFORM_INVERT_Y)
+    {
+        uv_tl.y = 1.0 - uv_tl.y;
+        uv_br.y = 1.0 - uv_br.y;
+    }
+
+    /* The quad in framebuffer pixels (top-down, like scissor boxes) */
+    auto to_pixels = [&] (float x, float y)
+    {
+        auto ndc = projection * glm::vec4{x, y, 0.0f, 1.0f};
+        return glm::vec2{(ndc.x + 1.0f) / 2.0f * w, (1.0f - ndc.y) / 2.0f * h};
+    };
+
+    glm::vec2 corner_tl = to_pixels(geometry.x, geometry.y);
+    glm::vec2 corner_br = to_pixels(geometry.x + geometry.width,
+        geometry.y + geometry.height);
+    glm::vec2 quad_min = glm::min(corner_tl, corner_br);
+    glm::vec2 quad_max = glm::max(corner_tl, corner_br);
+
+    /* Interpolate the texture coordinates at the given pixel */
+    auto uv_at = [&] (glm::vec2 pixel)
+    {
+        glm::vec2 t = (pixel - corner_tl) / (corner_br - corner_tl);
+        /* Rotated framebuffer: the quad's x axis runs along pixel y */
+        if (projection[0][0] == 0)
+        {
+            t = {t.y, t.x};
+        }
+
+        return uv_tl + t * (uv_br - uv_tl);
+    };
+
+    const bool nearest = bits & RENDER_FLAG_NEAREST_MAG_FILTER;
+    if (batch.runs.empty() ||
+        !same_texture(batch.runs.back().texture, texture) ||
+        (batch.runs.back().color != color) ||
+        (batch.runs.back().nearest_mag_filter != nearest))
+    {
+        int first = batch.vertices.size() / batch_vertex_size;
+        batch.runs.push_back({texture, color, nearest, first, 0});
+    }
+
+    auto& run = batch.runs.back();
+    for (const auto& rect : damage)
+    {
+        /* Clip against the damage rectangle, rounded to whole pixels the same
+         * way as a scissor box would be */
+        auto box = framebuffer.framebuffer_box_from_geometry_box(
+            wlr_box_from_pixman_box(rect));
+        glm::vec2 clip_min = glm::max(quad_min, glm::vec2(box.x, box.y));
+        glm::vec2 clip_max = glm::min(quad_max,
+            glm::vec2(box.x + box.width, box.y + box.height));
+        if ((clip_min.x >= clip_max.x) || (clip_min.y >= clip_max.y))
+        {
+            continue;
+        }
+
+        const glm::vec2 corners[] = {
+            clip_min, {clip_max.x, clip_min.y}, clip_max,
+            clip_min, clip_max, {clip_min.x, clip_max.y},
+        };
+
+        for (auto& pixel : corners)
+        {
+            glm::vec2 uv = uv_at(pixel);
+            batch.vertices.insert(batch.vertices.end(), {
+                pixel.x / w * 2.0f - 1.0f, 1.0f - pixel.y / h * 2.0f,
+                uv.x, uv.y,
+            });
+        }
+
+        run.count += 6;
+    }
+
+    if (run.count == 0)
+    {
+        batch.runs.pop_back();
+    }
+
+    if (batch.scope_depth == 0)
+    {
+        flush_batch();
+    }
+}
+
+void begin_batch()
+{
+    ++batch.scope_depth;
+}
+
+void end_batch()
+{
+    if (--batch.scope_depth == 0)
+    {
+        flush_batch();
+    }
+}
+
+void flush_batch()
+{
+    if (batch.runs.empty())
+    {
+        return;
+    }
+
+    if (!egl_is_current(wf::get_core_impl().egl))
+    {
+        egl_make_current(wf::get_core_impl().egl);
+    }
+
+    GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, batch.fb));
+    GL_CALL(glViewport(0, 0, batch.viewport_width, batch.viewport_height));
+    GL_CALL(glDisable(GL_SCISSOR_TEST));
+    GL_CALL(glEnable(GL_BLEND));
+    GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+
+    if (!batch.vbo)
+    {
+        GL_CALL(glGenBuffers(1, &batch.vbo));
+    }
+
+    /* Re-specify the whole buffer so that the driver can orphan the storage
+     * used by the previous flush */
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, batch.vbo));
+    GL_CALL(glBufferData(GL_ARRAY_BUFFER, batch.vertices.size() * sizeof(GLfloat),
+        batch.vertices.data(), GL_STREAM_DRAW));
+
+    const int stride = batch_vertex_size * sizeof(GLfloat);
+    int current_type = -1;
+    for (auto& run : batch.runs)
+    {
+        if (run.texture.type != current_type)
+        {
+            if (current_type >= 0)
+            {
+                program.deactivate();
+            }
+
+            current_type = run.texture.type;
+            program.use(run.texture.type);
+            program.attrib_pointer(texture_handles.position, 2, stride, (void*)0);
+            program.attrib_pointer(texture_handles.uv_position, 2, stride,
+                (void*)(2 * sizeof(GLfloat)));
+            program.uniformMatrix4f(texture_handles.mvp, glm::mat4(1.0));
+        }
+
+        program.set_active_texture(run.texture);
+
+        /* The filter is changed only for the run, so that textures keep the
+         * filter set by their owner */
+        GLint old_filter = GL_LINEAR;
+        if (run.nearest_mag_filter)
+        {
+            GL_CALL(glGetTexParameteriv(run.texture.target,
+                GL_TEXTURE_MAG_FILTER, &old_filter));
+            GL_CALL(glTexParameteri(run.texture.target, GL_TEXTURE_MAG_FILTER,
+                GL_NEAREST));
+        }
+
+        program.uniform4f(texture_handles.color, run.color);
+        GL_CALL(glDrawArrays(GL_TRIANGLES, run.first, run.count));
+        ++draw_call_count;
+
+        if (run.nearest_mag_filter)
+        {
+            GL_CALL(glTexParameteri(run.texture.target, GL_TEXTURE_MAG_FILTER,
+                old_filter));
+        }
+    }
+
+    program.deactivate();
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, current_output_fb));
+
+    batch.vertices.clear();
+    batch.runs.clear();
 }
 }
 
@@ -335,6 +935,7 @@ bool wf::framebuffer_base_t::allocate(int width, int height)
     {
         first_allocate = true;
         GL_CALL(glGenTextures(1, &tex));
+        OpenGL::invalidate_texture_cache();
         GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
@@ -436,6 +1037,7 @@ void wf::framebuffer_base_t::release()
     if ((tex != uint32_t(-1)) && ((fb != 0) || (tex != 0)))
     {
         GL_CALL(glDeleteTextures(1, &tex));
+        OpenGL::invalidate_texture_cache();
     }
 
     reset();
@@ -588,43 +1190,124 @@ namespace OpenGL
 class program_t::impl
 {
   public:
-    std::set<int> active_attrs;
-    std::set<int> active_attrs_divisors;
+    uint64_t active_attrs = 0;
+    uint64_t active_attrs_divisors = 0;
 
     int active_program_idx = 0;
 
     int id[wf::TEXTURE_TYPE_ALL];
-    std::unordered_map<std::string, int> uniforms[wf::TEXTURE_TYPE_ALL];
 
-    /** Find the uniform location for the currently bound program */
-    int find_uniform_loc(const std::string& name)
+    struct uniform_slot_t
     {
-        auto it = uniforms[active_program_idx].find(name);
-        if (it != uniforms[active_program_idx].end())
+        std::string name;
+        int location[wf::TEXTURE_TYPE_ALL];
+
+        /* The last value set for the uniform in each program */
+        bool has_value[wf::TEXTURE_TYPE_ALL];
+        float value[wf::TEXTURE_TYPE_ALL][16];
+    };
+
+    struct attrib_slot_t
+    {
+        std::string name;
+        int location[wf::TEXTURE_TYPE_ALL];
+    };
+
+    std::vector<uniform_slot_t> uniforms;
+    std::unordered_map<std::string, int> uniform_index;
+
+    std::vector<attrib_slot_t> attribs;
+    std::unordered_map<std::string, int> attrib_index;
+
+    /* Builtin uniforms used by set_active_texture() */
+    uniform_t uv_base, uv_scale;
+
+    /* Sources of a program whose compilation is deferred until first use */
+    struct pending_sources_t
+    {
+        std::string vertex;
+        std::string fragment;
+        /* Whether to create a simple program, see set_simple_lazy() */
+        bool simple;
+        wf::texture_type_t type;
+    };
+
+    std::optional<pending_sources_t> pending;
+
+    void resolve(uniform_slot_t& slot)
+    {
+        for (int i = 0; i < wf::TEXTURE_TYPE_ALL; i++)
         {
-            return it->second;
+            slot.location[i] = -1;
+            if (id[i])
+            {
+                slot.location[i] =
+                    GL_CALL(glGetUniformLocation(id[i], slot.name.c_str()));
+            }
+
+            slot.has_value[i] = false;
         }
+    }
 
-        uniforms[active_program_idx][name] =
-            GL_CALL(glGetUniformLocation(id[active_program_idx], name.c_str()));
+    void resolve(attrib_slot_t& slot)
+    {
+        for (int i = 0; i < wf::TEXTURE_TYPE_ALL; i++)
+        {
+            slot.location[i] = -1;
+            if (id[i])
+            {
+                slot.location[i] =
+                    GL_CALL(glGetAttribLocation(id[i], slot.name.c_str()));
+            }
+        }
+    }
+
+    /** Resolve all known uniforms and attributes after the programs changed. */
+    void resolve_all()
+    {
+        for (auto& slot : uniforms)
+        {
+            resolve(slot);
+        }
 
-        return uniforms[active_program_idx][name];
+        for (auto& slot : attribs)
+        {
+            resolve(slot);
+        }
     }
 
-    std::map<std::string, int> attribs[wf::TEXTURE_TYPE_ALL];
-    /** Find the attrib location for the currently bound program */
-    int find_attrib_loc(const std::string& name)
+    /**
+     * Check whether the uniform needs to be updated in the currently bound
+     * program, and remember @value as its new value.
+     *
+     * @return The uniform location, or -1 if the uniform does not exist or
+     *   already has the given value.
+     */
+    int update_uniform(uniform_t uniform, const float *value, int count)
     {
-        auto it = attribs[active_program_idx].find(name);
-        if (it != attribs[active_program_idx].end())
+        auto& slot = uniforms.at(uniform.index);
+        int idx    = active_program_idx;
+        if (slot.location[idx] < 0)
+        {
+            return -1;
+        }
+
+        size_t size = count * sizeof(float);
+        if (slot.has_value[idx] && !std::memcmp(slot.value[idx], value, size))
         {
-            return it->second;
+            return -1;
         }
 
-        attribs[active_program_idx][name] =
-            GL_CALL(glGetAttribLocation(id[active_program_idx], name.c_str()));
+        std::memcpy(slot.value[idx], value, size);
+        slot.has_value[idx] = true;
 
-        return attribs[active_program_idx][name];
+        return slot.location[idx];
+    }
+
+    /** Find the attrib location for the currently bound program */
+    int find_attrib_loc(attrib_t attrib)
+    {
+        return attribs.at(attrib.index).location[active_program_idx];
     }
 };
 
@@ -635,6 +1318,9 @@ program_t::program_t()
     {
         this->priv->id[i] = 0;
     }
+
+    priv->uv_base  = get_uniform("_wayfire_uv_base");
+    priv->uv_scale = get_uniform("_wayfire_uv_scale");
 }
 
 void program_t::set_simple(GLuint program_id, wf::texture_type_t type)
@@ -642,6 +1328,7 @@ void program_t::set_simple(GLuint program_id, wf::texture_type_t type)
     free_resources();
     assert(type < wf::TEXTURE_TYPE_ALL);
     this->priv->id[type] = program_id;
+    priv->resolve_all();
 }
 
 program_t::~program_t()
@@ -688,10 +1375,50 @@ void program_t::compile(const std::string& vertex_source,
         this->priv->id[program_type.first] =
             compile_program(vertex_source, fragment);
     }
+
+    priv->resolve_all();
+}
+
+void program_t::compile_lazy(const std::string& vertex_source,
+    const std::string& fragment_source)
+{
+    free_resources();
+    priv->pending = impl::pending_sources_t{vertex_source, fragment_source,
+        false, wf::TEXTURE_TYPE_ALL};
+}
+
+void program_t::set_simple_lazy(const std::string& vertex_source,
+    const std::string& fragment_source, wf::texture_type_t type)
+{
+    free_resources();
+    assert(type < wf::TEXTURE_TYPE_ALL);
+    priv->pending = impl::pending_sources_t{vertex_source, fragment_source,
+        true, type};
+}
+
+void program_t::compile_pending()
+{
+    if (!priv->pending)
+    {
+        return;
+    }
+
+    auto sources = std::move(*priv->pending);
+    priv->pending.reset();
+    if (sources.simple)
+    {
+        set_simple(compile_program(sources.vertex, sources.fragment),
+            sources.type);
+    } else
+    {
+        compile(sources.vertex, sources.fragment);
+    }
 }
 
 void program_t::free_resources()
 {
+    priv->pending.reset();
+
     for (int i = 0; i < wf::TEXTURE_TYPE_ALL; i++)
     {
         if (this->priv->id[i])
@@ -700,10 +1427,13 @@ void program_t::free_resources()
             this->priv->id[i] = 0;
         }
     }
+
+    priv->resolve_all();
 }
 
 void program_t::use(wf::texture_type_t type)
 {
+    compile_pending();
     if (priv->id[type] == 0)
     {
         throw std::runtime_error("program_t has no program for type " +
@@ -716,67 +1446,185 @@ void program_t::use(wf::texture_type_t type)
 
 int program_t::get_program_id(wf::texture_type_t type)
 {
+    compile_pending();
     return priv->id[type];
 }
 
+uniform_t program_t::get_uniform(const std::string& name)
+{
+    auto it = priv->uniform_index.find(name);
+    if (it != priv->uniform_index.end())
+    {
+        return {it->second};
+    }
+
+    int index = priv->uniforms.size();
+    priv->uniforms.emplace_back();
+    priv->uniforms.back().name = name;
+    priv->resolve(priv->uniforms.back());
+    priv->uniform_index[name] = index;
+
+    return {index};
+}
+
+attrib_t program_t::get_attrib(const std::string& name)
+{
+    auto it = priv->attrib_index.find(name);
+    if (it != priv->attrib_index.end())
+    {
+        return {it->second};
+    }
+
+    int index = priv->attribs.size();
+    priv->attribs.emplace_back();
+    priv->attribs.back().name = name;
+    priv->resolve(priv->attribs.back());
+    priv->attrib_index[name] = index;
+
+    return {index};
+}
+
+void program_t::uniform1i(uniform_t uniform, int value)
+{
+    float data;
+    static_assert(sizeof(data) == sizeof(value), "int and float differ in size");
+    std::memcpy(&data, &value, sizeof(value));
+
+    int loc = priv->update_uniform(uniform, &data, 1);
+    if (loc >= 0)
+    {
+        GL_CALL(glUniform1i(loc, value));
+    }
+}
+
+void program_t::uniform1f(uniform_t uniform, float value)
+{
+    int loc = priv->update_uniform(uniform, &value, 1);
+    if (loc >= 0)
+    {
+        GL_CALL(glUniform1f(loc, value));
+    }
+}
+
+void program_t::uniform2f(uniform_t uniform, float x, float y)
+{
+    const float data[] = {x, y};
+    int loc = priv->update_uniform(uniform, data, 2);
+    if (loc >= 0)
+    {
+        GL_CALL(glUniform2f(loc, x, y));
+    }
+}
+
+void program_t::uniform3f(uniform_t uniform, float x, float y, float z)
+{
+    const float data[] = {x, y, z};
+    int loc = priv->update_uniform(uniform, data, 3);
+    if (loc >= 0)
+    {
+        GL_CALL(glUniform3f(loc, x, y, z));
+    }
+}
+
+void program_t::uniform4f(uniform_t uniform, const glm::vec4& value)
+{
+    int loc = priv->update_uniform(uniform, &value[0], 4);
+    if (loc >= 0)
+    {
+        GL_CALL(glUniform4f(loc, value.r, value.g, value.b, value.a));
+    }
+}
+
+void program_t::uniformMatrix4f(uniform_t uniform, const glm::mat4& value)
+{
+    int loc = priv->update_uniform(uniform, &value[0][0], 16);
+    if (loc >= 0)
+    {
+        GL_CALL(glUniformMatrix4fv(loc, 1, GL_FALSE, &value[0][0]));
+    }
+}
+
 void program_t::uniform1i(const std::string& name, int value)
 {
-    int loc = priv->find_uniform_loc(name);
-    GL_CALL(glUniform1i(loc, value));
+    uniform1i(get_uniform(name), value);
 }
 
 void program_t::uniform1f(const std::string& name, float value)
 {
-    int loc = priv->find_uniform_loc(name);
-    GL_CALL(glUniform1f(loc, value));
+    uniform1f(get_uniform(name), value);
 }
 
 void program_t::uniform2f(const std::string& name, float x, float y)
 {
-    int loc = priv->find_uniform_loc(name);
-    GL_CALL(glUniform2f(loc, x, y));
+    uniform2f(get_uniform(name), x, y);
 }
 
 void program_t::uniform3f(const std::string& name, float x, float y, float z)
 {
-    int loc = priv->find_uniform_loc(name);
-    GL_CALL(glUniform3f(loc, x, y, z));
+    uniform3f(get_uniform(name), x, y, z);
 }
 
 void program_t::uniform4f(const std::string& name, const glm::vec4& value)
 {
-    int loc = priv->find_uniform_loc(name);
-    GL_CALL(glUniform4f(loc, value.r, value.g, value.b, value.a));
+    uniform4f(get_uniform(name), value);
 }
 
 void program_t::uniformMatrix4f(const std::string& name, const glm::mat4& value)
 {
-    int loc = priv->find_uniform_loc(name);
-    GL_CALL(glUniformMatrix4fv(loc, 1, GL_FALSE, &value[0][0]));
+    uniformMatrix4f(get_uniform(name), value);
 }
 
-void program_t::attrib_pointer(const std::string& attrib,
+void program_t::attrib_pointer(attrib_t attrib,
     int size, int stride, const void *ptr, GLenum type)
 {
     int loc = priv->find_attrib_loc(attrib);
-    priv->active_attrs.insert(loc);
+    if (loc < 0)
+    {
+        return;
+    }
+
+    assert(loc < 64);
+    priv->active_attrs |= (1ull << loc);
 
     GL_CALL(glEnableVertexAttribArray(loc));
     GL_CALL(glVertexAttribPointer(loc, size, type, GL_FALSE, stride, ptr));
 }
 
-void program_t::attrib_divisor(const std::string& attrib, int divisor)
+void program_t::attrib_divisor(attrib_t attrib, int divisor)
 {
     int loc = priv->find_attrib_loc(attrib);
-    priv->active_attrs_divisors.insert(loc);
+    if (loc < 0)
+    {
+        return;
+    }
+
+    assert(loc < 64);
+    priv->active_attrs_divisors |= (1ull << loc);
     GL_CALL(glVertexAttribDivisor(loc, divisor));
 }
 
+void program_t::attrib_pointer(const std::string& attrib,
+    int size, int stride, const void *ptr, GLenum type)
+{
+    attrib_pointer(get_attrib(attrib), size, stride, ptr, type);
+}
+
+void program_t::attrib_divisor(const std::string& attrib, int divisor)
+{
+    attrib_divisor(get_attrib(attrib), divisor);
+}
+
 void program_t::set_active_texture(const wf::texture_t& texture)
 {
     GL_CALL(glActiveTexture(GL_TEXTURE0));
     GL_CALL(glBindTexture(texture.target, texture.tex_id));
-    GL_CALL(glTexParameteri(texture.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    if ((last_filtered_texture.target != texture.target) ||
+        (last_filtered_texture.tex_id != texture.tex_id))
+    {
+        GL_CALL(glTexParameteri(texture.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        last_filtered_texture.target = texture.target;
+        last_filtered_texture.tex_id = texture.tex_id;
+    }
 
     glm::vec2 base{0.0f, 0.0f};
     glm::vec2 scale{1.0f, 1.0f};
@@ -795,24 +1643,24 @@ void program_t::set_active_texture(const wf::texture_t& texture)
         base.y   = 1.0 - base.y;
     }
 
-    uniform2f("_wayfire_uv_base", base.x, base.y);
-    uniform2f("_wayfire_uv_scale", scale.x, scale.y);
+    uniform2f(priv->uv_base, base.x, base.y);
+    uniform2f(priv->uv_scale, scale.x, scale.y);
 }
 
 void program_t::deactivate()
 {
-    for (int loc : priv->active_attrs_divisors)
+    for (uint64_t mask = priv->active_attrs_divisors; mask; mask &= mask - 1)
     {
-        GL_CALL(glVertexAttribDivisor(loc, 0));
+        GL_CALL(glVertexAttribDivisor(__builtin_ctzll(mask), 0));
     }
 
-    for (int loc : priv->active_attrs)
+    for (uint64_t mask = priv->active_attrs; mask; mask &= mask - 1)
     {
-        GL_CALL(glDisableVertexAttribArray(loc));
+        GL_CALL(glDisableVertexAttribArray(__builtin_ctzll(mask)));
     }
 
-    priv->active_attrs_divisors.clear();
-    priv->active_attrs.clear();
+    priv->active_attrs_divisors = 0;
+    priv->active_attrs = 0;
     GL_CALL(glUseProgram(0));
 }
 }
@@ -250,89 +250,298 @@ inline bool is_shutting_down()
     return wf::get_core().get_current_state() == compositor_state_t::SHUTDOWN;
 }
 
+/**
+ * Mirrors the contents of one output onto another.
+ *
+ * Only the parts of the source which were damaged by its last commits are
+ * copied and repainted on the destination. If the source buffer can be
+ * displayed on the destination as-is (same size and a supported format), it is
+ * scanned out directly without any copies.
+ */
 class output_cloner_t
 {
+    wf::wl_listener_wrapper source_precommit;
     wf::wl_listener_wrapper source_commit;
     wf::wl_listener_wrapper destination_frame;
+    wf::wl_listener_wrapper on_damage_destroy;
     wf::framebuffer_base_t content;
 
     wlr_output *source;
     wlr_output *destination;
+    wlr_output_damage *destination_damage;
 
-  public:
-    output_cloner_t(wlr_output *source, wlr_output *destination)
+    /* Damage of the buffer the source is about to commit, in buffer-local
+     * coordinates. Empty means that the whole buffer is damaged. */
+    wf::region_t source_damage;
+    /* Whether content contains the latest source buffer */
+    bool content_valid = false;
+
+    /* The latest source buffer, if it is to be scanned out directly */
+    wlr_buffer *scanout_buffer = nullptr;
+    /* Cleared as soon as the destination rejects a source buffer */
+    bool can_scanout = true;
+    /* Whether the last frame on the destination was scanned out */
+    bool last_scanout = false;
+
+    static wf::geometry_t get_buffer_box(wlr_buffer *buffer)
     {
-        this->source = source;
-        this->destination = destination;
-        wlr_output_lock_software_cursors(source, true);
-        wlr_output_schedule_frame(destination);
+        return {0, 0, buffer->width, buffer->height};
+    }
 
-        source_commit.set_callback([=] (void *data)
+    void release_scanout_buffer()
+    {
+        if (scanout_buffer)
         {
-            auto ev = (wlr_output_event_commit*)data;
-            if (!(ev->committed & WLR_OUTPUT_STATE_BUFFER))
-            {
-                // Something else than the output contents changed, nothing to do yet
-                return;
-            }
+            wlr_buffer_unlock(scanout_buffer);
+            scanout_buffer = nullptr;
+        }
+    }
 
-            int w = ev->buffer->width;
-            int h = ev->buffer->height;
+    /**
+     * Limit rendering to a rectangle of an output buffer.
+     *
+     * Buffer-local damage is top-down, but output buffers are already
+     * y-inverted, so the box is used as-is, unlike framebuffer_base_t::scissor().
+     */
+    static void scissor_buffer_box(const pixman_box32_t& box)
+    {
+        GL_CALL(glEnable(GL_SCISSOR_TEST));
+        GL_CALL(glScissor(box.x1, box.y1, box.x2 - box.x1, box.y2 - box.y1));
+    }
 
-            OpenGL::render_begin();
-            content.allocate(w, h);
+    /**
+     * Copy the damaged region of the buffer into content.
+     *
+     * @param damage The damaged region in buffer-local coordinates.
+     */
+    void copy_buffer(wlr_buffer *buffer, wf::region_t damage)
+    {
+        int w = buffer->width;
+        int h = buffer->height;
+
+        OpenGL::render_begin();
+        if (content.allocate(w, h) || !content_valid)
+        {
+            damage = get_buffer_box(buffer);
+        }
 
-            // Bind buffer
-            auto renderer = get_core().renderer;
-            wlr_renderer_begin_with_buffer(renderer, ev->buffer);
+        // Bind buffer
+        auto renderer = get_core().renderer;
+        wlr_renderer_begin_with_buffer(renderer, buffer);
 
-            // Store a copy for ourselves
-            GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, content.fb));
+        // Store a copy for ourselves
+        GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, content.fb));
+        for (const auto& rect : damage)
+        {
+            scissor_buffer_box(rect);
             GL_CALL(glBlitFramebuffer(0, 0, w, h,
                 0, 0, w, h,
-                GL_COLOR_BUFFER_BIT, GL_LINEAR));
+                GL_COLOR_BUFFER_BIT, GL_NEAREST));
+        }
 
-            wlr_renderer_end(renderer);
-            OpenGL::render_end();
+        wlr_renderer_end(renderer);
+        OpenGL::render_end();
+        content_valid = true;
+    }
+
+    /**
+     * Damage the destination.
+     *
+     * @param damage The damaged region in source buffer-local coordinates.
+     */
+    void damage_destination(const wf::region_t& damage, int w, int h)
+    {
+        /* The whole buffer is scaled to fit the destination */
+        wf::region_t scaled;
+        wlr_region_scale_xy(scaled.to_pixman(),
+            const_cast<wf::region_t&>(damage).to_pixman(),
+            1.0 * destination->width / w, 1.0 * destination->height / h);
+        /* Account for linear filtering */
+        if ((w != destination->width) || (h != destination->height))
+        {
+            scaled.expand_edges(1);
+        }
 
-            wlr_output_damage_whole(destination);
+        /* wlr_output_damage works with transformed output coordinates */
+        wlr_region_transform(scaled.to_pixman(), scaled.to_pixman(),
+            destination->transform, destination->width, destination->height);
+        wlr_output_damage_add(destination_damage, scaled.to_pixman());
+    }
+
+    void handle_source_commit(wlr_output_event_commit *ev)
+    {
+        wf::region_t damage = get_buffer_box(ev->buffer);
+        if (!source_damage.empty())
+        {
+            damage &= source_damage;
+        }
+
+        source_damage.clear();
+
+        if (can_scanout && (ev->buffer->width == destination->width) &&
+            (ev->buffer->height == destination->height))
+        {
+            release_scanout_buffer();
+            scanout_buffer = wlr_buffer_lock(ev->buffer);
+            content_valid  = false;
             wlr_output_schedule_frame(destination);
-        });
+            return;
+        }
 
-        destination_frame.set_callback([=] (void *data)
+        release_scanout_buffer();
+        copy_buffer(ev->buffer, damage);
+        damage_destination(damage, ev->buffer->width, ev->buffer->height);
+    }
+
+    /** Try to show the latest source buffer directly on the destination. */
+    bool try_scanout()
+    {
+        wlr_output_attach_buffer(destination, scanout_buffer);
+        if (wlr_output_test(destination) && wlr_output_commit(destination))
         {
-            auto renderer = get_core().renderer;
-            wlr_output_attach_render(destination, NULL);
-            wlr_renderer_begin(renderer, destination->width, destination->height);
+            release_scanout_buffer();
+            last_scanout = true;
+            return true;
+        }
 
-            int w = content.viewport_width;
-            int h = content.viewport_height;
-            if ((w > 0) && (h > 0))
-            {
-                int current_fb;
-                GL_CALL(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &current_fb));
-                OpenGL::bind_output(current_fb);
+        wlr_output_rollback(destination);
+        LOGI("Cannot scan out ", source->name, " on ", destination->name,
+            ", falling back to copying.");
+        can_scanout = false;
+
+        /* Copy the buffer instead */
+        copy_buffer(scanout_buffer, get_buffer_box(scanout_buffer));
+        release_scanout_buffer();
+        wlr_output_damage_add_whole(destination_damage);
 
-                OpenGL::render_begin();
-                GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, content.fb));
+        return false;
+    }
+
+    void render_destination()
+    {
+        if (scanout_buffer && try_scanout())
+        {
+            return;
+        }
+
+        if (last_scanout)
+        {
+            /* Buffer ages are not tracked for scanned out buffers */
+            wlr_output_damage_add_whole(destination_damage);
+            last_scanout = false;
+        }
+
+        bool needs_frame;
+        wf::region_t damage;
+        if (!wlr_output_damage_attach_render(destination_damage, &needs_frame,
+            damage.to_pixman()))
+        {
+            return;
+        }
+
+        if (!needs_frame)
+        {
+            wlr_output_rollback(destination);
+            return;
+        }
+
+        /* Damage is in transformed output coordinates, convert to buffer */
+        int tw, th;
+        wlr_output_transformed_resolution(destination, &tw, &th);
+        wlr_region_transform(damage.to_pixman(), damage.to_pixman(),
+            wlr_output_transform_invert(destination->transform), tw, th);
+
+        auto renderer = get_core().renderer;
+        wlr_renderer_begin(renderer, destination->width, destination->height);
+
+        int w = content.viewport_width;
+        int h = content.viewport_height;
+        if ((w > 0) && (h > 0))
+        {
+            int current_fb;
+            GL_CALL(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &current_fb));
+            OpenGL::bind_output(current_fb);
+
+            OpenGL::render_begin();
+            GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, content.fb));
+            for (const auto& rect : damage)
+            {
+                scissor_buffer_box(rect);
                 GL_CALL(glBlitFramebuffer(0, 0, w, h,
                     0, 0, destination->width, destination->height,
                     GL_COLOR_BUFFER_BIT, GL_LINEAR));
+            }
+
+            OpenGL::render_end();
+            OpenGL::unbind_output();
+        }
+
+        wlr_renderer_end(renderer);
+        wlr_output_set_damage(destination, damage.to_pixman());
+        wlr_output_commit(destination);
+    }
+
+  public:
+    output_cloner_t(wlr_output *source, wlr_output *destination)
+    {
+        this->source = source;
+        this->destination = destination;
+        wlr_output_lock_software_cursors(source, true);
+
+        destination_damage = wlr_output_damage_create(destination);
+        on_damage_destroy.set_callback([=] (void*)
+        {
+            destination_damage = nullptr;
+            destination_frame.disconnect();
+        });
+        on_damage_destroy.connect(&destination_damage->events.destroy);
 
-                OpenGL::render_end();
+        source_precommit.set_callback([=] (void*)
+        {
+            if (source->pending.committed & WLR_OUTPUT_STATE_DAMAGE)
+            {
+                source_damage = wf::region_t{&source->pending.damage};
+            } else
+            {
+                source_damage.clear();
             }
+        });
 
-            wlr_renderer_end(renderer);
-            wlr_output_commit(destination);
+        source_commit.set_callback([=] (void *data)
+        {
+            auto ev = (wlr_output_event_commit*)data;
+            if (!(ev->committed & WLR_OUTPUT_STATE_BUFFER))
+            {
+                // Something else than the output contents changed, nothing to do yet
+                return;
+            }
+
+            handle_source_commit(ev);
         });
 
+        destination_frame.set_callback([=] (void *data)
+        {
+            render_destination();
+        });
+
+        source_precommit.connect(&source->events.precommit);
         source_commit.connect(&source->events.commit);
-        destination_frame.connect(&destination->events.frame);
+        destination_frame.connect(&destination_damage->events.frame);
+        wlr_output_damage_add_whole(destination_damage);
     }
 
     ~output_cloner_t()
     {
         wlr_output_lock_software_cursors(source, false);
+        release_scanout_buffer();
+
+        on_damage_destroy.disconnect();
+        destination_frame.disconnect();
+        if (destination_damage)
+        {
+            wlr_output_damage_destroy(destination_damage);
+        }
+
         OpenGL::render_begin();
         content.release();
         OpenGL::render_end();
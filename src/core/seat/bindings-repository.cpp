@@ -2,120 +2,213 @@
 #include <wayfire/core.hpp>
 #include <algorithm>
 
+namespace
+{
+/**
+ * A list of the callbacks matching an event. Usually only a few bindings
+ * match, and they are stored without allocating.
+ */
+template<class T, size_t N = 8>
+class callback_list_t
+{
+  public:
+    void push_back(T item)
+    {
+        if (count < N)
+        {
+            inline_items[count++] = item;
+        } else
+        {
+            overflow.push_back(item);
+        }
+    }
+
+    template<class F>
+    void for_each(F&& func) const
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            func(inline_items[i]);
+        }
+
+        for (auto& item : overflow)
+        {
+            func(item);
+        }
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+  private:
+    T inline_items[N];
+    size_t count = 0;
+    std::vector<T> overflow;
+};
+}
+
+static uint64_t get_index_key(uint32_t modifiers, uint32_t code)
+{
+    return ((uint64_t)modifiers << 32) | code;
+}
+
 bool wf::bindings_repository_t::handle_key(const wf::keybinding_t& pressed,
     uint32_t mod_binding_key)
 {
-    std::vector<std::function<bool()>> callbacks;
-    for (auto& binding : this->keys)
+    auto index_key = get_index_key(pressed.get_modifiers(), pressed.get_key());
+    auto it = key_index.find(index_key);
+    if (it == key_index.end())
     {
-        if (binding->activated_by->get_value() == pressed)
+        binding_matches_t<key_callback> matches;
+        for (auto& binding : this->keys)
         {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->callback;
-            callbacks.emplace_back([pressed, callback] ()
+            if (binding->activated_by->get_value() == pressed)
             {
-                return (*callback)(pressed);
-            });
+                matches.bindings.push_back(binding->callback);
+            }
         }
-    }
 
-    for (auto& binding : this->activators)
-    {
-        if (binding->activated_by->get_value().has_match(pressed))
+        for (auto& binding : this->activators)
         {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->callback;
-            callbacks.emplace_back([pressed, callback, mod_binding_key] ()
+            if (binding->activated_by->get_value().has_match(pressed))
             {
-                wf::activator_data_t ev = {
-                    .source = activator_source_t::KEYBINDING,
-                    .activation_data = pressed.get_key()
-                };
+                matches.activators.push_back(binding->callback);
+            }
+        }
 
-                if (mod_binding_key)
-                {
-                    ev.source = activator_source_t::MODIFIERBINDING;
-                    ev.activation_data = mod_binding_key;
-                }
+        it = key_index.emplace(index_key, std::move(matches)).first;
+    }
 
-                return (*callback)(ev);
-            });
-        }
+    /* We must be careful because the callbacks might add or remove bindings,
+     * which drops the index, so copy the callbacks first */
+    callback_list_t<key_callback*> key_callbacks;
+    callback_list_t<activator_callback*> activator_callbacks;
+    for (auto callback : it->second.bindings)
+    {
+        key_callbacks.push_back(callback);
+    }
+
+    for (auto callback : it->second.activators)
+    {
+        activator_callbacks.push_back(callback);
     }
 
     bool handled = false;
-    for (auto& cb : callbacks)
+    key_callbacks.for_each([&] (key_callback *callback)
     {
-        handled |= cb();
+        handled |= (*callback)(pressed);
+    });
+
+    wf::activator_data_t ev = {
+        .source = activator_source_t::KEYBINDING,
+        .activation_data = pressed.get_key()
+    };
+
+    if (mod_binding_key)
+    {
+        ev.source = activator_source_t::MODIFIERBINDING;
+        ev.activation_data = mod_binding_key;
     }
 
+    activator_callbacks.for_each([&] (activator_callback *callback)
+    {
+        handled |= (*callback)(ev);
+    });
+
     return handled;
 }
 
 bool wf::bindings_repository_t::handle_axis(uint32_t modifiers,
     wlr_pointer_axis_event *ev)
 {
-    std::vector<wf::axis_callback*> callbacks;
-
-    for (auto& binding : this->axes)
+    auto index_key = get_index_key(modifiers, 0);
+    auto it = axis_index.find(index_key);
+    if (it == axis_index.end())
     {
-        if (binding->activated_by->get_value() == wf::keybinding_t{modifiers, 0})
+        binding_matches_t<axis_callback> matches;
+        for (auto& binding : this->axes)
         {
-            callbacks.push_back(binding->callback);
+            if (binding->activated_by->get_value() ==
+                wf::keybinding_t{modifiers, 0})
+            {
+                matches.bindings.push_back(binding->callback);
+            }
         }
+
+        it = axis_index.emplace(index_key, std::move(matches)).first;
     }
 
-    for (auto call : callbacks)
+    callback_list_t<axis_callback*> callbacks;
+    for (auto callback : it->second.bindings)
     {
-        (*call)(ev);
+        callbacks.push_back(callback);
     }
 
+    callbacks.for_each([&] (axis_callback *callback)
+    {
+        (*callback)(ev);
+    });
+
     return !callbacks.empty();
 }
 
 bool wf::bindings_repository_t::handle_button(const wf::buttonbinding_t& pressed)
 {
-    std::vector<std::function<bool()>> callbacks;
-    for (auto& binding : this->buttons)
+    auto index_key = get_index_key(pressed.get_modifiers(), pressed.get_button());
+    auto it = button_index.find(index_key);
+    if (it == button_index.end())
     {
-        if (binding->activated_by->get_value() == pressed)
+        binding_matches_t<button_callback> matches;
+        for (auto& binding : this->buttons)
         {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->callback;
-            callbacks.emplace_back([=] ()
+            if (binding->activated_by->get_value() == pressed)
             {
-                return (*callback)(pressed);
-            });
+                matches.bindings.push_back(binding->callback);
+            }
         }
-    }
 
-    for (auto& binding : this->activators)
-    {
-        if (binding->activated_by->get_value().has_match(pressed))
+        for (auto& binding : this->activators)
         {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->callback;
-            callbacks.emplace_back([=] ()
+            if (binding->activated_by->get_value().has_match(pressed))
             {
-                wf::activator_data_t data = {
-                    .source = activator_source_t::BUTTONBINDING,
-                    .activation_data = pressed.get_button(),
-                };
-                return (*callback)(data);
-            });
+                matches.activators.push_back(binding->callback);
+            }
         }
+
+        it = button_index.emplace(index_key, std::move(matches)).first;
     }
 
-    bool binding_handled = false;
-    for (auto call : callbacks)
+    /* We must be careful because the callbacks might add or remove bindings,
+     * which drops the index, so copy the callbacks first */
+    callback_list_t<button_callback*> button_callbacks;
+    callback_list_t<activator_callback*> activator_callbacks;
+    for (auto callback : it->second.bindings)
     {
-        binding_handled |= call();
+        button_callbacks.push_back(callback);
     }
 
+    for (auto callback : it->second.activators)
+    {
+        activator_callbacks.push_back(callback);
+    }
+
+    bool binding_handled = false;
+    button_callbacks.for_each([&] (button_callback *callback)
+    {
+        binding_handled |= (*callback)(pressed);
+    });
+
+    wf::activator_data_t data = {
+        .source = activator_source_t::BUTTONBINDING,
+        .activation_data = pressed.get_button(),
+    };
+    activator_callbacks.for_each([&] (activator_callback *callback)
+    {
+        binding_handled |= (*callback)(data);
+    });
+
     return binding_handled;
 }
 
@@ -163,13 +256,18 @@ bool wf::bindings_repository_t::handle_activator(
 
 void wf::bindings_repository_t::rem_binding(void *callback)
 {
-    const auto& erase = [callback] (auto& container)
+    const auto& erase = [this, callback] (auto& container)
     {
-        auto it = std::remove_if(container.begin(), container.end(),
+        auto it = std::stable_partition(container.begin(), container.end(),
             [callback] (const auto& ptr)
         {
-            return ptr->callback == callback;
+            return !(ptr->callback == callback);
         });
+        for (auto removed = it; removed != container.end(); ++removed)
+        {
+            untrack_option((*removed)->activated_by);
+        }
+
         container.erase(it, container.end());
     };
 
@@ -178,18 +276,24 @@ void wf::bindings_repository_t::rem_binding(void *callback)
     erase(axes);
     erase(activators);
 
+    invalidate_index();
     recreate_hotspots();
 }
 
 void wf::bindings_repository_t::rem_binding(binding_t *binding)
 {
-    const auto& erase = [binding] (auto& container)
+    const auto& erase = [this, binding] (auto& container)
     {
-        auto it = std::remove_if(container.begin(), container.end(),
+        auto it = std::stable_partition(container.begin(), container.end(),
             [binding] (const auto& ptr)
         {
-            return ptr.get() == binding;
+            return !(ptr.get() == binding);
         });
+        for (auto removed = it; removed != container.end(); ++removed)
+        {
+            untrack_option((*removed)->activated_by);
+        }
+
         container.erase(it, container.end());
     };
 
@@ -198,6 +302,7 @@ void wf::bindings_repository_t::rem_binding(binding_t *binding)
     erase(axes);
     erase(activators);
 
+    invalidate_index();
     recreate_hotspots();
 }
 
@@ -210,6 +315,48 @@ wf::bindings_repository_t::bindings_repository_t(wf::output_t *output) :
     });
 
     wf::get_core().connect_signal("reload-config", &on_config_reload);
+
+    on_option_changed = [=] ()
+    {
+        invalidate_index();
+    };
+}
+
+wf::bindings_repository_t::~bindings_repository_t()
+{
+    for (auto& [option, count] : tracked_options)
+    {
+        option->rem_updated_handler(&on_option_changed);
+    }
+}
+
+void wf::bindings_repository_t::invalidate_index()
+{
+    key_index.clear();
+    button_index.clear();
+    axis_index.clear();
+}
+
+void wf::bindings_repository_t::track_option(
+    std::shared_ptr<wf::config::option_base_t> option)
+{
+    if (tracked_options[option]++ == 0)
+    {
+        option->add_updated_handler(&on_option_changed);
+    }
+
+    invalidate_index();
+}
+
+void wf::bindings_repository_t::untrack_option(
+    std::shared_ptr<wf::config::option_base_t> option)
+{
+    auto it = tracked_options.find(option);
+    if ((it != tracked_options.end()) && (--it->second == 0))
+    {
+        option->rem_updated_handler(&on_option_changed);
+        tracked_options.erase(it);
+    }
 }
 
 void wf::bindings_repository_t::recreate_hotspots()
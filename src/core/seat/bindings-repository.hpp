@@ -1,7 +1,9 @@
 #pragma once
 
 #include "wayfire/geometry.hpp"
+#include <map>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 #include <wayfire/bindings.hpp>
 #include <wayfire/config/option-wrapper.hpp>
@@ -18,6 +20,7 @@ class bindings_repository_t
 {
   public:
     bindings_repository_t(wf::output_t *output);
+    ~bindings_repository_t();
 
     /**
      * Handle a keybinding pressed by the user.
@@ -70,6 +73,36 @@ class bindings_repository_t
 
     hotspot_manager_t hotspot_mgr;
 
+    /** The bindings which match a key, button or axis combination */
+    template<class Callback>
+    struct binding_matches_t
+    {
+        std::vector<Callback*> bindings;
+        std::vector<activator_callback*> activators;
+    };
+
+    /**
+     * The matching bindings for each combination pressed so far, indexed by
+     * its modifiers and key or button, see get_index_key().
+     *
+     * Activator values can only be checked for a match, so the entries are
+     * filled on the first event with the given combination, and the whole
+     * index is dropped when bindings or their options change.
+     */
+    std::unordered_map<uint64_t, binding_matches_t<key_callback>> key_index;
+    std::unordered_map<uint64_t, binding_matches_t<button_callback>> button_index;
+    std::unordered_map<uint64_t, binding_matches_t<axis_callback>> axis_index;
+    void invalidate_index();
+
+    /**
+     * Options of the registered bindings and the number of bindings using
+     * them. The index is dropped whenever one of them changes.
+     */
+    std::map<std::shared_ptr<wf::config::option_base_t>, int> tracked_options;
+    wf::config::option_base_t::updated_callback_t on_option_changed;
+    void track_option(std::shared_ptr<wf::config::option_base_t> option);
+    void untrack_option(std::shared_ptr<wf::config::option_base_t> option);
+
     wf::signal_connection_t on_config_reload;
     wf::wl_idle_call idle_recreate_hotspots;
 };
@@ -59,11 +59,14 @@ void wf::cursor_t::setup_listeners()
 #define setup_passthrough_callback(evname) \
     on_ ## evname.set_callback([&] (void *data) { \
         set_touchscreen_mode(false); \
+        static const auto signal = wf::get_signal_id("pointer_" #evname); \
+        static const auto post_signal = \
+            wf::get_signal_id("pointer_" #evname "_post"); \
         auto ev   = static_cast<wlr_pointer_ ## evname ## _event*>(data); \
-        auto mode = emit_device_event_signal("pointer_" #evname, ev); \
+        auto mode = emit_device_event_signal(signal, ev); \
         seat->lpointer->handle_pointer_ ## evname(ev, mode); \
         wlr_idle_notify_activity(core.protocols.idle, core.get_current_seat()); \
-        emit_device_event_signal("pointer_" #evname "_post", ev); \
+        emit_device_event_signal(post_signal, ev); \
     }); \
     on_ ## evname.connect(&cursor->events.evname);
 
@@ -86,15 +89,18 @@ void wf::cursor_t::setup_listeners()
 #define setup_tablet_callback(evname) \
     on_tablet_ ## evname.set_callback([&] (void *data) { \
         set_touchscreen_mode(false); \
+        static const auto signal = wf::get_signal_id("tablet_" #evname); \
+        static const auto post_signal = \
+            wf::get_signal_id("tablet_" #evname "_post"); \
         auto ev = static_cast<wlr_tablet_tool_ ## evname ## _event*>(data); \
-        auto handling_mode = emit_device_event_signal("tablet_" #evname, ev); \
+        auto handling_mode = emit_device_event_signal(signal, ev); \
         if (ev->tablet->data) { \
             auto tablet = \
                 static_cast<wf::tablet_t*>(ev->tablet->data); \
             tablet->handle_ ## evname(ev, handling_mode); \
         } \
         wlr_idle_notify_activity(wf::get_core().protocols.idle, seat->seat); \
-        emit_device_event_signal("tablet_" #evname "_post", ev); \
+        emit_device_event_signal(post_signal, ev); \
     }); \
     on_tablet_ ## evname.connect(&cursor->events.tablet_tool_ ## evname);
 
@@ -0,0 +1,231 @@
+#include "hit-test-index.hpp"
+#include "wayfire/signal-definitions.hpp"
+#include "wayfire/workspace-manager.hpp"
+#include <cmath>
+
+wf::hit_test_index_t::hit_test_index_t(wf::output_t *output)
+{
+    this->output = output;
+
+    on_views_changed.set_callback([=] (wf::signal_data_t*)
+    {
+        dirty = true;
+    });
+
+    for (auto signal : {"view-mapped", "view-unmapped", "view-minimized",
+        "view-disappeared", "view-attached", "view-detached",
+        "view-layer-attached", "view-layer-detached", "view-geometry-changed",
+        "stack-order-changed", "workspace-changed"})
+    {
+        output->connect_signal(signal, &on_views_changed);
+    }
+
+    /* Transformers, subsurfaces and visibility changes do not have a signal
+     * of their own, but they all damage the view. */
+    on_view_damaged.set_callback([=] (wf::signal_data_t *data)
+    {
+        if (dirty)
+        {
+            return;
+        }
+
+        auto view = get_signaled_view(data);
+        auto it   = positions.find(view.get());
+        if (it == positions.end())
+        {
+            dirty = is_candidate(view);
+        } else
+        {
+            dirty = !is_candidate(view) ||
+                (view->get_bounding_box() != entries[it->second].box);
+        }
+    });
+    output->connect_signal("view-region-damaged", &on_view_damaged);
+
+    on_last_view_subsurface_added.set_callback([=] (wf::signal_data_t*)
+    {
+        set_last_view(nullptr, 0);
+    });
+}
+
+wf::hit_test_index_t*wf::hit_test_index_t::get(wf::output_t *output)
+{
+    auto index = output->get_data<hit_test_index_t>();
+    if (!index)
+    {
+        output->store_data(std::make_unique<hit_test_index_t>(output));
+        index = output->get_data<hit_test_index_t>();
+    }
+
+    return index.get();
+}
+
+bool wf::hit_test_index_t::is_candidate(wayfire_view view)
+{
+    return view->is_mapped() && !view->minimized && view->is_visible();
+}
+
+void wf::hit_test_index_t::rebuild()
+{
+    set_last_view(nullptr, 0);
+    entries.clear();
+    positions.clear();
+
+    for (auto& v : output->workspace->get_views_in_layer(wf::VISIBLE_LAYERS))
+    {
+        for (auto& view : v->enumerate_views())
+        {
+            if (is_candidate(view))
+            {
+                positions[view.get()] = entries.size();
+                entries.push_back({view, view->get_bounding_box()});
+            }
+        }
+    }
+
+    auto size = output->get_screen_size();
+    grid_size = {
+        (size.width + CELL_SIZE - 1) / CELL_SIZE,
+        (size.height + CELL_SIZE - 1) / CELL_SIZE,
+    };
+
+    cells.resize(grid_size.width * grid_size.height);
+    for (auto& cell : cells)
+    {
+        cell.clear();
+    }
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        auto& box = entries[i].box;
+        int x1 = std::max(0, box.x / CELL_SIZE);
+        int y1 = std::max(0, box.y / CELL_SIZE);
+        int x2 = std::min(grid_size.width - 1,
+            (box.x + box.width - 1) / CELL_SIZE);
+        int y2 = std::min(grid_size.height - 1,
+            (box.y + box.height - 1) / CELL_SIZE);
+
+        for (int y = y1; y <= y2; y++)
+        {
+            for (int x = x1; x <= x2; x++)
+            {
+                cells[y * grid_size.width + x].push_back(i);
+            }
+        }
+    }
+
+    dirty = false;
+}
+
+const std::vector<size_t>*wf::hit_test_index_t::get_cell(
+    wf::pointf_t point) const
+{
+    int x = std::floor(point.x / CELL_SIZE);
+    int y = std::floor(point.y / CELL_SIZE);
+    if ((x < 0) || (y < 0) || (x >= grid_size.width) || (y >= grid_size.height))
+    {
+        return nullptr;
+    }
+
+    return &cells[y * grid_size.width + x];
+}
+
+void wf::hit_test_index_t::set_last_view(wayfire_view view, size_t position)
+{
+    if (view == last_view)
+    {
+        last_position = position;
+        return;
+    }
+
+    on_last_view_subsurface_added.disconnect();
+    last_view     = view;
+    last_position = position;
+    if (view)
+    {
+        view->connect_signal("subsurface-added", &on_last_view_subsurface_added);
+    }
+}
+
+wf::surface_interface_t*wf::hit_test_index_t::surface_at(wf::pointf_t point,
+    wf::pointf_t& local, const std::function<bool(wayfire_view)>& filter)
+{
+    auto size = output->get_screen_size();
+    if (dirty || (grid_size.width * CELL_SIZE < size.width) ||
+        (grid_size.height * CELL_SIZE < size.height))
+    {
+        rebuild();
+    }
+
+    /* Points outside of the output are not in the grid, so they fall back to
+     * going over all views */
+    std::vector<size_t> all_entries;
+    auto cell = get_cell(point);
+    if (!cell)
+    {
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            all_entries.push_back(i);
+        }
+
+        cell = &all_entries;
+    }
+
+    /* Fast path: the pointer is still over the main surface of the last view,
+     * and no view above it contains the point */
+    if (last_view)
+    {
+        bool covered = false;
+        for (auto i : *cell)
+        {
+            if (i >= last_position)
+            {
+                break;
+            }
+
+            covered |= (entries[i].box & point);
+        }
+
+        if (!covered && (entries[last_position].box & point) &&
+            filter(last_view))
+        {
+            local = last_view->global_to_local_point(point, last_view.get());
+            if (last_view->accepts_input(std::floor(local.x),
+                std::floor(local.y)))
+            {
+                return last_view.get();
+            }
+        }
+    }
+
+    for (auto i : *cell)
+    {
+        auto& entry = entries[i];
+        if (!(entry.box & point) || !filter(entry.view))
+        {
+            continue;
+        }
+
+        auto surface = entry.view->map_input_coordinates(point, local);
+        if (!surface)
+        {
+            continue;
+        }
+
+        if (surface != entry.view.get())
+        {
+            set_last_view(nullptr, 0);
+        } else if (entry.view != last_view)
+        {
+            /* The main surface can be checked directly only if no other
+             * surface of the view is above it */
+            auto surfaces = entry.view->enumerate_surfaces({0, 0});
+            bool topmost  = surfaces.front().surface == entry.view.get();
+            set_last_view(topmost ? entry.view : nullptr, i);
+        }
+
+        return surface;
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "wayfire/object.hpp"
+#include "wayfire/output.hpp"
+#include "wayfire/view.hpp"
+
+namespace wf
+{
+/**
+ * A spatial index of the views on an output which can receive input, used to
+ * find the surface under the cursor without going over all views.
+ *
+ * The index stores the bounding box of each candidate view in stacking order,
+ * and a grid which maps each cell of the output to the views intersecting it.
+ * It is rebuilt lazily after the views, their stacking order or their bounding
+ * boxes change.
+ *
+ * The index is stored as custom data on the output, see get().
+ */
+class hit_test_index_t : public wf::custom_data_t
+{
+  public:
+    hit_test_index_t(wf::output_t *output);
+
+    /** @return The index of the given output, created on first use. */
+    static hit_test_index_t *get(wf::output_t *output);
+
+    /**
+     * Find the topmost surface which accepts input at the given point.
+     *
+     * @param point The point in output-local coordinates.
+     * @param local Set to the coordinates of the point relative to the
+     *   returned surface.
+     * @param filter Views for which it returns false are skipped.
+     */
+    wf::surface_interface_t *surface_at(wf::pointf_t point, wf::pointf_t& local,
+        const std::function<bool(wayfire_view)>& filter);
+
+  private:
+    wf::output_t *output;
+
+    struct entry_t
+    {
+        wayfire_view view;
+        wf::geometry_t box;
+    };
+
+    /* Candidate views, from the topmost to the bottom-most */
+    std::vector<entry_t> entries;
+    /* The position of each view in entries */
+    std::unordered_map<wf::view_interface_t*, size_t> positions;
+
+    static constexpr int CELL_SIZE = 128;
+    wf::dimensions_t grid_size = {0, 0};
+    /* Positions in entries of the views intersecting each cell, sorted */
+    std::vector<std::vector<size_t>> cells;
+
+    bool dirty = true;
+    void rebuild();
+    static bool is_candidate(wayfire_view view);
+
+    /** @return The cell list containing the point, or null if outside. */
+    const std::vector<size_t> *get_cell(wf::pointf_t point) const;
+
+    /**
+     * The result of the last query, if it was the main surface of a view
+     * without surfaces above it. As long as no view above it contains the
+     * point, the main surface can be checked directly.
+     */
+    wayfire_view last_view = nullptr;
+    size_t last_position   = 0;
+    void set_last_view(wayfire_view view, size_t position);
+    wf::signal_connection_t on_last_view_subsurface_added;
+
+    wf::signal_connection_t on_views_changed;
+    wf::signal_connection_t on_view_damaged;
+};
+}
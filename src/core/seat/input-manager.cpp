@@ -9,6 +9,7 @@
 #include "keyboard.hpp"
 #include "cursor.hpp"
 #include "input-manager.hpp"
+#include "hit-test-index.hpp"
 #include "wayfire/output-layout.hpp"
 #include "wayfire/workspace-manager.hpp"
 #include <wayfire/util/log.hpp>
@@ -210,6 +211,12 @@ bool wf::input_manager_t::grab_input(wf::plugin_grab_interface_t *iface)
 
 void wf::input_manager_t::ungrab_input()
 {
+    auto& seat = wf::get_core_impl().seat;
+    if (seat && seat->lpointer)
+    {
+        seat->lpointer->handle_grab_end();
+    }
+
     active_grab = nullptr;
     if (wf::get_core().get_active_output())
     {
@@ -280,23 +287,8 @@ wf::surface_interface_t*wf::input_manager_t::input_surface_at(
     global.x -= og.x;
     global.y -= og.y;
 
-    for (auto& v : output->workspace->get_views_in_layer(wf::VISIBLE_LAYERS))
-    {
-        for (auto& view : v->enumerate_views())
-        {
-            if (!view->minimized && view->is_visible() &&
-                can_focus_surface(view.get()))
-            {
-                auto surface = view->map_input_coordinates(global, local);
-                if (surface)
-                {
-                    return surface;
-                }
-            }
-        }
-    }
-
-    return nullptr;
+    return wf::hit_test_index_t::get(output)->surface_at(global, local,
+        [=] (wayfire_view view) { return can_focus_surface(view.get()); });
 }
 
 void wf::input_manager_t::set_exclusive_focus(wl_client *client)
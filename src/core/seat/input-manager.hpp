@@ -88,14 +88,17 @@ class input_manager_t
 
 /**
  * Emit a signal for device events.
+ *
+ * These are emitted for every input event, so callers should look up the
+ * signal ID once.
  */
 template<class EventType>
 wf::input_event_processing_mode_t emit_device_event_signal(
-    std::string event_name, EventType *event)
+    wf::signal_id_t event_signal, EventType *event)
 {
     wf::input_event_signal<EventType> data;
     data.event = event;
-    wf::get_core().emit_signal(event_name, &data);
+    wf::get_core().emit_signal(event_signal, &data);
 
     return data.mode;
 }
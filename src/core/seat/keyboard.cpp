@@ -23,8 +23,11 @@ void wf::keyboard_t::setup_listeners()
 
     on_key.set_callback([&] (void *data)
     {
+        static const auto key_signal = wf::get_signal_id("keyboard_key");
+        static const auto key_post_signal =
+            wf::get_signal_id("keyboard_key_post");
         auto ev   = static_cast<wlr_keyboard_key_event*>(data);
-        auto mode = emit_device_event_signal("keyboard_key", ev);
+        auto mode = emit_device_event_signal(key_signal, ev);
 
         auto& seat = wf::get_core_impl().seat;
         seat->set_keyboard(this);
@@ -37,7 +40,7 @@ void wf::keyboard_t::setup_listeners()
         }
 
         wlr_idle_notify_activity(wf::get_core().protocols.idle, seat->seat);
-        emit_device_event_signal("keyboard_key_post", ev);
+        emit_device_event_signal(key_post_signal, ev);
     });
 
     on_modifier.set_callback([&] (void *data)
@@ -50,6 +53,20 @@ void wf::keyboard_t::setup_listeners()
         wlr_idle_notify_activity(wf::get_core().protocols.idle, seat);
     });
 
+    on_keymap_compiled.set_callback([&] (signal_data_t *data)
+    {
+        auto ev = static_cast<keymap_compiled_signal*>(data);
+        if (pending_names && (*pending_names == ev->names))
+        {
+            pending_names.reset();
+            auto keymap = wf::get_core_impl().seat->keymap_cache->get(ev->names);
+            set_keymap(keymap);
+            xkb_keymap_unref(keymap);
+        }
+    });
+    wf::get_core_impl().seat->keymap_cache->connect_signal("keymap-compiled",
+        &on_keymap_compiled);
+
     on_key.connect(&handle->events.key);
     on_modifier.connect(&handle->events.modifiers);
 }
@@ -65,6 +82,7 @@ wf::keyboard_t::keyboard_t(wlr_input_device *dev) :
 
     repeat_rate.load_option("input/kb_repeat_rate");
     repeat_delay.load_option("input/kb_repeat_delay");
+    async_compile.load_option("input/xkb_async_compile");
 
     // When the configuration options change, mark them as dirty.
     // They are applied at the config-reloaded signal.
@@ -104,34 +122,42 @@ void wf::keyboard_t::reload_input_options()
     }
 
     this->dirty_options = false;
+    wlr_keyboard_set_repeat_info(handle, repeat_rate, repeat_delay);
 
-    auto ctx = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
-
-    /* Copy memory to stack, so that .c_str() is valid */
-    std::string rules   = this->rules;
-    std::string model   = this->model;
-    std::string layout  = this->layout;
-    std::string variant = this->variant;
-    std::string options = this->options;
+    keymap_names_t names;
+    names.rules   = this->rules;
+    names.model   = this->model;
+    names.layout  = this->layout;
+    names.variant = this->variant;
+    names.options = this->options;
 
-    xkb_rule_names names;
-    names.rules   = rules.c_str();
-    names.model   = model.c_str();
-    names.layout  = layout.c_str();
-    names.variant = variant.c_str();
-    names.options = options.c_str();
-    auto keymap = xkb_map_new_from_names(ctx, &names,
-        XKB_KEYMAP_COMPILE_NO_FLAGS);
+    auto& cache = *wf::get_core_impl().seat->keymap_cache;
+    auto keymap = cache.lookup(names);
+    if (!keymap && handle->keymap && async_compile)
+    {
+        /* Keep using the current keymap until the new one is compiled */
+        pending_names = names;
+        cache.compile_async(names);
+        return;
+    }
 
+    pending_names.reset();
     if (!keymap)
     {
-        LOGE("Could not create keymap with given configuration:",
-            " rules=\"", rules, "\" model=\"", model, "\" layout=\"", layout,
-            "\" variant=\"", variant, "\" options=\"", options, "\"");
+        keymap = cache.get(names);
+    }
 
-        // reset to NULL
-        std::memset(&names, 0, sizeof(names));
-        keymap = xkb_map_new_from_names(ctx, &names, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    set_keymap(keymap);
+    xkb_keymap_unref(keymap);
+}
+
+void wf::keyboard_t::set_keymap(xkb_keymap *keymap)
+{
+    /* Setting a keymap serializes it and sends it to all clients again, which
+     * is not needed if the configuration did not change */
+    if (handle->keymap == keymap)
+    {
+        return;
     }
 
     xkb_mod_mask_t locked_mods = 0;
@@ -147,11 +173,6 @@ void wf::keyboard_t::reload_input_options()
     }
 
     wlr_keyboard_set_keymap(handle, keymap);
-    xkb_keymap_unref(keymap);
-    xkb_context_unref(ctx);
-
-    wlr_keyboard_set_repeat_info(handle, repeat_rate, repeat_delay);
-
     wlr_keyboard_notify_modifiers(handle, 0, 0, locked_mods, 0);
 }
 
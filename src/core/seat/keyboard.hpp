@@ -1,7 +1,9 @@
 #pragma once
 
 #include <chrono>
+#include <optional>
 #include "seat.hpp"
+#include "keymap-cache.hpp"
 #include "wayfire/util.hpp"
 #include <wayfire/option-wrapper.hpp>
 
@@ -41,9 +43,16 @@ class keyboard_t
     wf::option_wrapper_t<std::string>
     model, variant, layout, options, rules;
     wf::option_wrapper_t<int> repeat_rate, repeat_delay;
+    /** Compile changed keymaps without blocking the event loop */
+    wf::option_wrapper_t<bool> async_compile;
     /** Options have changed in the config file */
     bool dirty_options = true;
 
+    /** The configuration of the keymap which is being compiled, if any */
+    std::optional<keymap_names_t> pending_names;
+    wf::signal_connection_t on_keymap_compiled;
+    void set_keymap(xkb_keymap *keymap);
+
     std::chrono::steady_clock::time_point mod_binding_start;
 
     bool handle_keyboard_key(uint32_t key, uint32_t state);
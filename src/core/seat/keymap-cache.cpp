@@ -0,0 +1,221 @@
+#include <cerrno>
+#include <cstring>
+#include <tuple>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <wayfire/util/log.hpp>
+#include "wayfire/core.hpp"
+#include "keymap-cache.hpp"
+
+bool wf::keymap_names_t::operator <(const keymap_names_t& other) const
+{
+    return std::tie(rules, model, layout, variant, options) <
+           std::tie(other.rules, other.model, other.layout, other.variant,
+        other.options);
+}
+
+bool wf::keymap_names_t::operator ==(const keymap_names_t& other) const
+{
+    return std::tie(rules, model, layout, variant, options) ==
+           std::tie(other.rules, other.model, other.layout, other.variant,
+        other.options);
+}
+
+/** @return The compiled keymap, or null if the names are invalid */
+static xkb_keymap *compile_keymap(xkb_context *ctx,
+    const wf::keymap_names_t& names)
+{
+    xkb_rule_names rule_names;
+    rule_names.rules   = names.rules.c_str();
+    rule_names.model   = names.model.c_str();
+    rule_names.layout  = names.layout.c_str();
+    rule_names.variant = names.variant.c_str();
+    rule_names.options = names.options.c_str();
+
+    return xkb_map_new_from_names(ctx, &rule_names,
+        XKB_KEYMAP_COMPILE_NO_FLAGS);
+}
+
+static void log_invalid_names(const wf::keymap_names_t& names)
+{
+    LOGE("Could not create keymap with given configuration:",
+        " rules=\"", names.rules, "\" model=\"", names.model,
+        "\" layout=\"", names.layout, "\" variant=\"", names.variant,
+        "\" options=\"", names.options, "\"");
+}
+
+wf::keymap_cache_t::keymap_cache_t()
+{
+    context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+
+    auto event_loop = wl_display_get_event_loop(wf::get_core().display);
+    jobs_done_fd     = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    jobs_done_source = wl_event_loop_add_fd(event_loop, jobs_done_fd,
+        WL_EVENT_READABLE, handle_jobs_done, this);
+}
+
+wf::keymap_cache_t::~keymap_cache_t()
+{
+    for (auto& job : jobs)
+    {
+        job.thread.join();
+        if (job.keymap)
+        {
+            xkb_keymap_unref(job.keymap);
+        }
+    }
+
+    for (auto& [names, entry] : keymaps)
+    {
+        xkb_keymap_unref(entry.keymap);
+    }
+
+    wl_event_source_remove(jobs_done_source);
+    close(jobs_done_fd);
+    xkb_context_unref(context);
+}
+
+xkb_keymap*wf::keymap_cache_t::lookup(const keymap_names_t& names)
+{
+    auto it = keymaps.find(names);
+    if (it == keymaps.end())
+    {
+        return nullptr;
+    }
+
+    it->second.last_use = ++use_counter;
+    return xkb_keymap_ref(it->second.keymap);
+}
+
+xkb_keymap*wf::keymap_cache_t::get(const keymap_names_t& names)
+{
+    if (auto keymap = lookup(names))
+    {
+        return keymap;
+    }
+
+    auto keymap = compile_keymap(context, names);
+    if (!keymap)
+    {
+        log_invalid_names(names);
+        keymap = compile_keymap(context, {});
+    }
+
+    insert(names, keymap);
+    return xkb_keymap_ref(keymap);
+}
+
+void wf::keymap_cache_t::insert(const keymap_names_t& names, xkb_keymap *keymap)
+{
+    if (keymaps.size() >= MAX_KEYMAPS)
+    {
+        auto oldest = keymaps.begin();
+        for (auto it = keymaps.begin(); it != keymaps.end(); ++it)
+        {
+            if (it->second.last_use < oldest->second.last_use)
+            {
+                oldest = it;
+            }
+        }
+
+        /* Keyboards keep their own reference to the keymap they use */
+        xkb_keymap_unref(oldest->second.keymap);
+        keymaps.erase(oldest);
+    }
+
+    keymaps[names] = {keymap, ++use_counter};
+}
+
+void wf::keymap_cache_t::compile_async(const keymap_names_t& names)
+{
+    if (keymaps.count(names))
+    {
+        return;
+    }
+
+    for (auto& job : jobs)
+    {
+        if (job.names == names)
+        {
+            return;
+        }
+    }
+
+    jobs.emplace_back();
+    auto& job = jobs.back();
+    job.names  = names;
+    job.thread = std::thread([this, &job] ()
+    {
+        auto ctx    = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+        auto keymap = compile_keymap(ctx, job.names);
+        /* The keymap holds its own reference to the context */
+        xkb_context_unref(ctx);
+
+        {
+            std::lock_guard<std::mutex> lock(jobs_mutex);
+            job.keymap = keymap;
+            job.done   = true;
+        }
+
+        uint64_t done = 1;
+        if (write(jobs_done_fd, &done, sizeof(done)) < 0)
+        {
+            LOGE("Failed to signal the compiled keymap for layout ",
+                job.names.layout, ": ", strerror(errno));
+        }
+    });
+}
+
+int wf::keymap_cache_t::handle_jobs_done(int fd, uint32_t mask, void *data)
+{
+    auto self = (keymap_cache_t*)data;
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) < 0)
+    {
+        return 0;
+    }
+
+    std::list<job_t> done;
+    {
+        std::lock_guard<std::mutex> lock(self->jobs_mutex);
+        for (auto it = self->jobs.begin(); it != self->jobs.end();)
+        {
+            auto next = std::next(it);
+            if (it->done)
+            {
+                done.splice(done.end(), self->jobs, it);
+            }
+
+            it = next;
+        }
+    }
+
+    for (auto& job : done)
+    {
+        job.thread.join();
+        if (self->keymaps.count(job.names))
+        {
+            /* Compiled on the main thread in the meantime */
+            if (job.keymap)
+            {
+                xkb_keymap_unref(job.keymap);
+            }
+        } else
+        {
+            if (!job.keymap)
+            {
+                log_invalid_names(job.names);
+                job.keymap = compile_keymap(self->context, {});
+            }
+
+            self->insert(job.names, job.keymap);
+        }
+
+        keymap_compiled_signal data;
+        data.names = job.names;
+        self->emit_signal("keymap-compiled", &data);
+    }
+
+    return 0;
+}
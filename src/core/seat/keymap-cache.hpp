@@ -0,0 +1,104 @@
+#pragma once
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <xkbcommon/xkbcommon.h>
+#include <wayland-server-core.h>
+#include "wayfire/object.hpp"
+
+namespace wf
+{
+/** The XKB configuration from which a keymap is compiled */
+struct keymap_names_t
+{
+    std::string rules;
+    std::string model;
+    std::string layout;
+    std::string variant;
+    std::string options;
+
+    bool operator <(const keymap_names_t& other) const;
+    bool operator ==(const keymap_names_t& other) const;
+};
+
+/**
+ * name: keymap-compiled
+ * on: keymap_cache_t
+ * when: A keymap requested with compile_async() is in the cache.
+ */
+struct keymap_compiled_signal : public wf::signal_data_t
+{
+    keymap_names_t names;
+};
+
+/**
+ * A cache of compiled keymaps, shared by all keyboards of the seat.
+ *
+ * All keyboards use the same XKB configuration, so compiling the keymap once
+ * is enough, no matter how many devices are plugged in. Keyboards which get
+ * the same keymap object also do not need to serialize it again when the
+ * configuration is reloaded, see keyboard_t::set_keymap().
+ */
+class keymap_cache_t : public wf::signal_provider_t
+{
+  public:
+    keymap_cache_t();
+    ~keymap_cache_t();
+
+    /**
+     * Get the keymap for the given names, compiling it if it is not cached.
+     * If the names are invalid, the default keymap is used instead.
+     *
+     * @return A new reference to the keymap, never null.
+     */
+    xkb_keymap *get(const keymap_names_t& names);
+
+    /** @return A new reference to the cached keymap, or null if not cached. */
+    xkb_keymap *lookup(const keymap_names_t& names);
+
+    /**
+     * Compile the keymap for the given names on a separate thread, unless it
+     * is cached or already being compiled. The keymap-compiled signal is
+     * emitted once it has been added to the cache.
+     */
+    void compile_async(const keymap_names_t& names);
+
+  private:
+    /* Used for all keymaps compiled on the main thread. Worker threads use a
+     * context of their own, since contexts are not thread-safe. */
+    xkb_context *context;
+
+    struct entry_t
+    {
+        xkb_keymap *keymap;
+        uint64_t last_use;
+    };
+
+    std::map<keymap_names_t, entry_t> keymaps;
+    uint64_t use_counter = 0;
+    /* Keymaps are a few hundred KiB each, and usually only the current
+     * configuration is needed */
+    static constexpr size_t MAX_KEYMAPS = 4;
+
+    void insert(const keymap_names_t& names, xkb_keymap *keymap);
+
+    struct job_t
+    {
+        keymap_names_t names;
+        std::thread thread;
+        xkb_keymap *keymap = nullptr;
+        bool done = false;
+    };
+
+    /* Protects the results of the jobs */
+    std::mutex jobs_mutex;
+    std::list<job_t> jobs;
+
+    int jobs_done_fd;
+    wl_event_source *jobs_done_source;
+    static int handle_jobs_done(int fd, uint32_t mask, void *data);
+};
+}
@@ -7,6 +7,7 @@
 #include <wayfire/util/log.hpp>
 #include <wayfire/core.hpp>
 #include <wayfire/output-layout.hpp>
+#include <wayfire/output.hpp>
 #include <wayfire/compositor-surface.hpp>
 
 wf::pointer_t::pointer_t(nonstd::observer_ptr<wf::input_manager_t> input,
@@ -31,10 +32,31 @@ wf::pointer_t::pointer_t(nonstd::observer_ptr<wf::input_manager_t> input,
     };
     wf::get_core().connect_signal("output-stack-order-changed", &on_views_updated);
     wf::get_core().connect_signal("view-geometry-changed", &on_views_updated);
+
+    on_motion_frame = [=] ()
+    {
+        flush_motion();
+    };
+
+    on_output_pre_remove.set_callback([=] (wf::signal_data_t *data)
+    {
+        auto ev = static_cast<wf::output_pre_remove_signal*>(data);
+        if (ev->output == pending_motion.output)
+        {
+            flush_motion();
+        }
+    });
+    wf::get_core().output_layout->connect_signal("output-pre-remove",
+        &on_output_pre_remove);
 }
 
 wf::pointer_t::~pointer_t()
-{}
+{
+    if (pending_motion.output)
+    {
+        pending_motion.output->render->rem_effect(&on_motion_frame);
+    }
+}
 
 bool wf::pointer_t::has_pressed_buttons() const
 {
@@ -332,6 +354,8 @@ void wf::pointer_t::grab_surface(wf::surface_interface_t *surface)
 void wf::pointer_t::handle_pointer_button(wlr_pointer_button_event *ev,
     input_event_processing_mode_t mode)
 {
+    /* The button has to be handled at the position where it happened */
+    flush_motion();
     seat->break_mod_bindings();
     bool handled_in_binding = (mode != input_event_processing_mode_t::FULL);
 
@@ -446,11 +470,104 @@ void wf::pointer_t::send_motion(uint32_t time_msec, wf::pointf_t local)
     }
 }
 
+bool wf::pointer_t::defer_motion(uint32_t time_msec)
+{
+    if (!coalesce_motion || !input->input_grabbed())
+    {
+        flush_motion();
+        return false;
+    }
+
+    if (!pending_motion.output)
+    {
+        auto output = wf::get_core().get_active_output();
+        if (!output)
+        {
+            return false;
+        }
+
+        pending_motion.output = output;
+        output->render->add_effect(&on_motion_frame, OUTPUT_EFFECT_PRE);
+        /* Only a frame event is needed, the output is repainted only if the
+         * grab callbacks damage it */
+        wlr_output_schedule_frame(output->handle);
+    }
+
+    pending_motion.time_msec = time_msec;
+    ++pending_motion.events;
+
+    return true;
+}
+
+void wf::pointer_t::flush_motion()
+{
+    if (!pending_motion.output)
+    {
+        return;
+    }
+
+    pending_motion.output->render->rem_effect(&on_motion_frame);
+    pending_motion.output = nullptr;
+    ++pending_motion.frames;
+
+    if (pending_motion.relative)
+    {
+        pending_motion.relative = false;
+        if (input->input_grabbed() &&
+            input->active_grab->callbacks.pointer.relative_motion)
+        {
+            auto ev = pending_motion.event;
+            input->active_grab->callbacks.pointer.relative_motion(&ev);
+        }
+    }
+
+    update_cursor_position(pending_motion.time_msec);
+}
+
+void wf::pointer_t::handle_grab_end()
+{
+    /* The grab is being removed, possibly from one of its own callbacks, so
+     * the pending motion is dropped instead of delivered to it. The cursor is
+     * already at the final position, and the focus is updated once the grab
+     * is gone. */
+    if (pending_motion.output)
+    {
+        pending_motion.output->render->rem_effect(&on_motion_frame);
+        pending_motion.output   = nullptr;
+        pending_motion.relative = false;
+    }
+
+    if (pending_motion.frames)
+    {
+        LOGD("Coalesced ", pending_motion.events, " motion events into ",
+            pending_motion.frames, " updates");
+    }
+
+    pending_motion.events = pending_motion.frames = 0;
+}
+
 void wf::pointer_t::handle_pointer_motion(wlr_pointer_motion_event *ev,
     input_event_processing_mode_t mode)
 {
-    if (input->input_grabbed() &&
-        input->active_grab->callbacks.pointer.relative_motion)
+    const bool deferred = defer_motion(ev->time_msec);
+    if (deferred)
+    {
+        auto& sum = pending_motion.event;
+        if (!pending_motion.relative)
+        {
+            sum = *ev;
+            pending_motion.relative = true;
+        } else
+        {
+            sum.pointer    = ev->pointer;
+            sum.time_msec  = ev->time_msec;
+            sum.delta_x   += ev->delta_x;
+            sum.delta_y   += ev->delta_y;
+            sum.unaccel_dx += ev->unaccel_dx;
+            sum.unaccel_dy += ev->unaccel_dy;
+        }
+    } else if (input->input_grabbed() &&
+               input->active_grab->callbacks.pointer.relative_motion)
     {
         input->active_grab->callbacks.pointer.relative_motion(ev);
     }
@@ -484,7 +601,10 @@ void wf::pointer_t::handle_pointer_motion(wlr_pointer_motion_event *ev,
 
     /* XXX: maybe warp directly? */
     wlr_cursor_move(seat->cursor->cursor, &ev->pointer->base, dx, dy);
-    update_cursor_position(ev->time_msec);
+    if (!deferred)
+    {
+        update_cursor_position(ev->time_msec);
+    }
 }
 
 void wf::pointer_t::handle_pointer_motion_absolute(
@@ -514,12 +634,16 @@ void wf::pointer_t::handle_pointer_motion_absolute(
 
     // TODO: indirection via wf_cursor
     wlr_cursor_warp_closest(seat->cursor->cursor, NULL, cx, cy);
-    update_cursor_position(ev->time_msec);
+    if (!defer_motion(ev->time_msec))
+    {
+        update_cursor_position(ev->time_msec);
+    }
 }
 
 void wf::pointer_t::handle_pointer_axis(wlr_pointer_axis_event *ev,
     input_event_processing_mode_t mode)
 {
+    flush_motion();
     bool handled_in_binding = input->get_active_bindings().handle_axis(
         seat->get_modifiers(), ev);
     seat->break_mod_bindings();
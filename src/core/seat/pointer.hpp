@@ -9,6 +9,7 @@
 #include <wayfire/option-wrapper.hpp>
 #include "surface-map-state.hpp"
 #include "wayfire/signal-definitions.hpp"
+#include <wayfire/render-manager.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
 
 namespace wf
@@ -92,6 +93,13 @@ class pointer_t
     /** Whether there are pressed buttons currently */
     bool has_pressed_buttons() const;
 
+    /**
+     * Called by the input manager right before the active grab is removed.
+     * Motion deferred during the grab is dropped, because calling the grab
+     * while it is being removed is not safe.
+     */
+    void handle_grab_end();
+
   private:
     nonstd::observer_ptr<wf::input_manager_t> input;
     nonstd::observer_ptr<seat_t> seat;
@@ -161,6 +169,45 @@ class pointer_t
      * focus
      */
     void send_motion(uint32_t time_msec, wf::pointf_t local);
+
+    /**
+     * Motion coalescing, see input/coalesce_motion.
+     *
+     * While a plugin grabs the input, motion events only move the cursor and
+     * are sent to relative-pointer clients. The rest of the processing (focus
+     * update, grab callbacks, drag icon) is done once per frame of the active
+     * output, right before it is repainted, with the deltas of all events in
+     * between summed up.
+     */
+    wf::option_wrapper_t<bool> coalesce_motion{"input/coalesce_motion"};
+    struct pending_motion_t
+    {
+        /* The output on whose next frame the motion is handled, or nullptr if
+         * there is no pending motion */
+        wf::output_t *output = nullptr;
+        /* Whether there were relative events. Their deltas are summed in event */
+        bool relative = false;
+        wlr_pointer_motion_event event;
+        uint32_t time_msec = 0;
+
+        /* Statistics for the current grab */
+        uint64_t events = 0;
+        uint64_t frames = 0;
+    } pending_motion;
+
+    wf::effect_hook_t on_motion_frame;
+    wf::signal_connection_t on_output_pre_remove;
+
+    /**
+     * Check whether motion should be coalesced, and if yes, schedule its
+     * handling on the next frame.
+     *
+     * @return Whether the caller should not handle the motion now.
+     */
+    bool defer_motion(uint32_t time_msec);
+
+    /** Handle the motion accumulated since the last frame, if any. */
+    void flush_motion();
 };
 }
 
@@ -12,6 +12,7 @@ namespace wf
 {
 struct cursor_t;
 class keyboard_t;
+class keymap_cache_t;
 
 struct drag_icon_t : public wlr_child_surface_base_t
 {
@@ -89,6 +90,8 @@ class seat_t
     std::unique_ptr<cursor_t> cursor;
     std::unique_ptr<pointer_t> lpointer;
     std::unique_ptr<touch_interface_t> touch;
+    /** Compiled keymaps, shared by the keyboards of the seat */
+    std::unique_ptr<keymap_cache_t> keymap_cache;
 
     // Current drag icon
     std::unique_ptr<wf::drag_icon_t> drag_icon;
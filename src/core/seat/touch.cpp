@@ -21,8 +21,11 @@ wf::touch_interface_t::touch_interface_t(wlr_cursor *cursor, wlr_seat *seat,
     // connect handlers
     on_down.set_callback([=] (void *data)
     {
+        static const auto touch_down_signal = wf::get_signal_id("touch_down");
+        static const auto touch_down_post_signal =
+            wf::get_signal_id("touch_down_post");
         auto ev   = static_cast<wlr_touch_down_event*>(data);
-        auto mode = emit_device_event_signal("touch_down", ev);
+        auto mode = emit_device_event_signal(touch_down_signal, ev);
 
         double lx, ly;
         wlr_cursor_absolute_to_layout_coords(cursor, &ev->touch->base,
@@ -33,23 +36,29 @@ wf::touch_interface_t::touch_interface_t(wlr_cursor *cursor, wlr_seat *seat,
         handle_touch_down(ev->touch_id, ev->time_msec, point, mode);
         wlr_idle_notify_activity(wf::get_core().protocols.idle,
             wf::get_core().get_current_seat());
-        emit_device_event_signal("touch_down_post", ev);
+        emit_device_event_signal(touch_down_post_signal, ev);
     });
 
     on_up.set_callback([=] (void *data)
     {
+        static const auto touch_up_signal = wf::get_signal_id("touch_up");
+        static const auto touch_up_post_signal =
+            wf::get_signal_id("touch_up_post");
         auto ev   = static_cast<wlr_touch_up_event*>(data);
-        auto mode = emit_device_event_signal("touch_up", ev);
+        auto mode = emit_device_event_signal(touch_up_signal, ev);
         handle_touch_up(ev->touch_id, ev->time_msec, mode);
         wlr_idle_notify_activity(wf::get_core().protocols.idle,
             wf::get_core().get_current_seat());
-        emit_device_event_signal("touch_up_post", ev);
+        emit_device_event_signal(touch_up_post_signal, ev);
     });
 
     on_motion.set_callback([=] (void *data)
     {
+        static const auto touch_motion_signal = wf::get_signal_id("touch_motion");
+        static const auto touch_motion_post_signal =
+            wf::get_signal_id("touch_motion_post");
         auto ev   = static_cast<wlr_touch_motion_event*>(data);
-        auto mode = emit_device_event_signal("touch_motion", ev);
+        auto mode = emit_device_event_signal(touch_motion_signal, ev);
 
         double lx, ly;
         wlr_cursor_absolute_to_layout_coords(
@@ -61,7 +70,7 @@ wf::touch_interface_t::touch_interface_t(wlr_cursor *cursor, wlr_seat *seat,
         handle_touch_motion(ev->touch_id, ev->time_msec, point, true, mode);
         wlr_idle_notify_activity(wf::get_core().protocols.idle,
             wf::get_core().get_current_seat());
-        emit_device_event_signal("touch_motion_post", ev);
+        emit_device_event_signal(touch_motion_post_signal, ev);
     });
 
     on_up.connect(&cursor->events.touch_up);
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -40,6 +41,8 @@ static void print_help()
         " -D,  --damage-debug      enable additional debug for damaged regions" <<
         std::endl;
     std::cout << " -R,  --damage-rerender   rerender damaged regions" << std::endl;
+    std::cout << " -P,  --simulate-planes   simulate the given number of " <<
+        "overlay planes for direct scanout (for testing)" << std::endl;
     std::cout << " -v,  --version           print version and exit" << std::endl;
     exit(0);
 }
@@ -186,6 +189,7 @@ int main(int argc, char *argv[])
         {"debug", no_argument, NULL, 'd'},
         {"damage-debug", no_argument, NULL, 'D'},
         {"damage-rerender", no_argument, NULL, 'R'},
+        {"simulate-planes", required_argument, NULL, 'P'},
         {"help", no_argument, NULL, 'h'},
         {"version", no_argument, NULL, 'v'},
         {0, 0, NULL, 0}
@@ -195,7 +199,7 @@ int main(int argc, char *argv[])
     std::string config_backend = WF_DEFAULT_CONFIG_BACKEND;
 
     int c, i;
-    while ((c = getopt_long(argc, argv, "c:B:dDhRv", opts, &i)) != -1)
+    while ((c = getopt_long(argc, argv, "c:B:dDhRP:v", opts, &i)) != -1)
     {
         switch (c)
         {
@@ -215,6 +219,10 @@ int main(int argc, char *argv[])
             runtime_config.no_damage_track = true;
             break;
 
+          case 'P':
+            runtime_config.simulated_planes = std::max(0, std::atoi(optarg));
+            break;
+
           case 'h':
             print_help();
             break;
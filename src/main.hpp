@@ -5,6 +5,9 @@ extern struct wf_runtime_config
 {
     bool no_damage_track = false;
     bool damage_debug    = false;
+    /* Number of simulated overlay planes for direct scanout, -1 to use the
+     * output's real planes */
+    int simulated_planes = -1;
 } runtime_config;
 
 #endif /* end of include guard: MAIN_HPP */
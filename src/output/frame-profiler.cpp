@@ -0,0 +1,480 @@
+#include "frame-profiler.hpp"
+#include "../core/core-impl.hpp"
+#include "../core/opengl-priv.hpp"
+#include <wayfire/util/log.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <time.h>
+
+#ifndef GL_TIME_ELAPSED_EXT
+    #define GL_TIME_ELAPSED_EXT 0x88BF
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+    #define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+namespace wf
+{
+const char *get_frame_stage_name(frame_stage_t stage)
+{
+    switch (stage)
+    {
+      case FRAME_STAGE_EFFECTS:
+        return "effects";
+
+      case FRAME_STAGE_SCANOUT:
+        return "scanout";
+
+      case FRAME_STAGE_RENDER:
+        return "render";
+
+      case FRAME_STAGE_OVERLAY:
+        return "overlay";
+
+      case FRAME_STAGE_POSTPROCESS:
+        return "postprocess";
+
+      case FRAME_STAGE_CURSORS:
+        return "cursors";
+
+      case FRAME_STAGE_SWAP:
+        return "swap";
+
+      default:
+        return "unknown";
+    }
+}
+
+void duration_histogram_t::add(int64_t us)
+{
+    if (us < 0)
+    {
+        return;
+    }
+
+    int bucket = 0;
+    while ((bucket < NR_BUCKETS - 1) && ((int64_t(1) << (bucket + 1)) <= us))
+    {
+        ++bucket;
+    }
+
+    ++buckets[bucket];
+    ++count;
+    total_us += us;
+    max_us    = std::max(max_us, us);
+}
+
+int64_t duration_histogram_t::average() const
+{
+    return count ? total_us / count : 0;
+}
+
+int64_t duration_histogram_t::percentile(double p) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    uint32_t target = std::ceil(count * std::clamp(p, 0.0, 100.0) / 100.0);
+    target = std::max(target, 1u);
+
+    uint32_t seen = 0;
+    for (int i = 0; i < NR_BUCKETS; i++)
+    {
+        seen += buckets[i];
+        if (seen >= target)
+        {
+            return std::min(max_us, int64_t(1) << (i + 1));
+        }
+    }
+
+    return max_us;
+}
+
+/** @return The current time of the presentation clock, in nanoseconds. */
+static int64_t get_time_ns()
+{
+    clockid_t clock =
+        wlr_backend_get_presentation_clock(wf::get_core_impl().backend);
+
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1'000'000'000ll + ts.tv_nsec;
+}
+
+/* Frames which were not presented after this many commits are forgotten */
+static constexpr size_t MAX_PENDING_PRESENTS = 16;
+
+frame_profiler_t::impl::~impl()
+{
+    if (free_queries.empty() && pending_queries.empty())
+    {
+        return;
+    }
+
+    for (auto& pending : pending_queries)
+    {
+        free_queries.push_back(pending.query);
+    }
+
+    OpenGL::render_begin();
+    GL_CALL(glDeleteQueries(free_queries.size(), free_queries.data()));
+    OpenGL::render_end();
+}
+
+void frame_profiler_t::impl::begin_frame()
+{
+    if (active_counter <= 0)
+    {
+        return;
+    }
+
+    in_frame = true;
+    current  = {};
+    current.stage_us.fill(0);
+
+    frame_start_ns = stage_start_ns = get_time_ns();
+    frame_start_draw_calls = OpenGL::get_draw_call_count();
+}
+
+void frame_profiler_t::impl::end_stage(frame_stage_t stage)
+{
+    if (!in_frame)
+    {
+        return;
+    }
+
+    int64_t now = get_time_ns();
+    current.stage_us[stage] += (now - stage_start_ns) / 1000;
+    stage_start_ns = now;
+}
+
+void frame_profiler_t::impl::cancel_frame()
+{
+    in_frame = false;
+}
+
+void frame_profiler_t::impl::end_frame(bool scanout, uint64_t commit_seq)
+{
+    if (!in_frame)
+    {
+        return;
+    }
+
+    in_frame = false;
+    current.scanout    = scanout;
+    current.cpu_us     = (get_time_ns() - frame_start_ns) / 1000;
+    current.draw_calls = OpenGL::get_draw_call_count() - frame_start_draw_calls;
+
+    uint64_t frame = nr_frames++;
+    samples[frame % HISTORY_SIZE] = current;
+    sample_frames[frame % HISTORY_SIZE] = frame;
+
+    pending_presents.push_back({commit_seq, frame, frame_start_ns});
+    if (pending_presents.size() > MAX_PENDING_PRESENTS)
+    {
+        pending_presents.pop_front();
+    }
+}
+
+void frame_profiler_t::impl::add_surfaces(uint32_t count)
+{
+    if (in_frame)
+    {
+        current.surfaces += count;
+    }
+}
+
+void frame_profiler_t::impl::set_damage_rects(uint32_t count)
+{
+    current.damage_rects = count;
+}
+
+frame_sample_t*frame_profiler_t::impl::find_sample(uint64_t frame)
+{
+    if ((frame >= nr_frames) || (sample_frames[frame % HISTORY_SIZE] != frame))
+    {
+        return nullptr;
+    }
+
+    return &samples[frame % HISTORY_SIZE];
+}
+
+void frame_profiler_t::impl::handle_present(wlr_output_event_present *ev)
+{
+    while (!pending_presents.empty() &&
+           (pending_presents.front().commit_seq < ev->commit_seq))
+    {
+        /* Older commits will not be presented anymore */
+        pending_presents.pop_front();
+    }
+
+    if (pending_presents.empty() ||
+        (pending_presents.front().commit_seq != ev->commit_seq))
+    {
+        return;
+    }
+
+    auto pending = pending_presents.front();
+    pending_presents.pop_front();
+
+    auto sample = find_sample(pending.frame);
+    if (!sample || !ev->presented || !ev->when)
+    {
+        return;
+    }
+
+    int64_t when = ev->when->tv_sec * 1'000'000'000ll + ev->when->tv_nsec;
+    sample->latency_us = std::max<int64_t>(0, when - pending.start_ns) / 1000;
+}
+
+void frame_profiler_t::impl::collect_gpu_results()
+{
+    GLint disjoint = 0;
+    GL_CALL(glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint));
+
+    while (!pending_queries.empty())
+    {
+        auto pending = pending_queries.front();
+        GLuint available = GL_FALSE;
+        GL_CALL(glGetQueryObjectuiv(pending.query, GL_QUERY_RESULT_AVAILABLE,
+            &available));
+        if (!available && !disjoint)
+        {
+            /* Results become available in order */
+            break;
+        }
+
+        pending_queries.pop_front();
+        free_queries.push_back(pending.query);
+
+        /* The results are meaningless if the GPU was in a disjoint state */
+        auto sample = find_sample(pending.frame);
+        if (!disjoint && sample)
+        {
+            GLuint elapsed_ns = 0;
+            GL_CALL(glGetQueryObjectuiv(pending.query, GL_QUERY_RESULT,
+                &elapsed_ns));
+            sample->gpu_us = elapsed_ns / 1000;
+        }
+    }
+}
+
+/**
+ * The query functions used here are core only since GLES 3.0, and the
+ * timestamps come from GL_EXT_disjoint_timer_query. On GLES2 contexts, like
+ * on the Raspberry Pi's vc4, the GPU time stays unknown.
+ */
+static bool check_timer_query_support()
+{
+    auto version = (const char*)glGetString(GL_VERSION);
+    int major    = 0;
+    if (!version || (sscanf(version, "OpenGL ES %d", &major) != 1) ||
+        (major < 3))
+    {
+        return false;
+    }
+
+    auto extensions = (const char*)glGetString(GL_EXTENSIONS);
+    return extensions && std::strstr(extensions, "GL_EXT_disjoint_timer_query");
+}
+
+void frame_profiler_t::impl::begin_gpu_timer()
+{
+    if (!in_frame)
+    {
+        return;
+    }
+
+    if (timer_query_support < 0)
+    {
+        timer_query_support = check_timer_query_support();
+        LOGD("GPU frame timing is ", timer_query_support ?
+            "supported" : "not supported, only CPU time is recorded");
+    }
+
+    if (!timer_query_support || gpu_timer_running)
+    {
+        return;
+    }
+
+    collect_gpu_results();
+    if (free_queries.empty())
+    {
+        GLuint query;
+        GL_CALL(glGenQueries(1, &query));
+        free_queries.push_back(query);
+    }
+
+    GL_CALL(glBeginQuery(GL_TIME_ELAPSED_EXT, free_queries.back()));
+    gpu_timer_running = true;
+}
+
+void frame_profiler_t::impl::end_gpu_timer()
+{
+    if (!gpu_timer_running)
+    {
+        return;
+    }
+
+    GL_CALL(glEndQuery(GL_TIME_ELAPSED_EXT));
+    gpu_timer_running = false;
+
+    /* The frame is recorded with the next frame number in end_frame() */
+    pending_queries.push_back({free_queries.back(), nr_frames});
+    free_queries.pop_back();
+}
+
+std::vector<frame_sample_t> frame_profiler_t::impl::get_samples() const
+{
+    std::vector<frame_sample_t> result;
+    uint64_t first = nr_frames - std::min<uint64_t>(nr_frames, HISTORY_SIZE);
+    for (uint64_t frame = first; frame < nr_frames; frame++)
+    {
+        result.push_back(samples[frame % HISTORY_SIZE]);
+    }
+
+    return result;
+}
+
+frame_profiler_t::frame_profiler_t()
+{
+    priv = std::make_unique<impl>();
+}
+
+frame_profiler_t::~frame_profiler_t() = default;
+
+void frame_profiler_t::set_active(bool active)
+{
+    priv->active_counter += active ? 1 : -1;
+    if (priv->active_counter <= 0)
+    {
+        priv->active_counter = 0;
+        priv->cancel_frame();
+    }
+}
+
+bool frame_profiler_t::is_active() const
+{
+    return priv->active_counter > 0;
+}
+
+std::vector<frame_sample_t> frame_profiler_t::get_samples() const
+{
+    return priv->get_samples();
+}
+
+duration_histogram_t frame_profiler_t::get_stage_histogram(
+    frame_stage_t stage) const
+{
+    duration_histogram_t histogram;
+    for (auto& sample : get_samples())
+    {
+        histogram.add(sample.stage_us[stage]);
+    }
+
+    return histogram;
+}
+
+duration_histogram_t frame_profiler_t::get_cpu_histogram() const
+{
+    duration_histogram_t histogram;
+    for (auto& sample : get_samples())
+    {
+        histogram.add(sample.cpu_us);
+    }
+
+    return histogram;
+}
+
+duration_histogram_t frame_profiler_t::get_gpu_histogram() const
+{
+    duration_histogram_t histogram;
+    for (auto& sample : get_samples())
+    {
+        histogram.add(sample.gpu_us);
+    }
+
+    return histogram;
+}
+
+duration_histogram_t frame_profiler_t::get_latency_histogram() const
+{
+    duration_histogram_t histogram;
+    for (auto& sample : get_samples())
+    {
+        histogram.add(sample.latency_us);
+    }
+
+    return histogram;
+}
+
+std::string frame_profiler_t::dump() const
+{
+    auto samples = get_samples();
+    std::ostringstream out;
+
+    size_t scanout = std::count_if(samples.begin(), samples.end(),
+        [] (const frame_sample_t& s) { return s.scanout; });
+    out << "frames: " << samples.size() << " (scanout: " << scanout << ")\n";
+    if (samples.empty())
+    {
+        return out.str();
+    }
+
+    auto print_row = [&] (const std::string& name, const duration_histogram_t& h)
+    {
+        out << std::left << std::setw(12) << name << std::right;
+        if (h.count == 0)
+        {
+            out << std::setw(8) << "n/a" << "\n";
+            return;
+        }
+
+        for (int64_t value : {h.average(), h.percentile(50), h.percentile(90),
+            h.percentile(99), h.max_us})
+        {
+            out << std::setw(8) << value;
+        }
+
+        out << "\n";
+    };
+
+    out << std::left << std::setw(12) << "(us)" << std::right;
+    for (auto col : {"avg", "p50", "p90", "p99", "max"})
+    {
+        out << std::setw(8) << col;
+    }
+
+    out << "\n";
+    for (int i = 0; i < FRAME_STAGE_COUNT; i++)
+    {
+        print_row(get_frame_stage_name((frame_stage_t)i),
+            get_stage_histogram((frame_stage_t)i));
+    }
+
+    print_row("cpu", get_cpu_histogram());
+    print_row("gpu", get_gpu_histogram());
+    print_row("latency", get_latency_histogram());
+
+    double surfaces = 0, rects = 0, draw_calls = 0;
+    for (auto& sample : samples)
+    {
+        surfaces   += sample.surfaces;
+        rects      += sample.damage_rects;
+        draw_calls += sample.draw_calls;
+    }
+
+    out << std::fixed << std::setprecision(1) <<
+        "surfaces: " << surfaces / samples.size() <<
+        ", damage rects: " << rects / samples.size() <<
+        ", draw calls: " << draw_calls / samples.size() << " (avg)\n";
+    return out.str();
+}
+}
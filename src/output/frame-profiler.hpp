@@ -0,0 +1,98 @@
+#ifndef WF_FRAME_PROFILER_IMPL_HPP
+#define WF_FRAME_PROFILER_IMPL_HPP
+
+#include <wayfire/frame-profiler.hpp>
+#include <wayfire/opengl.hpp>
+#include <wayfire/nonstd/wlroots.hpp>
+#include <deque>
+
+namespace wf
+{
+/**
+ * The part of the frame profiler used by the render manager to record the
+ * stages of a frame.
+ *
+ * Stages are recorded in order: the time between the end of the previous
+ * stage (or the start of the frame) and end_stage() is attributed to the
+ * given stage. All calls are no-ops if the profiler was not active at the
+ * start of the frame.
+ */
+class frame_profiler_t::impl
+{
+  public:
+    ~impl();
+
+    int active_counter = 0;
+
+    /** Start recording a new frame. */
+    void begin_frame();
+    /** The given stage of the current frame is over. */
+    void end_stage(frame_stage_t stage);
+    /** The current frame was not submitted, so it is not recorded. */
+    void cancel_frame();
+    /**
+     * The current frame was committed to the output.
+     *
+     * @param scanout Whether the frame was scanned out directly.
+     * @param commit_seq The commit sequence number of the output, used to
+     *   match the frame with its presentation event.
+     */
+    void end_frame(bool scanout, uint64_t commit_seq);
+
+    void add_surfaces(uint32_t count);
+    void set_damage_rects(uint32_t count);
+
+    /**
+     * Start and stop measuring GPU time for the current frame. Must be called
+     * with the GL context current.
+     */
+    void begin_gpu_timer();
+    void end_gpu_timer();
+
+    /** Record the presentation latency of a frame, if it was presented. */
+    void handle_present(wlr_output_event_present *ev);
+
+    /** The recorded samples, from the oldest to the newest one. */
+    std::vector<frame_sample_t> get_samples() const;
+
+  private:
+    bool in_frame = false;
+    frame_sample_t current;
+    int64_t frame_start_ns = 0;
+    int64_t stage_start_ns = 0;
+    uint64_t frame_start_draw_calls = 0;
+
+    /* Ring buffer of samples, and the frame number stored in each slot */
+    std::array<frame_sample_t, HISTORY_SIZE> samples;
+    std::array<uint64_t, HISTORY_SIZE> sample_frames;
+    /* The number of frames recorded so far */
+    uint64_t nr_frames = 0;
+
+    frame_sample_t *find_sample(uint64_t frame);
+
+    struct pending_present_t
+    {
+        uint64_t commit_seq;
+        uint64_t frame;
+        int64_t start_ns;
+    };
+
+    std::deque<pending_present_t> pending_presents;
+
+    /* GPU timer queries: -1 if support was not checked yet */
+    int timer_query_support = -1;
+    bool gpu_timer_running  = false;
+    std::vector<GLuint> free_queries;
+
+    struct pending_query_t
+    {
+        GLuint query;
+        uint64_t frame;
+    };
+
+    std::deque<pending_query_t> pending_queries;
+    void collect_gpu_results();
+};
+}
+
+#endif /* end of include guard: WF_FRAME_PROFILER_IMPL_HPP */
@@ -546,24 +546,28 @@ static wf::binding_t *push_binding(
 binding_t*output_impl_t::add_key(option_sptr_t<keybinding_t> key,
     wf::key_callback *callback)
 {
+    this->bindings->track_option(key);
     return push_binding(this->bindings->keys, key, callback);
 }
 
 binding_t*output_impl_t::add_axis(option_sptr_t<keybinding_t> axis,
     wf::axis_callback *callback)
 {
+    this->bindings->track_option(axis);
     return push_binding(this->bindings->axes, axis, callback);
 }
 
 binding_t*output_impl_t::add_button(option_sptr_t<buttonbinding_t> button,
     wf::button_callback *callback)
 {
+    this->bindings->track_option(button);
     return push_binding(this->bindings->buttons, button, callback);
 }
 
 binding_t*output_impl_t::add_activator(
     option_sptr_t<activatorbinding_t> activator, wf::activator_callback *callback)
 {
+    this->bindings->track_option(activator);
     auto result = push_binding(this->bindings->activators, activator, callback);
     this->bindings->recreate_hotspots();
     return result;
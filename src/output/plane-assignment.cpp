@@ -0,0 +1,98 @@
+#include "scanout-planes.hpp"
+
+namespace wf
+{
+const char *to_string(scanout_fallback_t reason)
+{
+    switch (reason)
+    {
+      case scanout_fallback_t::DRAG_ACTIVE:
+        return "drag and drop is active";
+
+      case scanout_fallback_t::PLUGIN_RENDERER:
+        return "a plugin renders the output";
+
+      case scanout_fallback_t::OUTPUT_EFFECTS:
+        return "a plugin has output effects";
+
+      case scanout_fallback_t::SOFTWARE_CURSOR:
+        return "the cursor is rendered in software";
+
+      case scanout_fallback_t::NO_VIEWS:
+        return "there are no views";
+
+      case scanout_fallback_t::VIEW_NOT_FULLSCREEN:
+        return "the topmost view does not cover the output";
+
+      case scanout_fallback_t::VIEW_BUFFER_MISMATCH:
+        return "the view's buffer does not match the output";
+
+      case scanout_fallback_t::VIEW_NOT_OPAQUE:
+        return "the view is not opaque";
+
+      case scanout_fallback_t::VIEW_TRANSFORMED:
+        return "the view has a transformer";
+
+      case scanout_fallback_t::SURFACE_MISMATCH:
+        return "a surface above the view cannot be scanned out";
+
+      case scanout_fallback_t::NOT_ENOUGH_PLANES:
+        return "not enough overlay planes";
+
+      case scanout_fallback_t::SIMULATED_PLANES:
+        return "the overlay planes are simulated";
+
+      case scanout_fallback_t::COMMIT_FAILED:
+        return "the output rejected the planes";
+    }
+
+    return "unknown reason";
+}
+
+std::optional<scanout_fallback_t> assign_planes(
+    const std::vector<plane_candidate_t>& candidates, int nr_overlay_planes,
+    scanout_surface_t& primary, std::vector<scanout_surface_t>& overlays)
+{
+    overlays.clear();
+
+    bool above_primary = false;
+    for (auto& candidate : candidates)
+    {
+        if (candidate.is_primary)
+        {
+            if (!candidate.matches_output)
+            {
+                return scanout_fallback_t::VIEW_BUFFER_MISMATCH;
+            }
+
+            primary = candidate.surface;
+            above_primary = true;
+            continue;
+        }
+
+        if (!above_primary || !candidate.on_output)
+        {
+            continue;
+        }
+
+        if (!candidate.matches_output)
+        {
+            return scanout_fallback_t::SURFACE_MISMATCH;
+        }
+
+        overlays.push_back(candidate.surface);
+    }
+
+    if (!above_primary)
+    {
+        return scanout_fallback_t::VIEW_BUFFER_MISMATCH;
+    }
+
+    if ((int)overlays.size() > nr_overlay_planes)
+    {
+        return scanout_fallback_t::NOT_ENOUGH_PLANES;
+    }
+
+    return {};
+}
+}
@@ -9,7 +9,11 @@
 #include "../core/seat/seat.hpp"
 #include "../core/opengl-priv.hpp"
 #include "../main.hpp"
+#include "scanout-planes.hpp"
+#include "frame-profiler.hpp"
 #include <algorithm>
+#include <cmath>
+#include <unordered_map>
 #include <wayfire/nonstd/reverse.hpp>
 #include <wayfire/nonstd/safe-list.hpp>
 #include <wayfire/util/log.hpp>
@@ -268,7 +272,10 @@ struct postprocessing_manager_t
 {
     using post_container_t = wf::safe_list_t<post_hook_t*>;
     post_container_t post_effects;
-    wf::framebuffer_base_t post_buffers[3];
+    /* The buffer rendered to by everything before the postprocessing hooks,
+     * followed by one buffer per hook except the last one */
+    std::vector<wf::framebuffer_base_t> post_buffers =
+        std::vector<wf::framebuffer_base_t>(1);
     /* Buffer to which other operations render to */
     static constexpr uint32_t default_out_buffer = 0;
 
@@ -315,50 +322,113 @@ struct postprocessing_manager_t
         OpenGL::render_end();
     }
 
-    void add_post(post_hook_t *hook)
+    /* How each hook spreads damage, no entry means it redraws everything */
+    std::unordered_map<post_hook_t*, post_damage_expander_t> expanders;
+
+    void add_post(post_hook_t *hook, post_damage_expander_t expand)
     {
         post_effects.push_back(hook);
+        if (expand)
+        {
+            expanders[hook] = expand;
+        }
+
         output->render->damage_whole_idle();
     }
 
     void rem_post(post_hook_t *hook)
     {
         post_effects.remove_all(hook);
+        expanders.erase(hook);
         output->render->damage_whole_idle();
     }
 
-    /* Run all postprocessing effects, rendering to alternating buffers and
-     * finally to the screen.
+    /** Make sure there is a buffer for each hook except the last one */
+    void update_post_buffers()
+    {
+        size_t count = std::max<size_t>(1, post_effects.size());
+        if (post_buffers.size() > count)
+        {
+            OpenGL::render_begin();
+            for (size_t i = count; i < post_buffers.size(); i++)
+            {
+                post_buffers[i].release();
+            }
+
+            OpenGL::render_end();
+        }
+
+        post_buffers.resize(count);
+    }
+
+    /* Run all postprocessing effects, each rendering to its own buffer and
+     * the last one to the screen.
      *
-     * NB: 2 buffers just aren't enough. We render to the zero buffer, and then
-     * we alternately render to the second and the third. The reason: We track
-     * damage. So, we need to keep the whole buffer each frame. */
-    void run_post_effects()
+     * Each hook redraws only the damage of its source, expanded as the hook
+     * declared. Because every intermediate buffer is always used by the same
+     * hook, the rest of it still holds valid contents from previous frames.
+     * Adding or removing a hook shifts the buffers, but it also damages the
+     * whole output.
+     *
+     * @param swap_damage The damage of the output, in the wlroots damage
+     *   coordinate system. While a hook runs, it is set to the region the hook
+     *   has to redraw, and in the end to the damage of the last hook.
+     */
+    void run_post_effects(wf::region_t& swap_damage)
     {
         wf::framebuffer_base_t default_framebuffer;
         default_framebuffer.fb  = output_fb;
         default_framebuffer.tex = 0;
 
-        int last_buffer_idx = default_out_buffer;
-        int next_buffer_idx = 1;
+        update_post_buffers();
+        size_t last_buffer_idx = default_out_buffer;
+        size_t next_buffer_idx = 1;
+
+        const float scale = output->handle->scale;
+        const auto output_box = output->get_relative_geometry();
+        const auto target_fb  = get_target_framebuffer();
+        wf::region_t damage   = swap_damage * (1.0 / scale);
 
         post_effects.for_each([&] (auto post) -> void
         {
             /* The last postprocessing hook renders directly to the screen, others to
-             * the currently free buffer */
+             * their own buffer */
+            const bool last = (post == post_effects.back());
+            if (!last && (next_buffer_idx >= post_buffers.size()))
+            {
+                /* A hook was added while the hooks are running */
+                post_buffers.resize(next_buffer_idx + 1);
+            }
+
             wf::framebuffer_base_t& next_buffer =
-                (post == post_effects.back() ? default_framebuffer :
-                    post_buffers[next_buffer_idx]);
+                (last ? default_framebuffer : post_buffers[next_buffer_idx]);
 
             OpenGL::render_begin();
             /* Make sure we have the correct resolution */
-            next_buffer.allocate(output_width, output_height);
+            bool reallocated = next_buffer.allocate(output_width, output_height);
             OpenGL::render_end();
 
-            (*post)(post_buffers[last_buffer_idx], next_buffer);
+            auto it = expanders.find(post);
+            if (reallocated || (it == expanders.end()))
+            {
+                damage = output_box;
+            } else
+            {
+                damage = it->second(damage) & output_box;
+            }
+
+            swap_damage = damage * scale;
+            if (!damage.empty())
+            {
+                OpenGL::render_begin();
+                target_fb.logic_scissor(
+                    wlr_box_from_pixman_box(damage.get_extents()));
+                (*post)(post_buffers[last_buffer_idx], next_buffer);
+                OpenGL::render_end();
+            }
 
-            last_buffer_idx  = next_buffer_idx;
-            next_buffer_idx ^= 0b11; // alternate 1 and 2
+            last_buffer_idx = next_buffer_idx;
+            ++next_buffer_idx;
         });
     }
 
@@ -453,6 +523,7 @@ class depth_buffer_manager_t : public noncopyable_t
         }
 
         GL_CALL(glGenTextures(1, &buffer.tex));
+        OpenGL::invalidate_texture_cache();
         GL_CALL(glBindTexture(GL_TEXTURE_2D, buffer.tex));
         GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
             width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL));
@@ -688,6 +759,14 @@ class wf::render_manager::impl
         postprocessing = std::make_unique<postprocessing_manager_t>(o);
         depth_buffer_manager = std::make_unique<depth_buffer_manager_t>();
         delay_manager = std::make_unique<repaint_delay_manager_t>(o);
+        plane_model   = wf::create_plane_model(o);
+
+        on_present.set_callback([&] (void *data)
+        {
+            profiler.priv->handle_present(
+                static_cast<wlr_output_event_present*>(data));
+        });
+        on_present.connect(&output->handle->events.present);
 
         on_frame.set_callback([&] (void*)
         {
@@ -745,13 +824,29 @@ class wf::render_manager::impl
         }
     }
 
-    render_hook_t renderer;
-    void set_renderer(render_hook_t rh)
+    damage_render_hook_t renderer;
+    void set_renderer(damage_render_hook_t rh)
     {
         renderer = rh;
         output_damage->damage_whole_idle();
     }
 
+    void set_renderer(render_hook_t rh)
+    {
+        if (!rh)
+        {
+            set_renderer(damage_render_hook_t{});
+            return;
+        }
+
+        /* Hooks which do not know about damage repaint everything */
+        set_renderer([rh] (const wf::framebuffer_t& fb, const wf::region_t&)
+        {
+            rh(fb);
+            return wf::region_t{fb.geometry};
+        });
+    }
+
     int constant_redraw_counter = 0;
     void set_redraw_always(bool always)
     {
@@ -834,85 +929,178 @@ class wf::render_manager::impl
         }
     }
 
-    wayfire_view last_scanout;
+    wf::frame_profiler_t profiler;
+    wf::wl_listener_wrapper on_present;
+
+    std::unique_ptr<wf::plane_model_t> plane_model;
+    wf::scanout_stats_t scanout_stats;
+    std::optional<wf::scanout_fallback_t> last_fallback_reason;
+
+    /** Check whether a surface can be shown on a plane without scaling it. */
+    bool matches_output(wlr_surface *surface)
+    {
+        return surface && surface->buffer &&
+               (surface->current.scale == output->handle->scale) &&
+               (surface->current.transform == output->handle->transform);
+    }
+
     /**
-     * Try to directly scanout a view
+     * Assign the surfaces of the topmost view to hardware planes, see
+     * wf::assign_planes().
+     *
+     * The main surface of the view has to cover the whole output, so that
+     * everything below it is hidden.
+     *
+     * @return The reason why the output has to be composited, or nothing if
+     *   all surfaces were assigned.
      */
-    bool do_direct_scanout()
+    std::optional<wf::scanout_fallback_t> assign_scanout_planes(
+        wayfire_view& candidate, wf::scanout_surface_t& primary,
+        std::vector<wf::scanout_surface_t>& overlays)
     {
-        const bool can_scanout =
-            !wf::get_core_impl().seat->drag_active &&
-            !output_inhibit_counter &&
-            !renderer &&
-            effects->can_scanout() &&
-            postprocessing->can_scanout() &&
-            output->handle->software_cursor_locks == 0;
-
-        if (!can_scanout)
+        if (wf::get_core_impl().seat->drag_active)
         {
-            return false;
+            return wf::scanout_fallback_t::DRAG_ACTIVE;
         }
 
-        auto views = output->workspace->get_views_on_workspace(
-            output->workspace->get_current_workspace(), wf::VISIBLE_LAYERS);
+        if (output_inhibit_counter || renderer)
+        {
+            return wf::scanout_fallback_t::PLUGIN_RENDERER;
+        }
 
-        if (views.empty())
+        if (!effects->can_scanout() || !postprocessing->can_scanout())
         {
-            return false;
+            return wf::scanout_fallback_t::OUTPUT_EFFECTS;
         }
 
-        auto candidate = views.front();
+        if (output->handle->software_cursor_locks > 0)
+        {
+            return wf::scanout_fallback_t::SOFTWARE_CURSOR;
+        }
 
-        // The candidate must cover the whole output
-        if (candidate->get_output_geometry() != output->get_relative_geometry())
+        auto views = output->workspace->get_views_on_workspace(
+            output->workspace->get_current_workspace(), wf::VISIBLE_LAYERS);
+        if (views.empty())
         {
-            return false;
+            return wf::scanout_fallback_t::NO_VIEWS;
         }
 
-        // The view must have only a single surface and no transformers
-        if (candidate->has_transformer() ||
-            !candidate->priv->surface_children_above.empty() ||
-            !candidate->children.empty())
+        candidate = views.front();
+        if (candidate->get_output_geometry() != output->get_relative_geometry())
         {
-            return false;
+            return wf::scanout_fallback_t::VIEW_NOT_FULLSCREEN;
         }
 
-        // Must have a wlr surface with the correct scale and transform
-        auto surface = candidate->get_wlr_surface();
-        if (!surface ||
-            (surface->current.scale != output->handle->scale) ||
-            (surface->current.transform != output->handle->transform))
+        if (!matches_output(candidate->get_wlr_surface()))
         {
-            return false;
+            return wf::scanout_fallback_t::VIEW_BUFFER_MISMATCH;
         }
 
-        // Finally, the opaque region must be the full surface.
+        // The opaque region of the main surface must cover the full output,
+        // then surfaces below it (for ex. decorations) are not visible.
         wf::region_t non_opaque = output->get_relative_geometry();
         non_opaque ^= candidate->get_opaque_region(wf::point_t{0, 0});
         if (!non_opaque.empty())
         {
-            return false;
+            return wf::scanout_fallback_t::VIEW_NOT_OPAQUE;
         }
 
-        wlr_presentation_surface_sampled_on_output(
-            wf::get_core().protocols.presentation, surface, output->handle);
-        wlr_output_attach_buffer(output->handle, &surface->buffer->base);
+        std::vector<wf::plane_candidate_t> surfaces;
+        auto output_box = output->get_relative_geometry();
+        auto tree = candidate->enumerate_views();
+        for (auto& view : wf::reverse(tree))
+        {
+            if ((view != candidate) && !view->is_visible())
+            {
+                continue;
+            }
 
-        if (wlr_output_commit(output->handle))
+            if (view->has_transformer())
+            {
+                return wf::scanout_fallback_t::VIEW_TRANSFORMED;
+            }
+
+            auto origin = wf::origin(view->get_output_geometry());
+            for (auto& it : wf::reverse(view->enumerate_surfaces(origin)))
+            {
+                auto size = it.surface->get_size();
+                wf::geometry_t box = {it.position.x, it.position.y,
+                    size.width, size.height};
+
+                wf::plane_candidate_t surface;
+                surface.surface = {it.surface->get_wlr_surface(), it.position};
+                surface.is_primary     = (it.surface == candidate.get());
+                surface.on_output      = (box & output_box);
+                surface.matches_output = matches_output(surface.surface.surface);
+                surfaces.push_back(surface);
+            }
+        }
+
+        return wf::assign_planes(surfaces,
+            plane_model->get_overlay_plane_count(), primary, overlays);
+    }
+
+    /**
+     * Try to directly scanout a view
+     */
+    bool do_direct_scanout()
+    {
+        wayfire_view candidate;
+        wf::scanout_surface_t primary;
+        std::vector<wf::scanout_surface_t> overlays;
+
+        auto reason = assign_scanout_planes(candidate, primary, overlays);
+        if (!reason && !overlays.empty() && plane_model->is_simulated())
+        {
+            // The assignment is valid, but the overlays would not be visible.
+            reason = wf::scanout_fallback_t::SIMULATED_PLANES;
+        }
+
+        if (!reason)
+        {
+            auto presentation = wf::get_core().protocols.presentation;
+            wlr_presentation_surface_sampled_on_output(presentation,
+                primary.surface, output->handle);
+            for (auto& overlay : overlays)
+            {
+                wlr_presentation_surface_sampled_on_output(presentation,
+                    overlay.surface, output->handle);
+            }
+
+            if (!plane_model->commit(primary, overlays))
+            {
+                reason = wf::scanout_fallback_t::COMMIT_FAILED;
+            }
+        }
+
+        if (!reason)
         {
-            if (candidate != last_scanout)
+            if ((candidate->get_id() != scanout_stats.last_view_id) ||
+                ((int)overlays.size() != scanout_stats.last_overlay_planes))
             {
-                last_scanout = candidate;
-                LOGD("Scanned out ",
-                    candidate->get_title(), ",", candidate->get_app_id());
+                LOGD("Scanned out ", candidate->get_title(), ",",
+                    candidate->get_app_id(), " with ", overlays.size(),
+                    " overlay planes");
             }
 
+            ++scanout_stats.scanout_frames;
+            scanout_stats.last_view_id = candidate->get_id();
+            scanout_stats.last_overlay_planes = overlays.size();
+            last_fallback_reason.reset();
             return true;
-        } else
+        }
+
+        if (reason != last_fallback_reason)
         {
-            LOGD("Failed to scan out view ", candidate->get_title());
-            return false;
+            LOGD("Compositing ", output->to_string(), ": ", wf::to_string(*reason));
+            last_fallback_reason = reason;
         }
+
+        ++scanout_stats.composited_frames;
+        ++scanout_stats.fallback_reasons[*reason];
+        scanout_stats.last_view_id.reset();
+        scanout_stats.last_overlay_planes = 0;
+        return false;
     }
 
     /**
@@ -932,9 +1120,21 @@ class wf::render_manager::impl
     {
         if (renderer)
         {
-            renderer(postprocessing->get_target_framebuffer());
-            /* TODO: let custom renderers specify what they want to repaint... */
-            swap_damage |= output_damage->get_wlr_damage_box();
+            auto fb = postprocessing->get_target_framebuffer();
+            wf::region_t damage = fb.geometry;
+            if (!runtime_config.damage_debug)
+            {
+                damage &= output_damage->get_scheduled_damage();
+            }
+
+            /* The hook may replace itself while running */
+            auto hook = renderer;
+            auto repainted = hook(fb, damage);
+            /* The other buffers have to be repainted there as well, so the
+             * region goes into the damage history of the buffer ages */
+            output_damage->damage(repainted);
+            swap_damage |= repainted * output->handle->scale;
+            swap_damage &= output_damage->get_wlr_damage_box();
         } else
         {
             swap_damage =
@@ -969,18 +1169,22 @@ class wf::render_manager::impl
      */
     void paint()
     {
+        auto& profile = *profiler.priv;
+        profile.begin_frame();
+
         /* Part 1: frame setup: query damage, etc. */
         effects->run_effects(OUTPUT_EFFECT_PRE);
         effects->run_effects(OUTPUT_EFFECT_DAMAGE);
+        profile.end_stage(FRAME_STAGE_EFFECTS);
 
-        if (do_direct_scanout())
+        bool scanout = do_direct_scanout();
+        profile.end_stage(FRAME_STAGE_SCANOUT);
+        if (scanout)
         {
             // Yet another optimization: if we can directly scanout, we should
             // stop the rest of the repaint cycle.
+            profile.end_frame(true, output->handle->commit_seq);
             return;
-        } else
-        {
-            last_scanout = nullptr;
         }
 
         bool needs_swap;
@@ -988,6 +1192,7 @@ class wf::render_manager::impl
         {
             wlr_output_rollback(output->handle);
             delay_manager->skip_frame();
+            profile.cancel_frame();
             return;
         }
 
@@ -998,6 +1203,7 @@ class wf::render_manager::impl
              * repaint */
             wlr_output_rollback(output->handle);
             delay_manager->skip_frame();
+            profile.cancel_frame();
             return;
         }
 
@@ -1007,21 +1213,23 @@ class wf::render_manager::impl
         output_damage->accumulate_damage();
 
         update_bound_output();
+        profile.begin_gpu_timer();
 
         /* Part 2: call the renderer, which sets swap_damage and
          * draws the scenegraph */
         render_output();
+        profile.end_stage(FRAME_STAGE_RENDER);
 
         /* Part 3: overlay effects */
         effects->run_effects(OUTPUT_EFFECT_OVERLAY);
+        profile.end_stage(FRAME_STAGE_OVERLAY);
 
+        /* Part 4: finalize the scene: postprocessing effects */
         if (postprocessing->post_effects.size())
         {
-            swap_damage |= output_damage->get_wlr_damage_box();
+            postprocessing->run_post_effects(swap_damage);
+            swap_damage &= output_damage->get_wlr_damage_box();
         }
-
-        /* Part 4: finalize the scene: postprocessing effects */
-        postprocessing->run_post_effects();
         if (output_inhibit_counter)
         {
             OpenGL::render_begin(output->handle->width, output->handle->height,
@@ -1030,6 +1238,8 @@ class wf::render_manager::impl
             OpenGL::render_end();
         }
 
+        profile.end_stage(FRAME_STAGE_POSTPROCESS);
+
         /* Part 5: render sw cursors
          * We render software cursors after everything else
          * for consistency with hardware cursor planes */
@@ -1040,12 +1250,18 @@ class wf::render_manager::impl
             swap_damage.to_pixman());
         wlr_renderer_end(wf::get_core().renderer);
         OpenGL::render_end();
+        profile.end_gpu_timer();
+        profile.end_stage(FRAME_STAGE_CURSORS);
 
         /* Part 6: finalize frame: swap buffers, send frame_done, etc */
+        profile.set_damage_rects(
+            pixman_region32_n_rects(swap_damage.to_pixman()));
         OpenGL::unbind_output();
         output_damage->swap_buffers(swap_damage);
         swap_damage.clear();
         post_paint();
+        profile.end_stage(FRAME_STAGE_SWAP);
+        profile.end_frame(false, output->handle->commit_seq);
     }
 
     /**
@@ -1061,12 +1277,154 @@ class wf::render_manager::impl
         }
     }
 
+    wf::option_wrapper_t<int> occluded_frame_rate{"core/occluded_frame_rate"};
+
+    /** @return The time between frames of occluded surfaces, in ms. A zero
+     * timeout would disarm the timer, so it is at least 1. */
+    uint32_t occluded_frame_interval()
+    {
+        return std::max(1, 1000 / std::max(1, (int)occluded_frame_rate));
+    }
+
+    /** Visibility of the surfaces on the current workspace, see
+     * compute_surface_visibility() */
+    std::unordered_map<wf::surface_interface_t*, surface_visibility_t>
+    surface_visibility;
+
+    /** The last time a frame callback was sent to each occluded surface */
+    std::unordered_map<wf::surface_interface_t*, uint32_t> last_occluded_frame;
+    std::unordered_map<wf::surface_interface_t*, uint32_t> next_occluded_frame;
+
+    /** Sends frame callbacks to throttled surfaces when no frames are drawn */
+    wf::wl_timer occluded_frame_timer;
+
+    static surface_visibility_t classify_surface(const wf::region_t& covered,
+        const wf::geometry_t& box)
+    {
+        if ((covered & box).empty())
+        {
+            return SURFACE_VISIBLE;
+        }
+
+        if ((wf::region_t{box} ^ covered).empty())
+        {
+            return SURFACE_OCCLUDED;
+        }
+
+        return SURFACE_PARTIALLY_VISIBLE;
+    }
+
+    /**
+     * Walk the views on the current workspace from top to bottom, and classify
+     * each surface depending on how much of it is covered by the opaque
+     * regions of the surfaces above it. Follows the same rules as
+     * check_schedule_surfaces().
+     */
+    void compute_surface_visibility()
+    {
+        surface_visibility.clear();
+
+        /* Everything outside of the output is hidden too */
+        auto og = output->get_relative_geometry();
+        wf::region_t covered{wf::geometry_t{
+                og.x - og.width, og.y - og.height, og.width * 3, og.height * 3,
+            }
+        };
+        covered ^= og;
+
+        auto views = output->workspace->get_views_on_workspace(
+            output->workspace->get_current_workspace(), wf::VISIBLE_LAYERS);
+        for (auto& v : views)
+        {
+            for (auto& view : v->enumerate_views(false))
+            {
+                if (!view->is_visible())
+                {
+                    continue;
+                }
+
+                if (view->has_transformer() || !view->is_mapped())
+                {
+                    /* Rendered as a single snapshot, classify as a whole */
+                    auto visibility =
+                        classify_surface(covered, view->get_bounding_box());
+                    for (auto& child : view->enumerate_surfaces({0, 0}))
+                    {
+                        surface_visibility[child.surface] = visibility;
+                    }
+
+                    covered |= view->get_transformed_opaque_region();
+                    continue;
+                }
+
+                auto origin = wf::origin(view->get_output_geometry());
+                for (auto& child : view->enumerate_surfaces(origin))
+                {
+                    auto size = child.surface->get_size();
+                    surface_visibility[child.surface] = classify_surface(covered,
+                        {child.position.x, child.position.y, size.width,
+                            size.height});
+                    covered |= child.surface->get_opaque_region(child.position);
+                }
+            }
+        }
+    }
+
+    /**
+     * Decide whether a surface should get a frame callback now.
+     *
+     * @param occluded_only Whether only throttled surfaces are being handled.
+     * @param throttled Set to true if the surface was throttled.
+     */
+    bool should_send_frame_done(wf::surface_interface_t *surface,
+        wayfire_view view, uint32_t now, bool occluded_only, bool& throttled)
+    {
+        auto it = surface_visibility.find(surface);
+        if ((it == surface_visibility.end()) || (it->second != SURFACE_OCCLUDED))
+        {
+            return !occluded_only;
+        }
+
+        surface_occluded_signal data;
+        data.surface = surface;
+        data.view    = view;
+        output->render->emit_signal("surface-occluded", &data);
+        if (data.visibility != SURFACE_OCCLUDED)
+        {
+            return !occluded_only;
+        }
+
+        /* Surfaces which just became occluded get one last frame */
+        auto last = last_occluded_frame.find(surface);
+        if (last == last_occluded_frame.end())
+        {
+            next_occluded_frame[surface] = now;
+            return true;
+        }
+
+        next_occluded_frame[surface] = last->second;
+        if ((occluded_frame_rate > 0) &&
+            (now - last->second >= occluded_frame_interval()))
+        {
+            next_occluded_frame[surface] = now;
+            return true;
+        }
+
+        throttled = true;
+        return false;
+    }
+
     /**
      * Send frame_done to clients.
+     *
+     * Surfaces which are fully occluded on the current workspace receive
+     * frame callbacks only at the rate given by core/occluded_frame_rate.
+     *
+     * @param occluded_only Send frame callbacks only to throttled surfaces
+     *   whose next frame is due.
      */
-    void send_frame_done()
+    void send_frame_done(bool occluded_only = false)
     {
-        /* TODO: do this only if the view isn't fully occluded by another */
         std::vector<wayfire_view> visible_views;
         if (renderer)
         {
@@ -1086,10 +1444,23 @@ class wf::render_manager::impl
                 additional_views.begin(), additional_views.end());
         }
 
+        /* Custom renderers may show any view, so we cannot throttle them */
+        const bool throttle = !renderer && (occluded_frame_rate >= 0);
+        if (throttle)
+        {
+            compute_surface_visibility();
+        } else
+        {
+            surface_visibility.clear();
+        }
+
         timespec repaint_ended;
         clockid_t presentation_clock =
             wlr_backend_get_presentation_clock(wf::get_core_impl().backend);
         clock_gettime(presentation_clock, &repaint_ended);
+
+        const uint32_t now = wf::get_current_time();
+        bool throttled     = false;
         for (auto& v : visible_views)
         {
             for (auto& view : v->enumerate_views())
@@ -1101,22 +1472,41 @@ class wf::render_manager::impl
 
                 for (auto& child : view->enumerate_surfaces())
                 {
-                    child.surface->send_frame_done(repaint_ended);
+                    if (!throttle ||
+                        should_send_frame_done(child.surface, view, now,
+                            occluded_only, throttled))
+                    {
+                        child.surface->send_frame_done(repaint_ended);
+                    }
                 }
             }
         }
+
+        std::swap(last_occluded_frame, next_occluded_frame);
+        next_occluded_frame.clear();
+
+        /* Nothing might be repainted for a while, so make sure that throttled
+         * surfaces still get their frame callbacks. */
+        if (throttled && (occluded_frame_rate > 0) &&
+            !occluded_frame_timer.is_connected())
+        {
+            occluded_frame_timer.set_timeout(occluded_frame_interval(), [=] ()
+            {
+                send_frame_done(true);
+                return false;
+            });
+        }
     }
 
     /* Workspace stream implementation */
     void workspace_stream_start(workspace_stream_t& stream)
     {
         stream.running = true;
-        stream.scale_x = stream.scale_y = 1;
 
         /* damage the whole workspace region, so that we get a full repaint
          * when updating the workspace */
         output_damage->damage(output_damage->get_ws_box(stream.ws));
-        workspace_stream_update(stream, 1, 1);
+        workspace_stream_update(stream, stream.scale_x, stream.scale_y);
     }
 
     /**
@@ -1134,15 +1524,14 @@ class wf::render_manager::impl
         wf::region_t damage;
     };
 
-    using damaged_surface = std::unique_ptr<damaged_surface_t>;
-
     /**
      * Represents the state while calculating what parts of the output
      * to repaint
      */
     struct workspace_stream_repaint_t
     {
-        std::vector<damaged_surface> to_render;
+        /* Taken from render_list_pool, so that the storage is reused */
+        std::vector<damaged_surface_t> to_render;
         wf::region_t ws_damage;
         wf::framebuffer_t fb;
 
@@ -1150,6 +1539,114 @@ class wf::render_manager::impl
         int ws_dy;
     };
 
+    /**
+     * Render lists which are not currently in use. Streams may be updated
+     * recursively, so we keep a small pool instead of a single list.
+     */
+    std::vector<std::vector<damaged_surface_t>> render_list_pool;
+
+    /**
+     * A flat copy of the views in the visible layers of the output together
+     * with their surface trees, in stacking order.
+     *
+     * It is rebuilt only when the scene generation changes, i.e. when views are
+     * restacked, added or removed, or subsurfaces are added or removed.
+     * Everything else (geometry, map state, transformers, visibility) is
+     * checked when scheduling each frame.
+     */
+    struct scene_list_t
+    {
+        struct surface_entry_t
+        {
+            wf::surface_interface_t *surface;
+            /* Index of the parent surface, -1 for the view's main surface */
+            int32_t parent;
+
+            /* Updated only when the view is scheduled for repaint */
+            wf::point_t position;
+            bool mapped;
+        };
+
+        struct view_entry_t
+        {
+            wayfire_view view;
+            /* The range of the view's surfaces in surfaces and render_order */
+            uint32_t begin;
+            uint32_t end;
+        };
+
+        std::vector<view_entry_t> views;
+        /* Surfaces of all views, parents before their children */
+        std::vector<surface_entry_t> surfaces;
+        /* Indices into surfaces, from the topmost to the bottom-most surface */
+        std::vector<uint32_t> render_order;
+
+        uint64_t generation = -1;
+
+        void push_surface_tree(wf::surface_interface_t *surface, int32_t parent)
+        {
+            int32_t self = surfaces.size();
+            surfaces.push_back({surface, parent, {0, 0}, false});
+
+            for (auto& child : surface->priv->surface_children_above)
+            {
+                push_surface_tree(child.get(), self);
+            }
+
+            render_order.push_back(self);
+            for (auto& child : surface->priv->surface_children_below)
+            {
+                push_surface_tree(child.get(), self);
+            }
+        }
+
+        void rebuild(wf::output_t *output)
+        {
+            views.clear();
+            surfaces.clear();
+            render_order.clear();
+
+            for (auto& v : output->workspace->get_views_in_layer(
+                wf::VISIBLE_LAYERS))
+            {
+                for (auto& view : v->enumerate_views(false))
+                {
+                    view_entry_t entry;
+                    entry.view  = view;
+                    entry.begin = surfaces.size();
+                    push_surface_tree(view.get(), -1);
+                    entry.end = surfaces.size();
+                    views.push_back(entry);
+                }
+            }
+
+            generation = wf::get_scene_generation();
+        }
+
+        /**
+         * Calculate the positions of the view's surfaces, and which of them
+         * would be returned by enumerate_surfaces().
+         */
+        void update_surfaces(const view_entry_t& entry, wf::point_t origin)
+        {
+            for (uint32_t i = entry.begin; i < entry.end; i++)
+            {
+                auto& s = surfaces[i];
+                if (s.parent < 0)
+                {
+                    s.position = origin;
+                    s.mapped   = s.surface->is_mapped();
+                    continue;
+                }
+
+                auto& p = surfaces[s.parent];
+                s.position = p.position + s.surface->get_offset();
+                s.mapped   = s.surface->is_mapped() &&
+                    ((p.parent < 0) || p.mapped);
+            }
+        }
+    } scene_list;
+
     /**
      * Calculate the damaged region of a view which renders with its snapshot
      * and add it to the render list
@@ -1159,17 +1656,17 @@ class wf::render_manager::impl
     void schedule_snapshotted_view(workspace_stream_repaint_t& repaint,
         wayfire_view view, wf::point_t view_delta)
     {
-        auto ds = damaged_surface(new damaged_surface_t);
-
         auto bbox = view->get_bounding_box() + view_delta;
-        ds->damage = (repaint.ws_damage & bbox) + -view_delta;
-        if (!ds->damage.empty())
-        {
-            ds->pos  = -view_delta;
-            ds->view = view.get();
+        auto damage = (repaint.ws_damage & bbox) + -view_delta;
+        if (!damage.empty())
+        {
+            repaint.to_render.emplace_back();
+            auto& ds = repaint.to_render.back();
+            ds.damage = std::move(damage);
+            ds.pos    = -view_delta;
+            ds.view   = view.get();
             repaint.ws_damage ^=
                 view->get_transformed_opaque_region() + view_delta;
-            repaint.to_render.push_back(std::move(ds));
         }
     }
 
@@ -1190,7 +1687,6 @@ class wf::render_manager::impl
             return;
         }
 
-        auto ds = damaged_surface(new damaged_surface_t);
         wlr_box obox = {
             .x     = pos.x,
             .y     = pos.y,
@@ -1198,16 +1694,18 @@ class wf::render_manager::impl
             .height = surface->get_size().height
         };
 
-        ds->damage = repaint.ws_damage & obox;
-        if (!ds->damage.empty())
+        auto damage = repaint.ws_damage & obox;
+        if (!damage.empty())
         {
-            ds->pos     = pos;
-            ds->surface = surface;
+            repaint.to_render.emplace_back();
+            auto& ds = repaint.to_render.back();
+            ds.damage  = std::move(damage);
+            ds.pos     = pos;
+            ds.surface = surface;
 
             /* Subtract opaque region from workspace damage. The views below
              * won't be visible, so no need to damage them */
-            repaint.ws_damage ^= ds->surface->get_opaque_region(pos);
-            repaint.to_render.push_back(std::move(ds));
+            repaint.ws_damage ^= surface->get_opaque_region(pos);
         }
     }
 
@@ -1270,46 +1768,56 @@ class wf::render_manager::impl
     void check_schedule_surfaces(workspace_stream_repaint_t& repaint,
         workspace_stream_t& stream)
     {
-        auto views = output->workspace->get_views_on_workspace(stream.ws,
-            wf::VISIBLE_LAYERS);
+        if (scene_list.generation != wf::get_scene_generation())
+        {
+            scene_list.rebuild(output);
+        }
 
         schedule_drag_icon(repaint);
-        for (auto& v : views)
+        for (auto& entry : scene_list.views)
         {
-            for (auto& view : v->enumerate_views(false))
+            if (repaint.ws_damage.empty())
             {
-                wf::point_t view_delta{0, 0};
-                if (!view->is_visible() || repaint.ws_damage.empty())
-                {
-                    continue;
-                }
+                break;
+            }
 
-                if (view->sticky)
-                {
-                    view_delta = {repaint.ws_dx, repaint.ws_dy};
-                }
+            auto& view = entry.view;
+            wf::point_t view_delta{0, 0};
+            if (!view->is_visible())
+            {
+                continue;
+            }
 
-                /* We use the snapshot of a view on either of the following
-                 * conditions:
-                 *
-                 * 1. The view has a transform
-                 * 2. The view is visible, but not mapped
-                 *    => it is snapshotted and kept alive by some plugin
-                 */
-                if (view->has_transformer() || !view->is_mapped())
-                {
-                    /* Snapshotted views include all of their subsurfaces, so we
-                     * don't recursively go into subsurfaces. */
-                    schedule_snapshotted_view(repaint, view, view_delta);
-                } else
+            if (view->sticky)
+            {
+                view_delta = {repaint.ws_dx, repaint.ws_dy};
+            }
+
+            /* We use the snapshot of a view on either of the following
+             * conditions:
+             *
+             * 1. The view has a transform
+             * 2. The view is visible, but not mapped
+             *    => it is snapshotted and kept alive by some plugin
+             */
+            if (view->has_transformer() || !view->is_mapped())
+            {
+                /* Snapshotted views include all of their subsurfaces, so we
+                 * don't recursively go into subsurfaces. */
+                schedule_snapshotted_view(repaint, view, view_delta);
+                continue;
+            }
+
+            /* Make sure view position is relative to the workspace
+             * being rendered */
+            auto obox = view->get_output_geometry() + view_delta;
+            scene_list.update_surfaces(entry, {obox.x, obox.y});
+            for (uint32_t i = entry.begin; i < entry.end; i++)
+            {
+                auto& child = scene_list.surfaces[scene_list.render_order[i]];
+                if (child.mapped)
                 {
-                    /* Make sure view position is relative to the workspace
-                     * being rendered */
-                    auto obox = view->get_output_geometry() + view_delta;
-                    for (auto& child : view->enumerate_surfaces({obox.x, obox.y}))
-                    {
-                        schedule_surface(repaint, child.surface, child.position);
-                    }
+                    schedule_surface(repaint, child.surface, child.position);
                 }
             }
         }
@@ -1324,31 +1832,43 @@ class wf::render_manager::impl
         workspace_stream_repaint_t repaint;
         repaint.ws_damage = output_damage->get_ws_damage(stream.ws);
 
+        /* The default streams render directly to the output */
+        const bool own_buffer = (stream.buffer.tex != 0);
+        if (own_buffer &&
+            ((scale_x != stream.scale_x) || (scale_y != stream.scale_y)))
+        {
+            /* The buffer is resized, so its contents are lost */
+            stream.scale_x = scale_x;
+            stream.scale_y = scale_y;
+            repaint.ws_damage |= output_damage->get_ws_box(stream.ws);
+        }
+
         /* we don't have to update anything */
         if (repaint.ws_damage.empty())
         {
             return repaint;
         }
 
-        if ((scale_x != stream.scale_x) || (scale_y != stream.scale_y))
-        {
-            /* FIXME: enable scaled rendering */
-            // stream->scale_x = scale_x;
-            // stream->scale_y = scale_y;
-
-            // ws_damage |= get_damage_box();
-        }
+        /* Framebuffers have a single scale, so the stream is rendered with the
+         * larger of the two */
+        float stream_scale = own_buffer ?
+            std::clamp(std::max(stream.scale_x, stream.scale_y), 0.01f, 1.0f) : 1;
 
         OpenGL::render_begin();
-        stream.buffer.allocate(output->handle->width, output->handle->height);
+        stream.buffer.allocate(
+            std::max(1, (int)std::ceil(output->handle->width * stream_scale)),
+            std::max(1, (int)std::ceil(output->handle->height * stream_scale)));
         OpenGL::render_end();
 
         repaint.fb = postprocessing->get_target_framebuffer();
-        if ((stream.buffer.tex != 0))
+        if (own_buffer)
         {
             /* Use the workspace buffers */
             repaint.fb.fb  = stream.buffer.fb;
             repaint.fb.tex = stream.buffer.tex;
+            repaint.fb.viewport_width  = stream.buffer.viewport_width;
+            repaint.fb.viewport_height = stream.buffer.viewport_height;
+            repaint.fb.scale *= stream_scale;
         }
 
         auto g   = output->get_relative_geometry();
@@ -1387,30 +1907,38 @@ class wf::render_manager::impl
     void render_views(workspace_stream_repaint_t& repaint)
     {
         wf::geometry_t fb_geometry = repaint.fb.geometry;
+        profiler.priv->add_surfaces(repaint.to_render.size());
 
+        OpenGL::begin_batch();
         for (auto& ds : wf::reverse(repaint.to_render))
         {
-            if (ds->view)
+            if (ds.view)
             {
-                repaint.fb.geometry = fb_geometry + ds->pos;
-                ds->view->render_transformed(repaint.fb, ds->damage);
-                for (auto& child : ds->view->enumerate_surfaces({0, 0}))
+                repaint.fb.geometry = fb_geometry + ds.pos;
+                ds.view->render_transformed(repaint.fb, ds.damage);
+                for (auto& child : ds.view->enumerate_surfaces({0, 0}))
                 {
                     send_sampled_on_output(child.surface);
                 }
             } else
             {
                 repaint.fb.geometry = fb_geometry;
-                ds->surface->simple_render(repaint.fb,
-                    ds->pos.x, ds->pos.y, ds->damage);
-                send_sampled_on_output(ds->surface);
+                ds.surface->simple_render(repaint.fb,
+                    ds.pos.x, ds.pos.y, ds.damage);
+                send_sampled_on_output(ds.surface);
             }
         }
 
         /* Restore proper geometry */
         repaint.fb.geometry = fb_geometry;
+        OpenGL::end_batch();
     }
 
+    const wf::signal_id_t stream_pre_signal =
+        wf::get_signal_id("workspace-stream-pre");
+    const wf::signal_id_t stream_post_signal =
+        wf::get_signal_id("workspace-stream-post");
+
     void workspace_stream_update(workspace_stream_t& stream,
         float scale_x = 1, float scale_y = 1)
     {
@@ -1422,9 +1950,15 @@ class wf::render_manager::impl
             return;
         }
 
+        if (!render_list_pool.empty())
+        {
+            repaint.to_render = std::move(render_list_pool.back());
+            render_list_pool.pop_back();
+        }
+
         {
             stream_signal_t data(stream.ws, repaint.ws_damage, repaint.fb);
-            output->render->emit_signal("workspace-stream-pre", &data);
+            output->render->emit_signal(stream_pre_signal, &data);
         }
 
         check_schedule_surfaces(repaint, stream);
@@ -1442,8 +1976,11 @@ class wf::render_manager::impl
         unschedule_drag_icon();
         {
             stream_signal_t data(stream.ws, repaint.ws_damage, repaint.fb);
-            output->render->emit_signal("workspace-stream-post", &data);
+            output->render->emit_signal(stream_post_signal, &data);
         }
+
+        repaint.to_render.clear();
+        render_list_pool.push_back(std::move(repaint.to_render));
     }
 
     void workspace_stream_stop(workspace_stream_t& stream)
@@ -1452,6 +1989,21 @@ class wf::render_manager::impl
     }
 };
 
+post_damage_expander_t post_damage::per_pixel()
+{
+    return [] (const wf::region_t& damage) { return damage; };
+}
+
+post_damage_expander_t post_damage::radius(int radius)
+{
+    return [=] (const wf::region_t& damage)
+    {
+        auto expanded = damage;
+        expanded.expand_edges(radius);
+        return expanded;
+    };
+}
+
 render_manager::render_manager(output_t *o) :
     pimpl(new impl(o))
 {}
@@ -1461,6 +2013,11 @@ void render_manager::set_renderer(render_hook_t rh)
     pimpl->set_renderer(rh);
 }
 
+void render_manager::set_damage_renderer(damage_render_hook_t rh)
+{
+    pimpl->set_renderer(rh);
+}
+
 void render_manager::set_redraw_always(bool always)
 {
     pimpl->set_redraw_always(always);
@@ -1491,9 +2048,9 @@ void render_manager::rem_effect(effect_hook_t *hook)
     pimpl->effects->rem_effect(hook);
 }
 
-void render_manager::add_post(post_hook_t *hook)
+void render_manager::add_post(post_hook_t *hook, post_damage_expander_t expand)
 {
-    pimpl->postprocessing->add_post(hook);
+    pimpl->postprocessing->add_post(hook, expand);
 }
 
 void render_manager::rem_post(post_hook_t *hook)
@@ -1544,7 +2101,17 @@ void render_manager::workspace_stream_start(workspace_stream_t& stream)
 void render_manager::workspace_stream_update(workspace_stream_t& stream,
     float scale_x, float scale_y)
 {
-    pimpl->workspace_stream_update(stream);
+    pimpl->workspace_stream_update(stream, scale_x, scale_y);
+}
+
+const scanout_stats_t& render_manager::get_scanout_stats() const
+{
+    return pimpl->scanout_stats;
+}
+
+frame_profiler_t& render_manager::get_frame_profiler()
+{
+    return pimpl->profiler;
 }
 
 void render_manager::workspace_stream_stop(workspace_stream_t& stream)
@@ -0,0 +1,96 @@
+#include "scanout-planes.hpp"
+#include "../main.hpp"
+#include <wayfire/output.hpp>
+#include <wayfire/util/log.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+
+namespace wf
+{
+/**
+ * Attach the surface's buffer to the primary plane and commit it, if the
+ * backend accepts the configuration.
+ */
+static bool commit_primary_plane(wlr_output *output, wlr_surface *surface)
+{
+    wlr_output_attach_buffer(output, &surface->buffer->base);
+    if (!wlr_output_test(output))
+    {
+        wlr_output_rollback(output);
+        return false;
+    }
+
+    return wlr_output_commit(output);
+}
+
+/**
+ * The planes which wlroots exposes to compositors. wlroots 0.16 does not
+ * have an API for overlay planes, so only the primary plane can be used.
+ */
+class primary_plane_model_t : public plane_model_t
+{
+    wf::output_t *output;
+
+  public:
+    primary_plane_model_t(wf::output_t *output)
+    {
+        this->output = output;
+    }
+
+    int get_overlay_plane_count() const override
+    {
+        return 0;
+    }
+
+    bool commit(const scanout_surface_t& primary,
+        const std::vector<scanout_surface_t>& overlays) override
+    {
+        if (!overlays.empty())
+        {
+            return false;
+        }
+
+        return commit_primary_plane(output->handle, primary.surface);
+    }
+};
+
+/**
+ * A plane model with a fixed number of simulated overlay planes, for testing.
+ *
+ * The primary surface is committed like on real hardware. The overlay planes
+ * cannot display anything, so frames which need them are composited.
+ */
+class simulated_plane_model_t : public primary_plane_model_t
+{
+    int nr_planes;
+
+  public:
+    simulated_plane_model_t(wf::output_t *output, int nr_planes) :
+        primary_plane_model_t(output)
+    {
+        this->nr_planes = nr_planes;
+    }
+
+    int get_overlay_plane_count() const override
+    {
+        return nr_planes;
+    }
+
+    bool is_simulated() const override
+    {
+        return true;
+    }
+};
+
+std::unique_ptr<plane_model_t> create_plane_model(wf::output_t *output)
+{
+    if (runtime_config.simulated_planes >= 0)
+    {
+        LOGI("Using ", runtime_config.simulated_planes,
+            " simulated overlay planes on ", output->to_string());
+        return std::make_unique<simulated_plane_model_t>(output,
+            runtime_config.simulated_planes);
+    }
+
+    return std::make_unique<primary_plane_model_t>(output);
+}
+}
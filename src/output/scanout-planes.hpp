@@ -0,0 +1,94 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <vector>
+#include <wayfire/geometry.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/nonstd/wlroots.hpp>
+
+namespace wf
+{
+class output_t;
+
+/** A surface which is to be presented on a hardware plane. */
+struct scanout_surface_t
+{
+    wlr_surface *surface;
+    /** The position of the surface in output-local coordinates */
+    wf::point_t position;
+};
+
+/** A surface of the topmost view, which is considered for a plane. */
+struct plane_candidate_t
+{
+    scanout_surface_t surface;
+    /** Whether this is the main surface of the view */
+    bool is_primary = false;
+    /** Whether the surface is at least partially visible on the output */
+    bool on_output = true;
+    /** Whether the buffer can be shown without scaling or transforming it */
+    bool matches_output = true;
+};
+
+/**
+ * Assign the surfaces of the topmost view to hardware planes.
+ *
+ * The main surface goes to the primary plane. Everything below it is hidden,
+ * and each surface above it which is visible on the output needs an overlay
+ * plane of its own.
+ *
+ * @param candidates The surfaces, ordered from the bottom-most to the topmost.
+ * @param nr_overlay_planes The number of available overlay planes.
+ *
+ * @return The reason why the output has to be composited, or nothing if all
+ *   surfaces were assigned.
+ */
+std::optional<scanout_fallback_t> assign_planes(
+    const std::vector<plane_candidate_t>& candidates, int nr_overlay_planes,
+    scanout_surface_t& primary, std::vector<scanout_surface_t>& overlays);
+
+/**
+ * The plane model describes which hardware planes of an output can be used
+ * for direct scanout, and presents buffers on them.
+ */
+class plane_model_t
+{
+  public:
+    virtual ~plane_model_t() = default;
+
+    /** @return The number of planes available in addition to the primary one. */
+    virtual int get_overlay_plane_count() const = 0;
+
+    /**
+     * @return Whether the overlay planes are only simulated. Surfaces assigned
+     *   to them are not displayed, so the output has to be composited anyway.
+     */
+    virtual bool is_simulated() const
+    {
+        return false;
+    }
+
+    /**
+     * Present @primary on the primary plane and each of @overlays on a
+     * separate overlay plane, ordered from the bottom-most to the topmost.
+     * If the planes cannot be configured, the pending output state is
+     * rolled back, so that the output can be composited as usual.
+     *
+     * @return true if the frame was committed, false otherwise.
+     */
+    virtual bool commit(const scanout_surface_t& primary,
+        const std::vector<scanout_surface_t>& overlays) = 0;
+};
+
+/**
+ * Create the plane model for the given output.
+ *
+ * By default, this is the output's primary plane. If simulated planes were
+ * requested on the command line, a test model with that many overlay planes
+ * is used instead. Assigning surfaces to them succeeds as on real hardware,
+ * which makes plane assignment testable on backends without hardware planes,
+ * for ex. the headless backend, but the output is still composited.
+ */
+std::unique_ptr<plane_model_t> create_plane_model(wf::output_t *output);
+}
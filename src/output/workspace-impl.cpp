@@ -7,6 +7,7 @@
 #include <wayfire/opengl.hpp>
 #include <list>
 #include <algorithm>
+#include <unordered_map>
 #include <wayfire/nonstd/reverse.hpp>
 #include <wayfire/util/log.hpp>
 
@@ -15,63 +16,6 @@
 
 namespace wf
 {
-/** Find a smart pointer inside a list */
-template<class Haystack, class Needle>
-typename std::list<Haystack>::iterator find_in(std::list<Haystack>& hay,
-    const Needle& needle)
-{
-    return std::find_if(std::begin(hay), std::end(hay), [=] (const auto& elem)
-    {
-        return elem.get() == needle.get();
-    });
-}
-
-/** Bring to front or lower to back inside a container of smart pointers */
-template<class Haystack, class Needle>
-void raise_to_front(std::list<Haystack>& hay, const Needle& needle,
-    bool reverse = false)
-{
-    auto it = find_in(hay, needle);
-    hay.splice(reverse ? hay.end() : hay.begin(), hay, it);
-}
-
-/** Reorder list so that @element is directly above @below. */
-template<class Haystack, class Needle>
-void reorder_above(
-    std::list<Haystack>& list, const Needle& element, const Needle& below)
-{
-    auto element_it = find_in(list, element);
-    auto pos = find_in(list, below);
-    list.splice(pos, list, element_it);
-}
-
-/** Reorder list so that @element is directly below @above. */
-template<class Haystack, class Needle>
-void reorder_below(
-    std::list<Haystack>& list, const Needle& element, const Needle& above)
-{
-    auto element_it = find_in(list, element);
-    auto pos = find_in(list, above);
-    assert(pos != list.end());
-    list.splice(std::next(pos), list, element_it);
-}
-
-/**
- * Remove needle from haystack, where both needle and elements in haystack are
- * smart pointers.
- */
-template<class Haystack, class Needle>
-void remove_from(Haystack& haystack, Needle& n)
-{
-    auto it = std::remove_if(std::begin(haystack), std::end(haystack),
-        [=] (const auto& contained)
-    {
-        return contained.get() == n.get();
-    });
-
-    haystack.erase(it, std::end(haystack));
-}
-
 /** Damage the entire view tree including the view itself. */
 void damage_views(wayfire_view view)
 {
@@ -93,6 +37,9 @@ struct sublayer_t
     /** The actual layer this sublayer belongs to */
     nonstd::observer_ptr<layer_container_t> layer;
 
+    /** The position of the sublayer in its list in the layer */
+    std::list<std::unique_ptr<sublayer_t>>::iterator position;
+
     /** The sublayer mode */
     sublayer_mode_t mode;
 
@@ -120,26 +67,43 @@ struct layer_container_t
     /** List of sublayers docked above */
     sublayer_container_t above;
 
-    void remove_sublayer(nonstd::observer_ptr<sublayer_t> sublayer)
+    sublayer_container_t& get_container(sublayer_mode_t mode)
     {
-        for (auto container : {& below, & floating, & above})
+        switch (mode)
         {
-            remove_from(*container, sublayer);
+          case SUBLAYER_DOCKED_BELOW:
+            return below;
+
+          case SUBLAYER_DOCKED_ABOVE:
+            return above;
+
+          default:
+            return floating;
         }
     }
+
+    void remove_sublayer(nonstd::observer_ptr<sublayer_t> sublayer)
+    {
+        get_container(sublayer->mode).erase(sublayer->position);
+    }
 };
 
 /**
  * output_layer_manager_t is a part of the workspace_manager module. It provides
  * the functionality related to layers and sublayers.
+ *
+ * Views and sublayers remember their position in the containing lists, so that
+ * all restacking operations take constant time. The flat stacking order is
+ * computed only when it is requested, and cached per layer mask until the
+ * next change.
  */
 class output_layer_manager_t
 {
     // A hierarchical representation of the view stack order
     layer_container_t layers[TOTAL_LAYERS];
 
-    // A flat representation of the view stack order
-    std::vector<wayfire_view> view_list;
+    // The flat stack order for each requested layer mask
+    std::unordered_map<uint32_t, std::vector<wayfire_view>> view_lists;
 
   public:
     output_layer_manager_t()
@@ -185,7 +149,7 @@ class output_layer_manager_t
 
         damage_views(view);
 
-        remove_from(sublayer->views, view);
+        sublayer->views.erase(view->view_impl->sublayer_position);
         if (sublayer->is_single_view)
         {
             sublayer->layer->remove_sublayer(sublayer);
@@ -193,7 +157,7 @@ class output_layer_manager_t
 
         /* Reset the view's sublayer */
         sublayer = nullptr;
-        rebuild_stack_order();
+        stack_order_changed();
     }
 
     void add_view_to_sublayer(wayfire_view view,
@@ -202,7 +166,8 @@ class output_layer_manager_t
         remove_view(view);
         get_view_sublayer(view) = sublayer;
         sublayer->views.push_front(view);
-        rebuild_stack_order();
+        view->view_impl->sublayer_position = sublayer->views.begin();
+        stack_order_changed();
     }
 
     nonstd::observer_ptr<sublayer_t> create_sublayer(layer_t layer_mask,
@@ -216,18 +181,18 @@ class output_layer_manager_t
         sublayer->mode  = mode;
         sublayer->is_single_view = false;
 
+        auto& container = layer.get_container(mode);
         switch (mode)
         {
           case SUBLAYER_DOCKED_BELOW:
-            layer.below.emplace_back(std::move(sublayer));
+            container.emplace_back(std::move(sublayer));
+            ptr->position = std::prev(container.end());
             break;
 
           case SUBLAYER_DOCKED_ABOVE:
-            layer.above.emplace_front(std::move(sublayer));
-            break;
-
           case SUBLAYER_FLOATING:
-            layer.floating.emplace_front(std::move(sublayer));
+            container.emplace_front(std::move(sublayer));
+            ptr->position = container.begin();
             break;
         }
 
@@ -238,8 +203,9 @@ class output_layer_manager_t
     void add_view_to_layer(wayfire_view view, layer_t layer)
     {
         damage_views(view);
-        add_view_to_sublayer(view, create_sublayer(layer, SUBLAYER_FLOATING));
-        rebuild_stack_order();
+        auto sublayer = create_sublayer(layer, SUBLAYER_FLOATING);
+        sublayer->is_single_view = true;
+        add_view_to_sublayer(view, sublayer);
         damage_views(view);
     }
 
@@ -256,16 +222,18 @@ class output_layer_manager_t
 
         if (sublayer->mode == SUBLAYER_FLOATING)
         {
-            raise_to_front(sublayer->layer->floating, sublayer);
+            auto& floating = sublayer->layer->floating;
+            floating.splice(floating.begin(), floating, sublayer->position);
         }
 
-        raise_to_front(sublayer->views, view);
-        rebuild_stack_order();
+        sublayer->views.splice(sublayer->views.begin(), sublayer->views,
+            view->view_impl->sublayer_position);
+        stack_order_changed();
     }
 
     wayfire_view get_front_view(wf::layer_t layer)
     {
-        auto views = get_views_in_layer(layer);
+        auto& views = get_cached_views(layer);
         if (views.size() == 0)
         {
             return nullptr;
@@ -283,10 +251,12 @@ class output_layer_manager_t
         auto below_sublayer = get_view_sublayer(below);
         assert(view_sublayer->layer == below_sublayer->layer);
 
+        auto& views = view_sublayer->views;
         if (view_sublayer == below_sublayer)
         {
-            reorder_above(view_sublayer->views, view, below);
-            rebuild_stack_order();
+            views.splice(below->view_impl->sublayer_position, views,
+                view->view_impl->sublayer_position);
+            stack_order_changed();
 
             return;
         }
@@ -297,9 +267,12 @@ class output_layer_manager_t
             return;
         }
 
-        reorder_above(view_sublayer->layer->floating, view_sublayer, below_sublayer);
-        raise_to_front(view_sublayer->views, view, true); // bring to back == reverse
-        rebuild_stack_order();
+        auto& floating = view_sublayer->layer->floating;
+        floating.splice(below_sublayer->position, floating,
+            view_sublayer->position);
+        // bring to back
+        views.splice(views.end(), views, view->view_impl->sublayer_position);
+        stack_order_changed();
     }
 
     /** Precondition: view and above are in the same layer */
@@ -311,10 +284,12 @@ class output_layer_manager_t
         auto above_sublayer = get_view_sublayer(above);
         assert(view_sublayer->layer == above_sublayer->layer);
 
+        auto& views = view_sublayer->views;
         if (view_sublayer == above_sublayer)
         {
-            reorder_below(view_sublayer->views, view, above);
-            rebuild_stack_order();
+            views.splice(std::next(above->view_impl->sublayer_position), views,
+                view->view_impl->sublayer_position);
+            stack_order_changed();
 
             return;
         }
@@ -325,9 +300,11 @@ class output_layer_manager_t
             return;
         }
 
-        reorder_below(view_sublayer->layer->floating, view_sublayer, above_sublayer);
-        raise_to_front(view_sublayer->views, view);
-        rebuild_stack_order();
+        auto& floating = view_sublayer->layer->floating;
+        floating.splice(std::next(above_sublayer->position), floating,
+            view_sublayer->position);
+        views.splice(views.begin(), views, view->view_impl->sublayer_position);
+        stack_order_changed();
     }
 
     enum class promoted_state_t
@@ -363,20 +340,31 @@ class output_layer_manager_t
         }
     }
 
-    void rebuild_stack_order()
+    /**
+     * Invalidate the cached stack order. Needs to be called after changing
+     * the layers or the promoted state of views.
+     */
+    void stack_order_changed()
     {
-        this->view_list = _get_views_in_layer(VISIBLE_LAYERS);
+        view_lists.clear();
+        scene_structure_changed();
     }
 
     std::vector<wayfire_view> get_views_in_layer(uint32_t layers_mask)
     {
-        if (layers_mask == VISIBLE_LAYERS)
-        {
-            return view_list;
-        } else
+        return get_cached_views(layers_mask);
+    }
+
+    const std::vector<wayfire_view>& get_cached_views(uint32_t layers_mask)
+    {
+        auto it = view_lists.find(layers_mask);
+        if (it == view_lists.end())
         {
-            return _get_views_in_layer(layers_mask);
+            it = view_lists.emplace(layers_mask,
+                _get_views_in_layer(layers_mask)).first;
         }
+
+        return it->second;
     }
 
     std::vector<wayfire_view> _get_views_in_layer(uint32_t layers_mask)
@@ -988,6 +976,9 @@ class workspace_manager::impl
             view->view_impl->is_promoted = false;
         }
 
+        /* The promoted views are ordered first, so the order changes too */
+        layer_manager.stack_order_changed();
+
         auto views = viewport_manager.get_views_on_workspace(
             vp, LAYER_WORKSPACE);
 
@@ -1004,7 +995,7 @@ class workspace_manager::impl
             views.front()->view_impl->is_promoted = true;
         }
 
-        layer_manager.rebuild_stack_order();
+        layer_manager.stack_order_changed();
         check_autohide_panels();
 
         /**
@@ -33,6 +33,16 @@ class surface_interface_t::impl
     bool _closing = false;
 };
 
+/**
+ * The scene generation changes whenever views or surfaces are added to or
+ * removed from the scene, or when the stacking order changes. It is used to
+ * invalidate the render lists cached by the render manager.
+ */
+uint64_t get_scene_generation();
+
+/** Indicate that the structure of the scene has changed. */
+void scene_structure_changed();
+
 /**
  * A base class for views and surfaces which are based on a wlr_surface
  * Any class that derives from wlr_surface_base_t must also derive from
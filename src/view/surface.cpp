@@ -10,6 +10,21 @@
 #include "wayfire/render-manager.hpp"
 #include "wayfire/signal-definitions.hpp"
 
+namespace
+{
+uint64_t scene_generation = 0;
+}
+
+uint64_t wf::get_scene_generation()
+{
+    return scene_generation;
+}
+
+void wf::scene_structure_changed()
+{
+    ++scene_generation;
+}
+
 /****************************
 * surface_interface_t functions
 ****************************/
@@ -32,6 +47,7 @@ void wf::surface_interface_t::add_subsurface(
     ev.subsurface   = {subsurface};
 
     container.insert(container.begin(), std::move(subsurface));
+    scene_structure_changed();
     this->emit_signal("subsurface-added", &ev);
 }
 
@@ -52,6 +68,7 @@ void wf::surface_interface_t::remove_subsurface(
 
     remove_from(priv->surface_children_above);
     remove_from(priv->surface_children_below);
+    scene_structure_changed();
 }
 
 wf::surface_interface_t::~surface_interface_t()
@@ -235,6 +252,7 @@ void wf::surface_interface_t::clear_subsurfaces()
 
     finish_subsurfaces(priv->surface_children_above);
     finish_subsurfaces(priv->surface_children_below);
+    scene_structure_changed();
 }
 
 wf::wlr_surface_base_t::wlr_surface_base_t(surface_interface_t *self)
@@ -423,25 +441,16 @@ void wf::wlr_surface_base_t::_simple_render(const wf::framebuffer_t& fb,
     wf::geometry_t geometry = {x, y, size.width, size.height};
     wf::texture_t texture{surface};
 
-    OpenGL::render_begin(fb);
-    OpenGL::render_texture(texture, fb, geometry, glm::vec4(1.f),
-        OpenGL::RENDER_FLAG_CACHED);
     // use GL_NEAREST for integer scale.
     // GL_NEAREST makes scaled text blocky instead of blurry, which looks better
     // but only for integer scale.
+    uint32_t bits = 0;
     if (fb.scale - floor(fb.scale) < 0.001)
     {
-        GL_CALL(glTexParameteri(texture.target, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
-    }
-
-    for (const auto& rect : damage)
-    {
-        fb.logic_scissor(wlr_box_from_pixman_box(rect));
-        OpenGL::draw_cached();
+        bits |= OpenGL::RENDER_FLAG_NEAREST_MAG_FILTER;
     }
 
-    OpenGL::clear_cached();
-    OpenGL::render_end();
+    OpenGL::batch_texture(texture, fb, geometry, damage, glm::vec4(1.f), bits);
 }
 
 wf::wlr_child_surface_base_t::wlr_child_surface_base_t(
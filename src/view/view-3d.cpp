@@ -4,6 +4,7 @@
 #include "wayfire/output.hpp"
 #include <algorithm>
 #include <cmath>
+#include <typeinfo>
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -33,6 +34,12 @@ wf::region_t wf::view_transformer_t::transform_opaque_region(
     return {};
 }
 
+bool wf::view_transformer_t::get_matrix_transform(wf::geometry_t view,
+    glm::mat4& matrix, glm::vec4& color)
+{
+    return false;
+}
+
 void wf::view_transformer_t::render_with_damage(wf::texture_t src_tex,
     wlr_box src_box,
     const wf::region_t& damage, const wf::framebuffer_t& target_fb)
@@ -175,6 +182,48 @@ void wf::view_2D::render_box(wf::texture_t src_tex, wlr_box src_box,
     OpenGL::render_end();
 }
 
+/**
+ * @return A matrix which converts output-local coordinates to coordinates
+ *   relative to the center, with the Y axis pointing up, or back.
+ */
+static glm::mat4 to_center_relative(wf::point_t center, bool inverse)
+{
+    auto flip_y = glm::scale(glm::mat4(1.0), {1, -1, 1});
+    if (inverse)
+    {
+        return glm::translate(glm::mat4(1.0), {center.x, center.y, 0}) * flip_y;
+    }
+
+    return flip_y * glm::translate(glm::mat4(1.0), {-center.x, -center.y, 0});
+}
+
+glm::mat4 wf::view_2D::get_output_matrix()
+{
+    auto wm_geom = view->transform_region(view->get_wm_geometry(), this);
+    auto center  = get_center(wm_geom);
+
+    auto scale     = glm::scale(glm::mat4(1.0), {scale_x, scale_y, 1});
+    auto rotate    = glm::rotate(glm::mat4(1.0), angle, {0, 0, 1});
+    auto translate = glm::translate(glm::mat4(1.0),
+        {translation_x, -translation_y, 0});
+
+    return to_center_relative(center, true) * translate * rotate * scale *
+           to_center_relative(center, false);
+}
+
+bool wf::view_2D::get_matrix_transform(wf::geometry_t,
+    glm::mat4& matrix, glm::vec4& color)
+{
+    if (typeid(*this) != typeid(wf::view_2D))
+    {
+        return false;
+    }
+
+    matrix = get_output_matrix();
+    color  = {1.0f, 1.0f, 1.0f, alpha};
+    return true;
+}
+
 const float wf::view_3D::fov = PI / 4;
 glm::mat4 wf::view_3D::default_view_matrix()
 {
@@ -287,3 +336,25 @@ void wf::view_3D::render_box(wf::texture_t src_tex, wlr_box src_box,
         transform, color);
     OpenGL::render_end();
 }
+
+glm::mat4 wf::view_3D::get_output_matrix()
+{
+    auto wm_geom = view->transform_region(view->get_wm_geometry(), this);
+    auto center  = get_center(wm_geom);
+
+    return to_center_relative(center, true) * calculate_total_transform() *
+           to_center_relative(center, false);
+}
+
+bool wf::view_3D::get_matrix_transform(wf::geometry_t,
+    glm::mat4& matrix, glm::vec4& color)
+{
+    if (typeid(*this) != typeid(wf::view_3D))
+    {
+        return false;
+    }
+
+    matrix = get_output_matrix();
+    color  = this->color;
+    return true;
+}
@@ -1,6 +1,7 @@
 #ifndef VIEW_IMPL_HPP
 #define VIEW_IMPL_HPP
 
+#include <list>
 #include <wayfire/nonstd/safe-list.hpp>
 #include <wayfire/view.hpp>
 #include <wayfire/opengl.hpp>
@@ -22,6 +23,30 @@ struct view_transform_block_t : public noncopyable_t
     std::unique_ptr<wf::view_transformer_t> transform;
     wf::framebuffer_t fb;
 
+    /** The inputs from which fb was last rendered */
+    struct cache_key_t
+    {
+        uint64_t damage_generation;
+        GLuint source;
+        wf::geometry_t source_box;
+        wf::geometry_t target_box;
+        float scale;
+        glm::mat4 matrix;
+        glm::vec4 color;
+
+        bool operator ==(const cache_key_t& other) const
+        {
+            return damage_generation == other.damage_generation &&
+                   source == other.source && source_box == other.source_box &&
+                   target_box == other.target_box && scale == other.scale &&
+                   matrix == other.matrix && color == other.color;
+        }
+    };
+
+    /* fb does not need to be rendered again while the inputs are the same */
+    cache_key_t cache_key;
+    bool cache_valid = false;
+
     view_transform_block_t();
     ~view_transform_block_t();
 };
@@ -65,6 +90,11 @@ class view_interface_t::view_priv_impl
     int visibility_counter   = 1;
 
     wf::safe_list_t<std::shared_ptr<view_transform_block_t>> transforms;
+    /**
+     * Incremented each time the view is damaged or its transformers change,
+     * so that the buffers of the transformers are rendered again.
+     */
+    uint64_t damage_generation = 0;
 
     struct offscreen_buffer_t : public wf::framebuffer_t
     {
@@ -79,6 +109,9 @@ class view_interface_t::view_priv_impl
 
     /** The sublayer of the view. For workspace-manager. */
     nonstd::observer_ptr<sublayer_t> sublayer;
+    /* The position of the view in the sublayer, valid while sublayer is set.
+     * For workspace-manager. */
+    std::list<wayfire_view>::iterator sublayer_position;
     /* Promoted to the fullscreen layer? For workspace-manager. */
     bool is_promoted = false;
 
@@ -13,6 +13,7 @@
 
 #include <algorithm>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include "wayfire/signal-definitions.hpp"
 
 static void reposition_relative_to_parent(wayfire_view view)
@@ -111,6 +112,7 @@ void wf::view_interface_t::set_toplevel_parent(wayfire_view new_parent)
         }
 
         parent = new_parent;
+        scene_structure_changed();
         desktop_state_updated();
     }
 
@@ -762,6 +764,7 @@ void wf::view_interface_t::damage()
 {
     auto bbox = get_untransformed_bounding_box();
     view_impl->offscreen_buffer.cached_damage |= bbox;
+    ++view_impl->damage_generation;
     view_damage_raw(self(), transform_region(bbox));
 }
 
@@ -922,6 +925,7 @@ void wf::view_interface_t::pop_transformer(
     {
         return tr->transform.get() == transformer.get();
     });
+    ++view_impl->damage_generation;
 
     /* Since we can remove transformers while rendering the output, damaging it
      * won't help at this stage (damage is already calculated).
@@ -1074,6 +1078,32 @@ wf::region_t wf::view_interface_t::get_transformed_opaque_region()
     return opaque;
 }
 
+/**
+ * Render the texture, transformed with the given matrix, where src_box is the
+ * geometry of the texture in output-local coordinates.
+ */
+static void render_matrix_transformed(const wf::texture_t& texture,
+    wf::geometry_t src_box, const glm::mat4& matrix, const glm::vec4& color,
+    const wf::framebuffer_t& framebuffer, const wf::region_t& damage)
+{
+    OpenGL::render_begin(framebuffer);
+    auto transform = framebuffer.get_orthographic_projection() * matrix;
+    gl_geometry src_geometry = {
+        1.0f * src_box.x, 1.0f * src_box.y,
+        1.0f * src_box.x + 1.0f * src_box.width,
+        1.0f * src_box.y + 1.0f * src_box.height,
+    };
+
+    for (const auto& rect : damage)
+    {
+        framebuffer.logic_scissor(wlr_box_from_pixman_box(rect));
+        OpenGL::render_transformed_texture(texture, src_geometry, {},
+            transform, color);
+    }
+
+    OpenGL::render_end();
+}
+
 bool wf::view_interface_t::render_transformed(const wf::framebuffer_t& framebuffer,
     const wf::region_t& damage)
 {
@@ -1110,12 +1140,93 @@ bool wf::view_interface_t::render_transformed(const wf::framebuffer_t& framebuff
     /* final_transform is the one that should render to the screen */
     std::shared_ptr<view_transform_block_t> final_transform = nullptr;
 
+    /* The buffer of a cacheable transformer is rendered again only if its
+     * inputs or the buffers before it have changed. */
+    const uint64_t generation = view_impl->damage_generation;
+    bool buffers_changed = false;
+    auto prepare_buffer = [&] (view_transform_block_t& block, bool cacheable,
+                               const view_transform_block_t::cache_key_t& key)
+    {
+        auto box = key.target_box;
+        block.fb.geometry = box;
+        if (cacheable && !buffers_changed && block.cache_valid &&
+            (block.cache_key == key))
+        {
+            return false;
+        }
+
+        OpenGL::render_begin();
+        block.fb.allocate(box.width * texture_scale, box.height * texture_scale);
+        block.fb.scale = texture_scale;
+        block.fb.bind(); // bind buffer to clear it
+        OpenGL::clear({0, 0, 0, 0});
+        OpenGL::render_end();
+
+        block.cache_key   = key;
+        block.cache_valid = cacheable;
+        buffers_changed   = true;
+        return true;
+    };
+
+    /* Consecutive transformers which can be described as a matrix are drawn
+     * in a single pass: their matrices are accumulated in fused_matrix, which
+     * transforms fused_box, until a transformer which needs a buffer. Like
+     * intermediate buffers, the Z coordinate is dropped between transformers. */
+    std::shared_ptr<view_transform_block_t> fused_last = nullptr;
+    wf::geometry_t fused_box;
+    glm::mat4 fused_matrix;
+    glm::vec4 fused_color;
+    const glm::mat4 flatten = glm::scale(glm::mat4(1.0), {1, 1, 0});
+
+    auto flush_fused = [&] ()
+    {
+        if (!fused_last)
+        {
+            return;
+        }
+
+        /* The matrix and the color describe the fused transformers fully */
+        view_transform_block_t::cache_key_t key = {
+            generation, previous_texture.tex_id, fused_box, obox, texture_scale,
+            fused_matrix, fused_color,
+        };
+        if (prepare_buffer(*fused_last, true, key))
+        {
+            render_matrix_transformed(previous_texture, fused_box, fused_matrix,
+                fused_color, fused_last->fb, wf::region_t{obox});
+        }
+
+        previous_transform = fused_last;
+        previous_texture   = previous_transform->fb.tex;
+        fused_last = nullptr;
+    };
+
     /* Render the view passing its snapshot through the transformers.
      * For each transformer except the last we render on offscreen buffers,
      * and the last one is rendered to the real fb. */
     auto& transforms = view_impl->transforms;
     transforms.for_each([&] (auto& transform) -> void
     {
+        glm::mat4 matrix;
+        glm::vec4 color;
+        if (transform->transform->get_matrix_transform(obox, matrix, color))
+        {
+            if (!fused_last)
+            {
+                fused_box    = obox;
+                fused_matrix = glm::mat4(1.0);
+                fused_color  = glm::vec4(1.0);
+            }
+
+            fused_matrix = matrix * flatten * fused_matrix;
+            fused_color *= color;
+            fused_last   = transform;
+            obox = transform->transform->get_bounding_box(obox, obox);
+            return;
+        }
+
+        flush_fused();
+
         /* Last transform is handled separately */
         if (transform == transforms.back())
         {
@@ -1127,27 +1238,32 @@ bool wf::view_interface_t::render_transformed(const wf::framebuffer_t& framebuff
         /* Calculate size after this transform */
         auto transformed_box =
             transform->transform->get_bounding_box(obox, obox);
-        int scaled_width  = transformed_box.width * texture_scale;
-        int scaled_height = transformed_box.height * texture_scale;
-
-        /* Prepare buffer to store result after the transform */
-        OpenGL::render_begin();
-        transform->fb.allocate(scaled_width, scaled_height);
-        transform->fb.scale    = texture_scale;
-        transform->fb.geometry = transformed_box;
-        transform->fb.bind(); // bind buffer to clear it
-        OpenGL::clear({0, 0, 0, 0});
-        OpenGL::render_end();
 
         /* Actually render the transform to the next framebuffer */
-        transform->transform->render_with_damage(previous_texture, obox,
-            wf::region_t{transformed_box}, transform->fb);
+        view_transform_block_t::cache_key_t key = {
+            generation, previous_texture.tex_id, obox, transformed_box,
+            texture_scale, glm::mat4(1.0), glm::vec4(1.0),
+        };
+        if (prepare_buffer(*transform, transform->transform->is_cacheable(),
+            key))
+        {
+            transform->transform->render_with_damage(previous_texture, obox,
+                wf::region_t{transformed_box}, transform->fb);
+        }
 
         previous_transform = transform;
         previous_texture   = previous_transform->fb.tex;
         obox = transformed_box;
     });
 
+    if (fused_last)
+    {
+        /* The last transformers can be drawn directly to the framebuffer */
+        render_matrix_transformed(previous_texture, fused_box, fused_matrix,
+            fused_color, framebuffer, damage & framebuffer.geometry);
+        return true;
+    }
+
     /* This can happen in two ways:
      * 1. The view is unmapped, and no snapshot
      * 2. The last transform was deleted while iterating, so now the last
@@ -1157,22 +1273,8 @@ bool wf::view_interface_t::render_transformed(const wf::framebuffer_t& framebuff
      * framebuffer. */
     if (final_transform == nullptr)
     {
-        OpenGL::render_begin(framebuffer);
-        auto matrix = framebuffer.get_orthographic_projection();
-        gl_geometry src_geometry = {
-            1.0f * obox.x, 1.0f * obox.y,
-            1.0f * obox.x + 1.0f * obox.width,
-            1.0f * obox.y + 1.0f * obox.height,
-        };
-
-        for (const auto& rect : damage)
-        {
-            framebuffer.logic_scissor(wlr_box_from_pixman_box(rect));
-            OpenGL::render_transformed_texture(previous_texture, src_geometry,
-                {}, matrix);
-        }
-
-        OpenGL::render_end();
+        render_matrix_transformed(previous_texture, obox, glm::mat4(1.0),
+            glm::vec4(1.0), framebuffer, damage);
     } else
     {
         /* Regular case, just call the last transformer, but render directly
@@ -1236,6 +1338,7 @@ void wf::view_interface_t::take_snapshot()
 
     auto output_geometry = get_output_geometry();
     auto children = enumerate_surfaces({output_geometry.x, output_geometry.y});
+    OpenGL::begin_batch();
     for (auto& child : wf::reverse(children))
     {
         wlr_box child_box{
@@ -1250,6 +1353,7 @@ void wf::view_interface_t::take_snapshot()
             offscreen_buffer.cached_damage & child_box);
     }
 
+    OpenGL::end_batch();
     offscreen_buffer.cached_damage.clear();
 }
 
@@ -1299,6 +1403,7 @@ wf::view_interface_t::~view_interface_t()
 {
     /* Note: at this point, it is invalid to call most functions */
     unset_toplevel_parent(self());
+    scene_structure_changed();
 }
 
 void wf::view_interface_t::damage_surface_box(const wlr_box& box)
@@ -1309,6 +1414,7 @@ void wf::view_interface_t::damage_surface_box(const wlr_box& box)
     damaged.x += obox.x;
     damaged.y += obox.y;
     view_impl->offscreen_buffer.cached_damage |= damaged;
+    ++view_impl->damage_generation;
     view_damage_raw(self(), transform_region(damaged));
 }
 
@@ -1344,7 +1450,15 @@ void wf::view_damage_raw(wayfire_view view, const wlr_box& box)
         output->render->damage(box);
     }
 
-    view->emit_signal("region-damaged", nullptr);
+    static const auto region_damaged = wf::get_signal_id("region-damaged");
+    static const auto view_region_damaged =
+        wf::get_signal_id("view-region-damaged");
+
+    wf::view_region_damaged_signal data;
+    data.view = view;
+    data.box  = box;
+    view->emit_signal(region_damaged, &data);
+    output->emit_signal(view_region_damaged, &data);
 }
 
 void wf::view_interface_t::destruct()
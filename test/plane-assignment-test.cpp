@@ -0,0 +1,98 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+#include "../src/output/scanout-planes.hpp"
+
+using namespace wf;
+
+/* The surfaces are only compared, never dereferenced, so that the assignment
+ * can be checked without a backend. */
+static char surface_storage[4];
+static wlr_surface *fake_surface(int i)
+{
+    return reinterpret_cast<wlr_surface*>(&surface_storage[i]);
+}
+
+static plane_candidate_t make_candidate(int i, bool is_primary = false)
+{
+    plane_candidate_t candidate;
+    candidate.surface    = {fake_surface(i), {0, 0}};
+    candidate.is_primary = is_primary;
+    return candidate;
+}
+
+TEST_CASE("Main surface only")
+{
+    scanout_surface_t primary;
+    std::vector<scanout_surface_t> overlays;
+
+    auto reason = assign_planes({make_candidate(0, true)}, 0, primary, overlays);
+    CHECK(!reason);
+    CHECK(primary.surface == fake_surface(0));
+    CHECK(overlays.empty());
+}
+
+TEST_CASE("Surfaces below the main surface are hidden")
+{
+    scanout_surface_t primary;
+    std::vector<scanout_surface_t> overlays;
+
+    auto decoration = make_candidate(1);
+    decoration.matches_output = false;
+
+    auto reason = assign_planes({decoration, make_candidate(0, true)}, 0,
+        primary, overlays);
+    CHECK(!reason);
+    CHECK(primary.surface == fake_surface(0));
+    CHECK(overlays.empty());
+}
+
+TEST_CASE("Surfaces above the main surface need overlay planes")
+{
+    scanout_surface_t primary;
+    std::vector<scanout_surface_t> overlays;
+    std::vector<plane_candidate_t> candidates = {
+        make_candidate(0, true), make_candidate(1), make_candidate(2)};
+
+    auto reason = assign_planes(candidates, 2, primary, overlays);
+    CHECK(!reason);
+    REQUIRE(overlays.size() == 2);
+    CHECK(overlays[0].surface == fake_surface(1));
+    CHECK(overlays[1].surface == fake_surface(2));
+
+    reason = assign_planes(candidates, 1, primary, overlays);
+    CHECK(reason == scanout_fallback_t::NOT_ENOUGH_PLANES);
+}
+
+TEST_CASE("Surfaces outside of the output are ignored")
+{
+    scanout_surface_t primary;
+    std::vector<scanout_surface_t> overlays;
+
+    auto offscreen = make_candidate(1);
+    offscreen.on_output = false;
+    offscreen.matches_output = false;
+
+    auto reason = assign_planes({make_candidate(0, true), offscreen}, 0,
+        primary, overlays);
+    CHECK(!reason);
+    CHECK(overlays.empty());
+}
+
+TEST_CASE("Mismatching surfaces cannot be scanned out")
+{
+    scanout_surface_t primary;
+    std::vector<scanout_surface_t> overlays;
+
+    auto main_surface = make_candidate(0, true);
+    main_surface.matches_output = false;
+    CHECK(assign_planes({main_surface}, 1, primary, overlays) ==
+        scanout_fallback_t::VIEW_BUFFER_MISMATCH);
+
+    auto subsurface = make_candidate(1);
+    subsurface.matches_output = false;
+    CHECK(assign_planes({make_candidate(0, true), subsurface}, 1, primary,
+        overlays) == scanout_fallback_t::SURFACE_MISMATCH);
+
+    CHECK(assign_planes({make_candidate(1)}, 1, primary, overlays) ==
+        scanout_fallback_t::VIEW_BUFFER_MISMATCH);
+}